@@ -0,0 +1,342 @@
+//
+//  phonesim_benchmark.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/20/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <vector>
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include "../scenario_generator/scenario_generator.h"
+#include "../optimal_solver/graph_converter.h"
+#include "../optimal_solver/optimal_solver.h"
+#include "../heuristic_solver/heuristic_solver.h"
+#include "../heuristic_solver/heuristic_dyn_solver.h"
+#include "../heuristic_solver/agg_heuristic_solver.h"
+#include "../heuristic_solver/naive_solver.h"
+#include "../sweep_runner.h"
+#include "../simlog.h"
+
+// Microbenchmarks of the simulation stages. Every benchmark takes
+// the arguments (phone count, running time, target count, map scale
+// in percent of the 624 x 316 map used by phonesim).
+//
+// Run e.g. ./phonesim_benchmark --benchmark_filter=ConvertToGraph
+
+namespace mss = mobile_sensing_sim;
+
+namespace {
+  const int kReportPeriod = 60;
+
+  // Street grid like the phonesim map: three streets each way,
+  // entries at both ends of every street and targets spread over
+  // the horizontal streets.
+  mss::MonitorMap CreateMap(int scale, int target_count) {
+    const double kLength = 624.0 * scale / 100;
+    const double kWidth = 316.0 * scale / 100;
+
+    std::vector<mss::Point> entry_points;
+    std::vector<mss::Point> intersect_points;
+    for (int k = 1; k <= 3; ++k) {
+      const double x = kLength * k / 4;
+      const double y = kWidth * k / 4;
+      entry_points.push_back(mss::Point(x, 0));
+      entry_points.push_back(mss::Point(x, kWidth));
+      entry_points.push_back(mss::Point(0, y));
+      entry_points.push_back(mss::Point(kLength, y));
+      for (int l = 1; l <= 3; ++l) {
+        intersect_points.push_back(mss::Point(x, kWidth * l / 4));
+      }
+    }
+    mss::AreaMap am(entry_points, intersect_points, kLength, kWidth);
+
+    std::vector<mss::Point> monitor_points;
+    const int kPerStreet = (target_count + 2) / 3;
+    for (int k = 0; k < target_count; ++k) {
+      monitor_points.push_back(mss::Point(kLength * (k / 3 + 1) / (kPerStreet + 1), kWidth * (k % 3 + 1) / 4));
+    }
+    return mss::MonitorMap(monitor_points, am);
+  }
+
+  mss::ScenarioParameters CreateParameters(const benchmark::State& state) {
+    mss::ScenarioParameters sp;
+    sp.phone_count = state.range(0);
+    sp.running_time = state.range(1);
+    sp.sensing_range = 40;
+    sp.comm_range = 40;
+    sp.speed_range = mss::Range(5, 15, 0.1);
+    sp.start_time_range = mss::Range(0, std::min(200, sp.running_time / 4));
+    sp.seed = 0;
+    sp.map = CreateMap(state.range(3), state.range(2));
+    sp.data_per_second = 0.5;
+    sp.sensing_cost_range = mss::Range(2, 6, 0.5);
+    sp.transfer_cost_range = mss::Range(2, 6, 0.5);
+    sp.upload_cost_range = mss::Range(2, 6, 0.5);
+    sp.upload_limit_range = mss::Range(1, 3, 0.1);
+    return sp;
+  }
+
+  // Phones of sp, all active and moved for half of the running time.
+  void CreateMovedPhones(mss::ScenarioGenerator& sg, const mss::ScenarioParameters& sp, std::vector<mss::Phone>& phones) {
+    std::vector<std::vector<int> > start_phones;
+    sg.GeneratePhones(phones, start_phones);
+    for (int i = 0; i < phones.size(); ++i) {
+      phones[i].is_active_ = true;
+    }
+    for (int t = 0; t < sp.running_time / 2; ++t) {
+      for (int i = 0; i < phones.size(); ++i) {
+        phones[i].Move();
+      }
+    }
+  }
+
+  void StageArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"phones", "time", "targets", "scale"});
+    const int kPhoneCounts[] = {20, 50, 200};
+    const int kRunningTimes[] = {300, 900};
+    const int kTargetCounts[] = {5, 20};
+    const int kScales[] = {100, 200};
+    for (int p = 0; p < 3; ++p) {
+      for (int t = 0; t < 2; ++t) {
+        for (int m = 0; m < 2; ++m) {
+          for (int s = 0; s < 2; ++s) {
+            b->Args({kPhoneCounts[p], kRunningTimes[t], kTargetCounts[m], kScales[s]});
+          }
+        }
+      }
+    }
+  }
+
+  // Solvers are much slower, keep to the sizes phonesim runs.
+  void SolverArguments(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"phones", "time", "targets", "scale"});
+    b->Args({20, 300, 5, 100});
+    b->Args({50, 300, 5, 100});
+    b->Args({50, 900, 5, 100});
+    b->Args({50, 900, 20, 200});
+    b->Unit(benchmark::kMillisecond);
+  }
+
+  mss::SolverPtr CreateOptimal() {
+    return mss::SolverPtr(new mss::OptimalSolver());
+  }
+
+  mss::SolverPtr CreateHeuristic() {
+    return mss::SolverPtr(new mss::HeuristicSolver(kReportPeriod));
+  }
+
+  mss::SolverPtr CreateHeuristicDyn() {
+    return mss::SolverPtr(new mss::HeuristicDynSolver(kReportPeriod, 1.25));
+  }
+
+  mss::SolverPtr CreateAggressiveHeuristic() {
+    return mss::SolverPtr(new mss::AggressiveHeuristicSolver(kReportPeriod));
+  }
+
+  mss::SolverPtr CreateNaive() {
+    return mss::SolverPtr(new mss::NaiveSolver());
+  }
+}
+
+static void BM_GenerateScenario(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  std::vector<mss::Phone> phones;
+  std::vector<std::vector<int> > start_phones;
+  sg.GeneratePhones(phones, start_phones);
+  for (auto _ : state) {
+    mss::Scenario scen = sg.GenerateScenario(phones, start_phones);
+    benchmark::DoNotOptimize(scen.contacts.ContactCount());
+  }
+  state.SetItemsProcessed(state.iterations() * sp.running_time);
+}
+BENCHMARK(BM_GenerateScenario)->Apply(StageArguments)->Unit(benchmark::kMillisecond);
+
+// Same with contacts found on all hardware threads.
+static void BM_GenerateScenarioThreads(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  sg.SetThreadCount(0);
+  std::vector<mss::Phone> phones;
+  std::vector<std::vector<int> > start_phones;
+  sg.GeneratePhones(phones, start_phones);
+  for (auto _ : state) {
+    mss::Scenario scen = sg.GenerateScenario(phones, start_phones);
+    benchmark::DoNotOptimize(scen.contacts.ContactCount());
+  }
+  state.SetItemsProcessed(state.iterations() * sp.running_time);
+}
+BENCHMARK(BM_GenerateScenarioThreads)->ArgNames({"phones", "time", "targets", "scale"})
+    ->Args({200, 900, 20, 100})->Args({200, 900, 20, 200})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_GenerateAdjacencyMatrix(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  std::vector<mss::Phone> phones;
+  CreateMovedPhones(sg, sp, phones);
+  mss::PhoneGrid grid(sp.map.area_map_.length_, sp.map.area_map_.width_, sp.comm_range);
+  mss::ContactList contacts(1, sp.phone_count, sp.map.monitor_points_.size());
+  for (auto _ : state) {
+    sg.GenerateAdjacencyMatrix(phones, grid, contacts, 0);
+    benchmark::DoNotOptimize(contacts.Slice(0).ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * sp.phone_count);
+}
+BENCHMARK(BM_GenerateAdjacencyMatrix)->Apply(StageArguments);
+
+// Sensing check of moved phones against many monitor points.
+static void BM_SensingKernel(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  std::vector<mss::Phone> phones;
+  CreateMovedPhones(sg, sp, phones);
+  const mss::SensingKernel kernel(sp.map.monitor_points_, sp.sensing_range * sp.sensing_range);
+  mss::ContactList contacts(1, sp.phone_count, sp.map.monitor_points_.size());
+  for (auto _ : state) {
+    contacts.BeginSlice(0);
+    for (int i = 0; i < phones.size(); ++i) {
+      kernel.AddContacts(phones[i].GetLocation().x, phones[i].GetLocation().y, contacts, 0, i, sp.phone_count, 1);
+    }
+    contacts.EndSlice(0);
+    benchmark::DoNotOptimize(contacts.Slice(0).ids.data());
+  }
+  state.SetItemsProcessed(state.iterations() * sp.phone_count * sp.map.monitor_points_.size());
+}
+BENCHMARK(BM_SensingKernel)->ArgNames({"phones", "time", "targets", "scale"})
+    ->Args({200, 300, 20, 100})->Args({200, 300, 100, 100})->Args({200, 300, 500, 200});
+
+static void BM_ConvertToGraph(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  const mss::Scenario scen = sg.GenerateDefaultScenario();
+  mss::GraphConverter gc;
+  for (auto _ : state) {
+    gc.ConvertToGraph(scen);
+    benchmark::DoNotOptimize(gc.GetGraph().edge_count);
+  }
+  state.counters["edges"] = gc.GetGraph().edge_count;
+}
+BENCHMARK(BM_ConvertToGraph)->Apply(StageArguments)->Unit(benchmark::kMillisecond);
+
+// Same with the graph built on all hardware threads.
+static void BM_ConvertToGraphThreads(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  const mss::Scenario scen = sg.GenerateDefaultScenario();
+  mss::GraphConverter gc;
+  gc.SetThreadCount(0);
+  for (auto _ : state) {
+    gc.ConvertToGraph(scen);
+    benchmark::DoNotOptimize(gc.GetGraph().edge_count);
+  }
+  state.counters["edges"] = gc.GetGraph().edge_count;
+}
+BENCHMARK(BM_ConvertToGraphThreads)->Apply(StageArguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_ConvertToEventGraph(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  const mss::Scenario scen = sg.GenerateDefaultScenario();
+  mss::GraphConverter gc;
+  for (auto _ : state) {
+    gc.ConvertToEventGraph(scen);
+    benchmark::DoNotOptimize(gc.GetGraph().edge_count);
+  }
+  state.counters["edges"] = gc.GetGraph().edge_count;
+}
+BENCHMARK(BM_ConvertToEventGraph)->Apply(StageArguments)->Unit(benchmark::kMillisecond);
+
+static void BM_PhoneMove(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  std::vector<mss::Phone> phones;
+  int step = sp.running_time;
+  for (auto _ : state) {
+    // Start over before most phones have left the map.
+    if (step == sp.running_time) {
+      state.PauseTiming();
+      CreateMovedPhones(sg, sp, phones);
+      step = sp.running_time / 2;
+      state.ResumeTiming();
+    }
+    for (int i = 0; i < phones.size(); ++i) {
+      phones[i].Move();
+    }
+    ++step;
+  }
+  state.SetItemsProcessed(state.iterations() * sp.phone_count);
+}
+BENCHMARK(BM_PhoneMove)->Apply(StageArguments);
+
+static void BM_MobilityStep(benchmark::State& state) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  std::vector<mss::Phone> phones;
+  mss::MobilityEngine engine(sp.map.area_map_);
+  int step = sp.running_time;
+  for (auto _ : state) {
+    if (step == sp.running_time) {
+      state.PauseTiming();
+      CreateMovedPhones(sg, sp, phones);
+      engine.Load(phones);
+      step = sp.running_time / 2;
+      state.ResumeTiming();
+    }
+    engine.Step();
+    ++step;
+  }
+  state.SetItemsProcessed(state.iterations() * sp.phone_count);
+}
+BENCHMARK(BM_MobilityStep)->Apply(StageArguments);
+
+static void BM_Solve(benchmark::State& state, mss::SolverPtr (*create_solver)()) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  const mss::Scenario scen = sg.GenerateDefaultScenario();
+  for (auto _ : state) {
+    mss::SolverPtr solver = create_solver();
+    solver->SetMILP(false);
+    mss::Result r = solver->Solve(scen);
+    benchmark::DoNotOptimize(r.all_cost);
+  }
+}
+BENCHMARK_CAPTURE(BM_Solve, Optimal, &CreateOptimal)->Apply(SolverArguments);
+BENCHMARK_CAPTURE(BM_Solve, Heuristic, &CreateHeuristic)->Apply(SolverArguments);
+BENCHMARK_CAPTURE(BM_Solve, HeuristicDyn, &CreateHeuristicDyn)->Apply(SolverArguments);
+BENCHMARK_CAPTURE(BM_Solve, AggressiveHeuristic, &CreateAggressiveHeuristic)->Apply(SolverArguments);
+BENCHMARK_CAPTURE(BM_Solve, Naive, &CreateNaive)->Apply(SolverArguments);
+
+// Min cost flow engines on the graph with one vertex per phone and second.
+static void BM_FlowEngine(benchmark::State& state, mss::FlowEngine engine) {
+  const mss::ScenarioParameters sp = CreateParameters(state);
+  mss::ScenarioGenerator sg(sp);
+  const mss::Scenario scen = sg.GenerateDefaultScenario();
+  mss::GraphConverter gc;
+  gc.ConvertToGraph(scen);
+  mss::FlowAdapterPtr flow_adapter = mss::FlowAdapterFactory::Create(engine);
+  for (auto _ : state) {
+    mss::Solution s;
+    flow_adapter->Solve(gc.GetGraph(), s);
+    benchmark::DoNotOptimize(s.obj);
+  }
+  state.counters["edges"] = gc.GetGraph().edge_count;
+}
+BENCHMARK_CAPTURE(BM_FlowEngine, NetworkSimplex, mss::NETWORK_SIMPLEX_ENGINE)->Apply(SolverArguments);
+BENCHMARK_CAPTURE(BM_FlowEngine, SuccessivePath, mss::SUCCESSIVE_PATH_ENGINE)->Apply(SolverArguments);
+BENCHMARK_CAPTURE(BM_FlowEngine, CostScaling, mss::COST_SCALING_ENGINE)->Apply(SolverArguments);
+
+int main(int argc, char** argv) {
+  // Keep log files out of the measurements. No channel has created
+  // its file yet.
+  mss::SimLog::IsLog = false;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -18,6 +18,13 @@ namespace mobile_sensing_sim {
     Result r(scen.phone_count);
     
     GraphConverter gc;
+    gc.SetThreadCount(GetGraphThreadCount());
+    FlowAdapterPtr flow_adapter = FlowAdapterFactory::Create(GetFlowEngine(), GetFlowThreadCount());
+#ifndef PHONESIM_WITH_CPLEX
+    if (UseMILP()) {
+      ErrorHandler::RunningWarning("Aggressive heuristic algorithm: MILP refinement requires CPLEX and is skipped.");
+    }
+#endif
     
     // Copy phones used in generating scenario.
     std::vector<Phone> phones = scen.phones;
@@ -50,8 +57,7 @@ namespace mobile_sensing_sim {
     
     // Define data capacity vector to store phone's data transfers
     // (including sensing) over time.
-    ThreeDimVector<double> phone_datatrans(scen.running_time, scen.phone_count, scen.phone_count + scen.target_count);
-    phone_datatrans.Fill(0.0);
+    ContactList phone_datatrans(scen.running_time, scen.phone_count, scen.target_count);
     
     // Start create and write scenario.
     ahlog << "\n";
@@ -103,19 +109,17 @@ namespace mobile_sensing_sim {
       // previous data sensings and transfers.
       ahlog << "Adjust adjacency matrices and data capacity matrices based on previous data transfers...\n";
       for (int prevt = 0; prevt < t; ++prevt) {
-        ThreeDimVector<double> &datatrans = phone_datatrans;
+        const ContactSlice &datatrans = phone_datatrans.Slice(prevt);
         for (int i = 0; i < scen.phone_count; ++i) {
-          for (int j = 0; j < scen.phone_count + scen.target_count; ++j) {
-            if (datatrans(prevt, i, j) != 0.0) {
+          for (int k = datatrans.offsets[i]; k < datatrans.offsets[i + 1]; ++k) {
+            const int j = datatrans.ids[k];
+            if (datatrans.data[k] != 0.0) {
               // If previous action is found
-              // 1. Set corresponding edge in adjacency matrix.
-              // 2. Set capacity of the edge to be transferred
+              // 1. Set corresponding contact.
+              // 2. Set capacity of the contact to be transferred
               //    amount of data.
-              ahlog << "Previous data transfer / sensing found from vertex at time " << prevt << ": " << i << " to " << j << ", data amount: " << datatrans(prevt, i, j) << ".\n";
-              ThreeDimVector<int> &ams = cur_scen.adj_mats;
-              ams(prevt, i, j) = 1;
-              ThreeDimVector<double> &dms = cur_scen.data_mats;
-              dms(prevt, i, j) = datatrans(prevt, i, j);
+              SIMLOG_TRACE(ahlog) << "Previous data transfer / sensing found from vertex at time " << prevt << ": " << i << " to " << j << ", data amount: " << datatrans.data[k] << ".\n";
+              cur_scen.contacts.SetContact(prevt, i, j, datatrans.data[k]);
             }
           }
         }
@@ -133,12 +137,13 @@ namespace mobile_sensing_sim {
       // Solve converted graph.
       ahlog << "Solve converted graph...\n";
       Solution cur_s;
-      bool solution_status = cplex_adapter_.Solve(gc.GetGraph(), cur_s);
+      bool solution_status = flow_adapter->Solve(gc.GetGraph(), cur_s);
       if (!solution_status) {
-        ErrorHandler::RunningError("Cplex solver does not run successfully!");
+        ErrorHandler::RunningError("Flow solver does not run successfully!");
       }
       
-      if (UseMILP() && cur_s.solution_status == CPX_STAT_OPTIMAL) {
+#ifdef PHONESIM_WITH_CPLEX
+      if (UseMILP() && cur_s.solution_status == Solution::OPTIMAL) {
         // If feasible, try MILP
         Solution milp_s;
         bool status = cplex_milp_adapter_.Solve(gc.GetGraph(), milp_s);
@@ -147,6 +152,7 @@ namespace mobile_sensing_sim {
           cur_s = milp_s;
         }
       }
+#endif
       
       r.is_valid = cur_s.is_valid;
       r.solution_status = cur_s.solution_status;
@@ -155,10 +161,10 @@ namespace mobile_sensing_sim {
       // Execute actions returned by cplex solver.
       // Costs are added to final objective value.
       ahlog << "Executing actions in the returned solution...\n";
-      const std::vector<Edge>& edges = gc.GetEdges();
-      assert(edges.size() == cur_s.edge_values.size());
-      for (int i = 0; i < edges.size(); ++i) {
-        const Edge& e = edges[i];
+      const Graph& graph = gc.GetGraph();
+      assert(graph.edge_count == cur_s.edge_values.size());
+      for (int i = 0; i < graph.edge_count; ++i) {
+        const Edge e = graph.GetEdge(i);
         if (cur_s.edge_values[i] == 0 || e.type == Edge::PHONE_TO_SELF || e.type == Edge::PHONE_TO_SINK) {
           continue;
         }
@@ -170,19 +176,19 @@ namespace mobile_sensing_sim {
         }
         
         if (e.time >= t && e.time < t + report_period_) {
-          ThreeDimVector<double> &datatrans = phone_datatrans;
+          ContactList &datatrans = phone_datatrans;
           double value = cur_s.edge_values[i];
-          const ThreeDimVector<int> &ams = scen.adj_mats;
+          const ContactList &ams = scen.contacts;
           if (e.type == Edge::TARGET_TO_PHONE) {
             assert(e.phone1_id != -1 && e.target_seqid != -1);
             
             // Make sure target is still in sensing range of the phone
-            if (target_uploaded[e.target_seqid] != 1.0 && data_received[e.phone1_id][e.target_seqid] != 1.0 && ams(e.time, e.phone1_id, e.target_id) != 0.0) {
-              ahlog << "Sensing action executed: phone " << e.phone1_id << " at target " << e.target_id << " at time " << e.time << ".\n";
+            if (target_uploaded[e.target_seqid] != 1.0 && data_received[e.phone1_id][e.target_seqid] != 1.0 && ams.IsConnected(e.time, e.phone1_id, e.target_id)) {
+              SIMLOG_TRACE(ahlog) << "Sensing action executed: phone " << e.phone1_id << " at target " << e.target_id << " at time " << e.time << ".\n";
               // Does not allow sensing part of the target.
               // Set data amount to be 1.0 all the time.
               //datatrans[e.phone1_id][e.target_id] = value;
-              datatrans(e.time, e.phone1_id, e.target_id) = 1.0;
+              datatrans.SetContact(e.time, e.phone1_id, e.target_id, 1.0);
               double sensing_cost = scen.phones[e.phone1_id].costs_.sensing_cost * value;
               r.AddCost(e.phone1_id, sensing_cost, Cost::SENSING);
               
@@ -190,19 +196,19 @@ namespace mobile_sensing_sim {
               data_received[e.phone1_id][e.target_seqid] = 1.0;
               
             } else {
-              ahlog << "Sensing action aborted: phone " << e.phone1_id << " is out of the range of target or the target is fully uploaded." << e.target_id << " at time " << e.time << ".\n";
+              SIMLOG_TRACE(ahlog) << "Sensing action aborted: phone " << e.phone1_id << " is out of the range of target or the target is fully uploaded." << e.target_id << " at time " << e.time << ".\n";
             }
           } else if (e.type == Edge::PHONE_TO_PHONE) {
             assert(e.phone1_id != -1 && e.phone2_id != -1);
             // Make sure two phones are still in communication range
             // of each other.
-            if (ams(e.time, e.phone1_id, e.phone2_id) != 0.0) {
-              ahlog << "Data transfer executed: phone " << e.phone1_id << " to phone " << e.phone2_id << ", data amount: " << cur_s.edge_values[i] << " at time " << e.time << ".\n";
-              datatrans(e.time, e.phone1_id, e.phone2_id) = value;
+            if (ams.IsConnected(e.time, e.phone1_id, e.phone2_id)) {
+              SIMLOG_TRACE(ahlog) << "Data transfer executed: phone " << e.phone1_id << " to phone " << e.phone2_id << ", data amount: " << cur_s.edge_values[i] << " at time " << e.time << ".\n";
+              datatrans.SetContact(e.time, e.phone1_id, e.phone2_id, value);
               double comm_cost = (scen.phones[e.phone1_id].costs_.transfer_cost + scen.phones[e.phone2_id].costs_.transfer_cost) * value;
               r.AddCost(e.phone1_id, comm_cost, Cost::COMM);
             } else {
-              ahlog << "Data transfer aborted: phone " << e.phone1_id << " if out of the range of phone " << e.phone2_id << " at time " << e.time << ".\n";
+              SIMLOG_TRACE(ahlog) << "Data transfer aborted: phone " << e.phone1_id << " if out of the range of phone " << e.phone2_id << " at time " << e.time << ".\n";
             }
           } else {
             ErrorHandler::RunningError("Aggressive heuristic algorithm: Unkown edge type is found while executing actions returned by cplex solver!");
@@ -213,20 +219,20 @@ namespace mobile_sensing_sim {
       // Compute uploading cost seperately.
       double diff = current_upload_amount - previous_upload_amount;
       if (diff > 0.0) {
-        for (int i = 0; i < edges.size(); ++i) {
-          const Edge& e = edges[i];
+        for (int i = 0; i < graph.edge_count; ++i) {
+          const Edge e = graph.GetEdge(i);
           if (cur_s.edge_values[i] == 0 || e.type == Edge::PHONE_TO_SELF) {
             continue;
           }
           if (e.time >= t && e.time < t + report_period_) {
-            ThreeDimVector<double> &datatrans = phone_datatrans;
+            ContactList &datatrans = phone_datatrans;
             double value = cur_s.edge_values[i];
-            const ThreeDimVector<int> &ams = scen.adj_mats;
+            const ContactList &ams = scen.contacts;
             if (e.type == Edge::PHONE_TO_SINK) {
               // Plus uploading cost.
               
               assert(e.phone1_id != -1);
-              ahlog << "Uploading executed: phone " << e.phone1_id << ", data amount: " << value << ".\n";
+              SIMLOG_TRACE(ahlog) << "Uploading executed: phone " << e.phone1_id << ", data amount: " << value << ".\n";
               
               // Only count in recent uploads.
               if (diff > 0) {
@@ -274,7 +280,7 @@ namespace mobile_sensing_sim {
         ahlog << "Objective status: " << cur_s.solution_status << "\n";
         for (int i = 0; i < cur_s.edge_values.size(); ++i) {
           if (cur_s.edge_values[i] != 0.0 && gc.GetEdge(i).type != Edge::PHONE_TO_SELF) {
-            ahlog << "name: " << gc.GetEdge(i).name << "\t value: " << cur_s.edge_values[i] << "\n";
+            SIMLOG_TRACE(ahlog) << "name: " << gc.GetEdgeName(i) << "\t value: " << cur_s.edge_values[i] << "\n";
           }
         }
         return r;
@@ -291,10 +297,10 @@ namespace mobile_sensing_sim {
           }
           int target_id = j + scen.phone_count;
           for (int k = t; k < t + report_period_; ++k) {
-            const ThreeDimVector<int> &ams = scen.adj_mats;
-            if (data_received[i][j] != 1.0 && ams(k, i, target_id) != 0.0 ) {
-              ThreeDimVector<double> &datatrans = phone_datatrans;
-              datatrans(k, i, j) = 1.0;
+            const ContactList &ams = scen.contacts;
+            if (data_received[i][j] != 1.0 && ams.IsConnected(k, i, target_id) ) {
+              ContactList &datatrans = phone_datatrans;
+              datatrans.SetContact(k, i, j, 1.0);
               double sensing_cost = scen.phones[i].costs_.sensing_cost;
               r.AddCost(i, sensing_cost, Cost::SENSING);
               
@@ -336,7 +342,7 @@ namespace mobile_sensing_sim {
         ahlog << "Objective status: " << cur_s.solution_status << "\n";
         for (int i = 0; i < cur_s.edge_values.size(); ++i) {
           if (cur_s.edge_values[i] != 0.0 && gc.GetEdge(i).type != Edge::PHONE_TO_SELF) {
-            ahlog << "name: " << gc.GetEdge(i).name << "\t value: " << cur_s.edge_values[i] << "\n";
+            SIMLOG_TRACE(ahlog) << "name: " << gc.GetEdgeName(i) << "\t value: " << cur_s.edge_values[i] << "\n";
           }
         }
       }
@@ -10,8 +10,10 @@
 #define __PhoneSim__agg_heuristic_solver__
 
 #include "../solver_base.h"
+#include "../optimal_solver/flow_adapter_factory.h"
+#ifdef PHONESIM_WITH_CPLEX
 #include "../optimal_solver/cplex_milp_adapter.h"
-#include "../optimal_solver/cplex_adapter.h"
+#endif
 
 namespace mobile_sensing_sim {
 	class AggressiveHeuristicSolver : public SolverBase {
@@ -20,8 +22,9 @@ namespace mobile_sensing_sim {
 		}
 		virtual Result Solve(const Scenario& scen);
 	private:
+#ifdef PHONESIM_WITH_CPLEX
 		CplexMILPAdapter cplex_milp_adapter_;
-		CplexAdapter cplex_adapter_;
+#endif
 		const int report_period_;
 	};
 }
@@ -0,0 +1,52 @@
+//
+//  bit_matrix.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/27/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__bit_matrix__
+#define __PhoneSim__bit_matrix__
+
+#include <vector>
+#include <boost/cstdint.hpp>
+
+namespace mobile_sensing_sim {
+	// Rows of bits packed into 64 bit words, e.g. which targets' data
+	// each phone holds. Set operations on rows work a word at a time.
+	class BitMatrix {
+	public:
+		typedef boost::uint64_t Word;
+		static const int kWordBits = 64;
+
+		BitMatrix(int rows, int columns) : words_per_row_((columns + kWordBits - 1) / kWordBits), bits_(rows * words_per_row_, 0) {}
+
+		int WordCount() const {
+			return words_per_row_;
+		}
+		Word* Row(int r) {
+			return bits_.empty() ? NULL : &bits_[r * words_per_row_];
+		}
+		const Word* Row(int r) const {
+			return bits_.empty() ? NULL : &bits_[r * words_per_row_];
+		}
+
+		bool Test(int r, int c) const {
+			return (bits_[r * words_per_row_ + c / kWordBits] >> (c % kWordBits) & 1) != 0;
+		}
+		void Set(int r, int c) {
+			bits_[r * words_per_row_ + c / kWordBits] |= Word(1) << (c % kWordBits);
+		}
+
+		// Index of the lowest set bit of a non zero word.
+		static int LowestBit(Word w) {
+			return __builtin_ctzll(w);
+		}
+	private:
+		int words_per_row_;
+		std::vector<Word> bits_;
+	};
+}
+
+#endif /* defined(__PhoneSim__bit_matrix__) */
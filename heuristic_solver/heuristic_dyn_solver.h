@@ -10,9 +10,11 @@
 #define __MobileSensingSim__heuristic_dyn_solver__
 
 #include "../solver_base.h"
+#include "../optimal_solver/flow_adapter_factory.h"
+#ifdef PHONESIM_WITH_CPLEX
 #include "../optimal_solver/cplex_milp_adapter.h"
-#include "../optimal_solver/cplex_adapter.h"
 #include "../optimal_solver/cplex_balance_adapter.h"
+#endif
 
 namespace mobile_sensing_sim {
 	class HeuristicDynSolver : public SolverBase{
@@ -21,8 +23,10 @@ namespace mobile_sensing_sim {
 		Result Solve(const Scenario& scen);
 	private:
     virtual void IncreaseCost(Phone &p) const;
+#ifdef PHONESIM_WITH_CPLEX
 		CplexMILPAdapter cplex_milp_adapter_;
     CplexBalanceAdapter cplex_balance_adapter_;
+#endif
     
 		const int report_period_;
     double multiple_;
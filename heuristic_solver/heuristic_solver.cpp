@@ -18,7 +18,14 @@ namespace mobile_sensing_sim {
     hlog << "*********************************************\n";
     Result r(scen.phone_count);
     
-    GraphConverter gc;
+    RollingGraphConverter gc;
+    gc.Init(scen);
+    FlowAdapterPtr flow_adapter = FlowAdapterFactory::Create(GetFlowEngine(), GetFlowThreadCount());
+#ifndef PHONESIM_WITH_CPLEX
+    if (UseMILP() || use_balance_) {
+      ErrorHandler::RunningWarning("Heuristic algorithm: MILP and balance refinements require CPLEX and are skipped.");
+    }
+#endif
     
     // Copy phones used in generating scenario.
     std::vector<Phone> phones = scen.phones;
@@ -40,20 +47,16 @@ namespace mobile_sensing_sim {
     
     //**************************************************
     // Start simulated walk.
-    // 1. Construct graph based on current locations.
-    // 2. Adjust graph based on previous actions.
+    // 1. Predict contacts based on current locations.
+    // 2. Update graph: layers before t only keep previous actions.
     //    a. Add edge at t if action happens at time t
     //    b. The capacity of the edge is how much data transferred at the moment.
+    //    Layers from t on are replaced by the prediction.
     // 3. Solve converted graph by cplex solver.
     // 4. Execute actions returned by cplex solver.
     // 5. Phones move according to generated scenario.
     //**************************************************
     
-    // Define data capacity vector to store phone's data transfers
-    // (including sensing) over time.
-    ThreeDimVector<double> phone_datatrans(scen.running_time, scen.phone_count, scen.phone_count + scen.target_count);
-    phone_datatrans.Fill(0.0);
-    
     // Start create and write scenario.
     hlog << "\n";
     hlog << "*********************************************\n";
@@ -79,36 +82,15 @@ namespace mobile_sensing_sim {
         }
       }
       
-      // Construct graph based on current locations
+      // Predict contacts based on current locations
       // and empty phone start vector.
       ScenarioGenerator sg(scen.scen_param);
       Scenario cur_scen = sg.GenerateScenario(phones, start_phones, t);
       
-      // Adjust adj mats and data mats based on
-      // previous data sensings and transfers.
-      hlog << "Adjust adjacency matrices and data capacity matrices based on previous data transfers...\n";
-      for (int prevt = 0; prevt < t; ++prevt) {
-        ThreeDimVector<double> &datatrans = phone_datatrans;
-        for (int i = 0; i < scen.phone_count; ++i) {
-          for (int j = 0; j < scen.phone_count + scen.target_count; ++j) {
-            if (datatrans(prevt, i, j) != 0.0) {
-              // If previous action is found
-              // 1. Set corresponding edge in adjacency matrix.
-              // 2. Set capacity of the edge to be transferred
-              //    amount of data.
-              hlog << "Previous data transfer / sensing found from vertex at time " << prevt << ": " << i << " to " << j << ", data amount: " << datatrans(prevt, i, j) << ".\n";
-              ThreeDimVector<int> &ams = cur_scen.adj_mats;
-              ams(prevt, i, j) = 1;
-              ThreeDimVector<double> &dms = cur_scen.data_mats;
-              dms(prevt, i, j) = datatrans(prevt, i, j);
-            }
-          }
-        }
-      }
-      
-      // Convert scenario to graph.
-      hlog << "Converting adjusted scenario to graph...\n";
-      gc.ConvertToGraph(cur_scen);
+      // Freeze layers before t with the actions executed there
+      // and replace the predicted layers from t on.
+      hlog << "Updating graph with previous data transfers and predicted contacts...\n";
+      gc.SetPrediction(cur_scen.contacts, t);
       
       // Solve converted graph.
       hlog << "Solve converted graph...\n";
@@ -116,14 +98,14 @@ namespace mobile_sensing_sim {
       bool is_success = false;
       
       hlog << "Try optimal solver first...\n";
-      CplexAdapter cplex_adapter;
-      is_success = cplex_adapter.Solve(gc.GetGraph(), cur_s);
+      is_success = flow_adapter->Resolve(gc.GetGraph(), gc.GetDelta(), cur_s);
       
       if (!is_success) {
-        ErrorHandler::RunningWarning("Cplex solver does not run successfully!");
+        ErrorHandler::RunningWarning("Flow solver does not run successfully!");
         continue;
       }
       
+#ifdef PHONESIM_WITH_CPLEX
       if (use_balance_) {
         Solution bal_s;
         cplex_balance_adapter_.SetMILP(false);
@@ -134,7 +116,7 @@ namespace mobile_sensing_sim {
         }
       }
       
-      if (UseMILP() && cur_s.solution_status == CPX_STAT_OPTIMAL) {
+      if (UseMILP() && cur_s.solution_status == Solution::OPTIMAL) {
         // If feasible, try MILP
         Solution milp_s;
         is_success = false;
@@ -150,6 +132,7 @@ namespace mobile_sensing_sim {
           cur_s = milp_s;
         }
       }
+#endif
       
       r.is_valid = cur_s.is_valid;
       r.solution_status = cur_s.solution_status;
@@ -158,47 +141,46 @@ namespace mobile_sensing_sim {
       // Execute actions returned by cplex solver.
       // Costs are added to final objective value.
       hlog << "Executing actions in the returned solution...\n";
-      const std::vector<Edge>& edges = gc.GetEdges();
-      assert(edges.size() == cur_s.edge_values.size());
-      for (int i = 0; i < edges.size(); ++i) {
-        const Edge& e = edges[i];
+      const Graph& graph = gc.GetGraph();
+      assert(graph.edge_count == cur_s.edge_values.size());
+      for (int i = 0; i < graph.edge_count; ++i) {
+        const Edge e = graph.GetEdge(i);
         if (cur_s.edge_values[i] == 0 || e.type == Edge::PHONE_TO_SELF || e.type == Edge::SRC_TO_TARGET) {
           continue;
         }
         if (e.time >= t && e.time < t + report_period_) {
-          ThreeDimVector<double> &datatrans = phone_datatrans;
           double value = cur_s.edge_values[i];
-          const ThreeDimVector<int> &ams = scen.adj_mats;
+          const ContactList &ams = scen.contacts;
           if (e.type == Edge::TARGET_TO_PHONE) {
             assert(e.phone1_id != -1 && e.target_id != -1);
             // Make sure target is still in sensing range of the phone
-            if (ams(e.time, e.phone1_id, e.target_id) != 0.0) {
-              hlog << "Sensing action executed: phone " << e.phone1_id << " at target " << e.target_id << " at time " << e.time << ".\n";
+            if (ams.IsConnected(e.time, e.phone1_id, e.target_id)) {
+              SIMLOG_TRACE(hlog) << "Sensing action executed: phone " << e.phone1_id << " at target " << e.target_id << " at time " << e.time << ".\n";
               // Does not allow sensing part of the target.
               // Set data amount to be 1.0 all the time.
               //datatrans[e.phone1_id][e.target_id] = value;
-              datatrans(e.time, e.phone1_id, e.target_id) = 1.0;
+              gc.SetExecuted(e.time, e.phone1_id, e.target_id, 1.0);
               double sensing_cost = scen.phones[e.phone1_id].costs_.sensing_cost * value;
               r.AddCost(e.phone1_id, sensing_cost, Cost::SENSING);
             } else {
-              hlog << "Sensing action aborted: phone " << e.phone1_id << " is out of the range of target " << e.target_id << " at time " << e.time << ".\n";
+              SIMLOG_TRACE(hlog) << "Sensing action aborted: phone " << e.phone1_id << " is out of the range of target " << e.target_id << " at time " << e.time << ".\n";
             }
           } else if (e.type == Edge::PHONE_TO_PHONE) {
             assert(e.phone1_id != -1 && e.phone2_id != -1);
             // Make sure target is still in sensing range of the phone
-            if (ams(e.time, e.phone1_id, e.phone2_id) != 0.0) {
-              hlog << "Data transfer executed: phone " << e.phone1_id << " to phone " << e.phone2_id << ", data amount: " << cur_s.edge_values[i] << " at time " << e.time << ".\n";
-              datatrans(e.time, e.phone1_id, e.phone2_id) = value;
+            if (ams.IsConnected(e.time, e.phone1_id, e.phone2_id)) {
+              SIMLOG_TRACE(hlog) << "Data transfer executed: phone " << e.phone1_id << " to phone " << e.phone2_id << ", data amount: " << cur_s.edge_values[i] << " at time " << e.time << ".\n";
+              gc.SetExecuted(e.time, e.phone1_id, e.phone2_id, value);
               double comm_cost = (scen.phones[e.phone1_id].costs_.transfer_cost + scen.phones[e.phone2_id].costs_.transfer_cost) * value;
               r.AddCost(e.phone1_id, comm_cost, Cost::COMM);
             } else {
-              hlog << "Data transfer aborted: phone " << e.phone1_id << " if out of the range of phone " << e.phone2_id << " at time " << e.time << ".\n";
+              SIMLOG_TRACE(hlog) << "Data transfer aborted: phone " << e.phone1_id << " if out of the range of phone " << e.phone2_id << " at time " << e.time << ".\n";
             }
           } else if (e.type == Edge::PHONE_TO_SINK) {
             // Plus uploading cost at last iteration.
             if (t == scen.running_time - 1 || t + report_period_ >= scen.running_time) {
               assert(e.phone1_id != -1);
-              hlog << "Uploading executed: phone " << e.phone1_id << ", data amount: " << value << ".\n";
+              SIMLOG_TRACE(hlog) << "Uploading executed: phone " << e.phone1_id << ", data amount: " << value << ".\n";
               double upload_cost = scen.phones[e.phone1_id].costs_.upload_cost * value;
               r.AddCost(e.phone1_id, upload_cost, Cost::UPLOAD);
             }
@@ -254,7 +236,7 @@ namespace mobile_sensing_sim {
         hlog << "Objective status: " << cur_s.solution_status << "\n";
         for (int i = 0; i < cur_s.edge_values.size(); ++i) {
           if (cur_s.edge_values[i] != 0.0 && gc.GetEdge(i).type != Edge::PHONE_TO_SELF) {
-            hlog << "name: " << gc.GetEdge(i).name << "\t value: " << cur_s.edge_values[i] << "\n";
+            SIMLOG_TRACE(hlog) << "name: " << gc.GetEdgeName(i) << "\t value: " << cur_s.edge_values[i] << "\n";
           }
         }
       }
@@ -10,9 +10,12 @@
 #define __MobileSensingSim__heuristic_solver__
 
 #include "../solver_base.h"
+#include "../optimal_solver/flow_adapter_factory.h"
+#include "../optimal_solver/rolling_graph_converter.h"
+#ifdef PHONESIM_WITH_CPLEX
 #include "../optimal_solver/cplex_milp_adapter.h"
-#include "../optimal_solver/cplex_adapter.h"
 #include "../optimal_solver/cplex_balance_adapter.h"
+#endif
 
 namespace mobile_sensing_sim {
 	class HeuristicSolver : public SolverBase{
@@ -20,8 +23,10 @@ namespace mobile_sensing_sim {
 		HeuristicSolver(const int report_period, bool use_balance = false) : report_period_(report_period), use_balance_(use_balance) {}
 		Result Solve(const Scenario& scen);
 	private:
+#ifdef PHONESIM_WITH_CPLEX
 		CplexMILPAdapter cplex_milp_adapter_;
     CplexBalanceAdapter cplex_balance_adapter_;
+#endif
     
 		const int report_period_;
     bool use_balance_;
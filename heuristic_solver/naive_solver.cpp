@@ -6,10 +6,55 @@
 //  Copyright (c) 2014 Yuan. All rights reserved.
 //
 
+#include <iterator>
+#include <algorithm>
 #include "naive_solver.h"
+#include "bit_matrix.h"
 #include "../simlog.h"
 
 namespace mobile_sensing_sim {
+  namespace {
+    // Phones taking a turn in each second. A phone only acts when it
+    // has contacts, or when it holds data and upload budget, which it
+    // spends in its next turn. Budget left after a turn means the
+    // storage is empty, and data only arrives over a contact, so a
+    // phone with contacts in one second is the only kind that may need
+    // a turn without contacts in the next.
+    class TurnQueue {
+    public:
+      // Phones of second time in increasing order: phones with contacts
+      // and phones kept in the second before.
+      const std::vector<int>& Begin(const ContactList& contacts, int time) {
+        contacts.NonEmptyRows(time, rows_);
+        // A contact with itself alone is no opportunity.
+        const ContactSlice &slice = contacts.Slice(time);
+        int count = 0;
+        for (int k = 0; k < rows_.size(); ++k) {
+          const int kRow = rows_[k];
+          if (slice.offsets[kRow + 1] - slice.offsets[kRow] > 1 || slice.ids[slice.offsets[kRow]] != kRow) {
+            rows_[count++] = kRow;
+          }
+        }
+        rows_.resize(count);
+        
+        turns_.clear();
+        std::set_union(rows_.begin(), rows_.end(), kept_.begin(), kept_.end(), std::back_inserter(turns_));
+        kept_.clear();
+        return turns_;
+      }
+      
+      // Give phone a turn in the next second. Phones are kept in
+      // increasing order.
+      void Keep(int phone) {
+        kept_.push_back(phone);
+      }
+    private:
+      std::vector<int> rows_;
+      std::vector<int> kept_;
+      std::vector<int> turns_;
+    };
+  }
+  
   Result NaiveSolver::Solve(const Scenario &scen) {
     if (UseMILP()) {
       return SolveMILP(scen);
@@ -21,26 +66,24 @@ namespace mobile_sensing_sim {
   Result NaiveSolver::SolveMILP(const Scenario &scen) {
     nlog.Reset();
     Result r(scen.phone_count);
+    const int kTargetCount = scen.target_count;
     
-    // Create global required data info.
-    // (i, j): celluar tower's knowledge on how much more data
-    // of target j sensed by phone i has yet to be uploaded.
+    // Global required data info, indexed by key i * target count + j.
+    // Celluar tower's knowledge on how much more data of target j
+    // sensed by phone i has yet to be uploaded.
     // Initialized with 1.0: all need to be uploaded.
-    DataInfo data_required;
-    for (int i = 0; i < scen.phone_count; ++i) {
-      for (int j = 0; j < scen.target_count; ++j) {
-        data_required[std::make_pair(i, j)] = 1.0;
-      }
-    }
+    std::vector<double> data_required(scen.phone_count * kTargetCount, 1.0);
     
     // Create target status.
-    // False: not uploaded yet. True: uploaded.
-    std::vector<bool> target_status(scen.target_count, false);
+    // Bit j set: uploaded.
+    BitMatrix target_status(1, kTargetCount);
     
-    // Create phone data matrix
-    // Each phone has a data info matrix indicating
-    // how much sensing data (associated with phones) it currently has.
-    std::vector<DataInfo> phone_datas(scen.phone_count);
+    // Create phone data storage.
+    // Sorted keys of the sensing data each phone currently has. A phone
+    // always holds data_required of its keys once it updated its
+    // storage, so amounts need not be stored.
+    std::vector<std::vector<int> > phone_datas(scen.phone_count);
+    std::vector<int> received;
     
     // Copy phones upload limits.
     std::vector<double> upload_limits(scen.phone_count, 0.0);
@@ -54,47 +97,48 @@ namespace mobile_sensing_sim {
     nlog << "Start simulated walk: \n";
     nlog << "*********************************************\n";
     
+    // Phones without contacts, data or budget are skipped.
+    TurnQueue turns;
+    int uploaded_count = 0;
     for (int t = 0; t < scen.running_time; ++t) {
       nlog << "\n";
       nlog << "*********************************************\n";
       nlog << "Time: " << t << ":\n";
-      const ThreeDimVector<int> &am = scen.adj_mats;
-      const ThreeDimVector<double> &dm = scen.data_mats;
-      for (int i = 0; i < scen.phone_count; ++i) {
-        DataInfo &di = phone_datas[i];
+      const ContactSlice &slice = scen.contacts.Slice(t);
+      const std::vector<int> &phones = turns.Begin(scen.contacts, t);
+      for (int p = 0; p < phones.size(); ++p) {
+        const int i = phones[p];
+        std::vector<int> &di = phone_datas[i];
+        // Row i: phone contacts first, then target contacts.
+        const int kRowBegin = slice.offsets[i];
+        const int kRowEnd = slice.offsets[i + 1];
+        const int kTargetBegin = std::lower_bound(slice.ids.begin() + kRowBegin, slice.ids.begin() + kRowEnd, scen.phone_count) - slice.ids.begin();
         
         // Update data storage as all or part of targets' data
         // may have been uploaded.
-        //nlog << "Phone " << i << " update data storage...\n";
-        if (!di.empty()) {
-          for (DataInfo::iterator it = di.begin(); it != di.end();) {
-            int tid = (*it).first.second;
-            if (target_status[tid] == true) {
-              di.erase(it++);
-            } else {
-              double data = (*it).second;
-              std::pair<int, int> phone_target = (*it).first;
-              if (data > data_required[phone_target]) {
-                (*it).second = data_required[phone_target];
-              }
-              ++it;
-            }
+        int kept = 0;
+        for (int k = 0; k < di.size(); ++k) {
+          if (!target_status.Test(0, di[k] % kTargetCount)) {
+            di[kept++] = di[k];
           }
         }
+        di.resize(kept);
         
         // Check if we can sense any target.
-        for (int j = 0; j < scen.target_count; ++j) {
-          // Target j's id in adj mat is phone count + j
-          if (am(t, i, scen.phone_count + j) == 1 && target_status[j] == false) {
-            DataInfo::iterator find_it = di.find(std::make_pair(i, j));
-            if (find_it == di.end()) {
+        for (int k = kTargetBegin; k < kRowEnd; ++k) {
+          // Target j's id in contacts is phone count + j
+          const int j = slice.ids[k] - scen.phone_count;
+          const int kKey = i * kTargetCount + j;
+          if (!target_status.Test(0, j)) {
+            std::vector<int>::iterator find_it = std::lower_bound(di.begin(), di.end(), kKey);
+            if (find_it == di.end() || *find_it != kKey) {
               // Target j is not fully uploaded and is not
               // in data storage.
               // Sense the target and save the data.
-              nlog << "Phone " << i << " sense target " << j << ".\n";
+              SIMLOG_TRACE(nlog) << "Phone " << i << " sense target " << j << ".\n";
               double sensing_cost = scen.phones[i].costs_.sensing_cost;
               r.AddCost(i, sensing_cost, Cost::SENSING);
-              di[std::make_pair(i, j)] = data_required[std::make_pair(i, j)];
+              di.insert(find_it, kKey);
             }
           }
         }
@@ -102,20 +146,20 @@ namespace mobile_sensing_sim {
         // Check if we have data that can be transferred.
         if (!di.empty()) {
           // There is data can be transferred.
-          // Check if we can upload the data we have.
-          for (DataInfo::iterator it = di.begin(); upload_limits[i] > 0 && it != di.end();) {
-            // Data amount is (*it).second
-            if ((*it).second > upload_limits[i]) {
+          // Check if we can upload the data we have. Fully uploaded
+          // data is a prefix of the storage.
+          int uploaded = 0;
+          for (; upload_limits[i] > 0 && uploaded < di.size(); ++uploaded) {
+            const int kKey = di[uploaded];
+            const double kData = data_required[kKey];
+            if (kData > upload_limits[i]) {
               // Only be able to upload part of the data.
-              nlog << "Phone " << i << " uploads part of target " << (*it).first.second << ", upload amount: " << upload_limits[i] << ".\n";
-              (*it).second -= upload_limits[i];
+              SIMLOG_TRACE(nlog) << "Phone " << i << " uploads part of target " << kKey % kTargetCount << ", upload amount: " << upload_limits[i] << ".\n";
               double upload_cost = scen.phones[i].costs_.upload_cost * upload_limits[i];
               r.AddCost(i, upload_cost, Cost::UPLOAD);
               
               // Update global required data info.
-              if ((*it).second < data_required[(*it).first]) {
-                data_required[(*it).first] = (*it).second;
-              }
+              data_required[kKey] = kData - upload_limits[i];
               
               // Upload limit is used up.
               upload_limits[i] = 0.0;
@@ -123,16 +167,19 @@ namespace mobile_sensing_sim {
             } else {
               // Can upload all the data.
               // The corresponding target data is uploaded.
-              nlog << "Phone " << i << " uploads all of (" << (*it).first.first << "," << (*it).first.second << "), upload amount: " << (*it).second << ".\n";
-              int tid = (*it).first.second;
-              target_status[tid] = true;
-              // Remove this data from storage.
-              upload_limits[i] -= (*it).second;
-              double upload_cost = scen.phones[i].costs_.upload_cost * (*it).second;
+              SIMLOG_TRACE(nlog) << "Phone " << i << " uploads all of (" << kKey / kTargetCount << "," << kKey % kTargetCount << "), upload amount: " << kData << ".\n";
+              const int kTid = kKey % kTargetCount;
+              if (!target_status.Test(0, kTid)) {
+                target_status.Set(0, kTid);
+                ++uploaded_count;
+              }
+              upload_limits[i] -= kData;
+              double upload_cost = scen.phones[i].costs_.upload_cost * kData;
               r.AddCost(i, upload_cost, Cost::UPLOAD);
-              di.erase(it++);
             }
           }
+          // Remove uploaded data from storage.
+          di.erase(di.begin(), di.begin() + uploaded);
           
           // We may have uploaded all the data.
           if (di.empty()) {
@@ -141,41 +188,49 @@ namespace mobile_sensing_sim {
           
           // Check if there is an available neighbor.
           double amount_transferred = 0.0;
-          for (int j = 0; j < scen.phone_count; ++j) {
-            if (i != j && am(t, i, j) == 1) {
-              for (DataInfo::iterator it = di.begin(); it != di.end() && amount_transferred < dm(t, i, j); ++it) {
-                // Search on phone j to see if phone j already
-                // has the data. Only transfer the data phone j
-                // does not have.
-                DataInfo::iterator find_it = phone_datas[j].find((*it).first);
-                if (find_it == phone_datas[j].end()) {
+          for (int k = kRowBegin; k < kTargetBegin; ++k) {
+            const int j = slice.ids[k];
+            if (i != j) {
+              // Walk both sorted storages, only transfer the data
+              // phone j does not have.
+              std::vector<int> &dj = phone_datas[j];
+              std::vector<int>::iterator jt = dj.begin();
+              received.clear();
+              for (std::vector<int>::const_iterator it = di.begin(); it != di.end() && amount_transferred < slice.data[k]; ++it) {
+                jt = std::lower_bound(jt, dj.end(), *it);
+                if (jt == dj.end() || *jt != *it) {
                   // Assume all the data for current target can be
                   // transferred. (all dm[i][j] >= 1.0)
-                  nlog << "Phone " << i << " copy all of (" << (*it).first.first << "," << (*it).first.second << ") to phone " << j << ", transfer amount: " << data_required[(*it).first] << ".\n";
-                  double data_transferred = data_required[(*it).first];
+                  SIMLOG_TRACE(nlog) << "Phone " << i << " copy all of (" << *it / kTargetCount << "," << *it % kTargetCount << ") to phone " << j << ", transfer amount: " << data_required[*it] << ".\n";
+                  double data_transferred = data_required[*it];
                   double comm_cost1 = scen.phones[i].costs_.transfer_cost * data_transferred;
                   double comm_cost2 = scen.phones[j].costs_.transfer_cost * data_transferred;
-                  phone_datas[j][(*it).first] = data_transferred;
+                  received.push_back(*it);
                   amount_transferred += data_transferred;
                   r.AddCost(i, comm_cost1, Cost::COMM);
                   r.AddCost(j, comm_cost2, Cost::COMM);
                 }
               }
+              if (!received.empty()) {
+                const int kOldSize = dj.size();
+                dj.insert(dj.end(), received.begin(), received.end());
+                std::inplace_merge(dj.begin(), dj.begin() + kOldSize, dj.end());
+              }
               // break; // allow only one transfer.
             }
           } // End of for (int j
         } // End of if (!di.empty())
-      } // End of for (int i
+      } // End of for (int p
       
-      // Check if all target datas are uploaded
-      bool all_upload = true;
-      for (int i = 0; i < scen.target_count; ++i) {
-        if (target_status[i] == false) {
-          all_upload = false;
-          break;
+      // Phones given data after their turn upload it in the next one.
+      for (int p = 0; p < phones.size(); ++p) {
+        if (upload_limits[phones[p]] > 0 && !phone_datas[phones[p]].empty()) {
+          turns.Keep(phones[p]);
         }
       }
-      if (all_upload == true) {
+      
+      // Check if all target datas are uploaded
+      if (uploaded_count == kTargetCount) {
         break;
         nlog << "All set. Exit loop.\n";
       }
@@ -183,14 +238,7 @@ namespace mobile_sensing_sim {
     } // End of for (int t
     
     // Check if all target datas are uploaded
-    bool all_upload = true;
-    for (int i = 0; i < scen.target_count; ++i) {
-      if (target_status[i] == false) {
-        all_upload = false;
-        break;
-      }
-    }
-    if (!all_upload) {
+    if (uploaded_count != kTargetCount) {
       r.is_valid = false; // infeasible
       r.is_optimal = false;
     } else {
@@ -205,13 +253,17 @@ namespace mobile_sensing_sim {
     nlog.Reset();
     Result r(scen.phone_count);
     
-    // Create global required data info.
-    typedef std::vector<std::vector<double> > DataInfo_t;
-    DataInfo_t phone_datas(scen.phone_count, std::vector<double>(scen.target_count, 0.0));
+    // Create phone data storage.
+    // Bit (i, j) set: phone i has data of target j. All copies of a
+    // target's data shrink together on upload, so a phone holding it
+    // always has data_remain[j].
+    BitMatrix phone_datas(scen.phone_count, scen.target_count);
+    const int kWordCount = phone_datas.WordCount();
     
     // Create target status.
-    // False: not uploaded yet. True: uploaded.
-    std::vector<bool> target_status(scen.target_count, false);
+    // Bit j set: uploaded.
+    BitMatrix target_status(1, scen.target_count);
+    const BitMatrix::Word *uploaded = target_status.Row(0);
     std::vector<double> data_remain(scen.target_count, 1.0);
     
     // Copy phones upload limits.
@@ -226,83 +278,83 @@ namespace mobile_sensing_sim {
     nlog << "Start simulated walk: \n";
     nlog << "*********************************************\n";
     
+    // Every phone takes a turn, unlike in SolveMILP. A phone without
+    // contacts, data or budget costs a few word operations here, less
+    // than a TurnQueue takes to skip it.
+    int uploaded_count = 0;
     for (int t = 0; t < scen.running_time; ++t) {
       nlog << "\n";
       nlog << "*********************************************\n";
       nlog << "Time: " << t << ":\n";
-      const ThreeDimVector<int> &am = scen.adj_mats;
-      const ThreeDimVector<double> &dm = scen.data_mats;
+      const ContactSlice &slice = scen.contacts.Slice(t);
       for (int i = 0; i < scen.phone_count; ++i) {
-        DataInfo_t &di = phone_datas;
+        BitMatrix::Word *di = phone_datas.Row(i);
+        // Row i: phone contacts first, then target contacts.
+        const int kRowBegin = slice.offsets[i];
+        const int kRowEnd = slice.offsets[i + 1];
+        const int kTargetBegin = std::lower_bound(slice.ids.begin() + kRowBegin, slice.ids.begin() + kRowEnd, scen.phone_count) - slice.ids.begin();
         
         // Check if we can sense any target.
-        for (int j = 0; j < scen.target_count; ++j) {
-          // Target j's id in adj mat is phone count + j
-          if (am(t, i, scen.phone_count + j) == 1 && target_status[j] == false) {
-            if (di[i][j] < data_remain[j]) {
+        for (int k = kTargetBegin; k < kRowEnd; ++k) {
+          // Target j's id in contacts is phone count + j
+          const int j = slice.ids[k] - scen.phone_count;
+          if (!target_status.Test(0, j)) {
+            if (!phone_datas.Test(i, j)) {
               // Target j is not fully uploaded and we do not
               // have full data in data storage.
               // Sense the target and save the data.
-              nlog << "Phone " << i << " sense target " << j << ".\n";
+              SIMLOG_TRACE(nlog) << "Phone " << i << " sense target " << j << ".\n";
               double sensing_cost = scen.phones[i].costs_.sensing_cost;
               r.AddCost(i, sensing_cost, Cost::SENSING);
-              di[i][j] = data_remain[j];
+              phone_datas.Set(i, j);
             }
           }
         }
         
+        // Data of uploaded targets is gone.
         bool empty_storage = true;
-        for (int j = 0; j < scen.target_count; ++j) {
-          if (di[i][j] > 0) {
-            empty_storage = false;
-            break;
-          }
+        for (int w = 0; w < kWordCount; ++w) {
+          di[w] &= ~uploaded[w];
+          empty_storage = empty_storage && di[w] == 0;
         }
         
         // Check if we have data that can be transferred.
         if (!empty_storage) {
           // There is data can be transferred.
           // Check if we can upload the data we have.
-          for (int j = 0; j < scen.target_count; ++j) {
-            assert(di[i][j] >= 0.0);
-            if (di[i][j] == 0.0) continue;
-            if (upload_limits[i] == 0.0) break;
-            double upload_amount;
-            if (di[i][j] > upload_limits[i]) {
-              // Only be able to upload part of the data.
-              upload_amount = upload_limits[i];
-              upload_limits[i] = 0.0;
-            } else {
-              // Can upload all the data.
-              // The corresponding target data is uploaded.
-              upload_amount = di[i][j];
-              upload_limits[i] -= di[i][j];
-            }
-            
-            nlog << "Phone " << i << " uploads part of target " << j << ", upload amount: " << upload_amount << ".\n";
-            assert(di[i][j] <= data_remain[j]);
-            // Update global required data info.
-            for (int k = 0; k < scen.phone_count; ++k) {
-              if (di[k][j] > 0) {
-                di[k][j] = (di[k][j] > upload_amount) ? (di[k][j] - upload_amount) : 0.0;
+          for (int w = 0; w < kWordCount && upload_limits[i] != 0.0; ++w) {
+            for (BitMatrix::Word bits = di[w]; bits != 0 && upload_limits[i] != 0.0; bits &= bits - 1) {
+              const int j = w * BitMatrix::kWordBits + BitMatrix::LowestBit(bits);
+              double upload_amount;
+              if (data_remain[j] > upload_limits[i]) {
+                // Only be able to upload part of the data.
+                upload_amount = upload_limits[i];
+                upload_limits[i] = 0.0;
+              } else {
+                // Can upload all the data.
+                // The corresponding target data is uploaded.
+                upload_amount = data_remain[j];
+                upload_limits[i] -= data_remain[j];
               }
+              
+              SIMLOG_TRACE(nlog) << "Phone " << i << " uploads part of target " << j << ", upload amount: " << upload_amount << ".\n";
+              // Update global required data info, shared by all copies.
+              data_remain[j] -= upload_amount;
+              if (data_remain[j] == 0.0) {
+                target_status.Set(0, j);
+                ++uploaded_count;
+              }
+              
+              double upload_cost = scen.phones[i].costs_.upload_cost * upload_amount;
+              r.AddCost(i, upload_cost, Cost::UPLOAD);
             }
-            data_remain[j] -= upload_amount;
-            if (data_remain[j] == 0.0) {
-              target_status[j] = true;
-            }
-            
-            double upload_cost = scen.phones[i].costs_.upload_cost * upload_amount;
-            r.AddCost(i, upload_cost, Cost::UPLOAD);
           }
           
           // We may have uploaded all the data.
           empty_storage = true;
-          for (int j = 0; j < scen.target_count; ++j) {
-            if (di[i][j] > 0) {
-              empty_storage = false;
-              break;
-            }
+          for (int w = 0; w < kWordCount; ++w) {
+            di[w] &= ~uploaded[w];
+            empty_storage = empty_storage && di[w] == 0;
           }
           
           if (empty_storage) {
@@ -310,39 +362,32 @@ namespace mobile_sensing_sim {
           }
           
           // Check if there is an available neighbor.
-          double amount_transferred = 0.0;
-          for (int j = 0; j < scen.phone_count; ++j) {
-            if (i != j && am(t, i, j) == 1) {
-              for (int k = 0; k < scen.target_count; ++k) {
-                // Search on phone j to see if phone j already
-                // has the data. Only transfer the data phone j
-                // does not have.
-                if (di[i][k] > di[j][k]) {
-                  double data_transferred = di[i][k] - di[j][k];
+          for (int c = kRowBegin; c < kTargetBegin; ++c) {
+            const int j = slice.ids[c];
+            if (i != j) {
+              BitMatrix::Word *dj = phone_datas.Row(j);
+              for (int w = 0; w < kWordCount; ++w) {
+                // Only transfer the data phone j does not have.
+                const BitMatrix::Word kMissing = di[w] & ~dj[w];
+                for (BitMatrix::Word bits = kMissing; bits != 0; bits &= bits - 1) {
+                  const int k = w * BitMatrix::kWordBits + BitMatrix::LowestBit(bits);
+                  double data_transferred = data_remain[k];
                   double comm_cost1 = scen.phones[i].costs_.transfer_cost * data_transferred;
                   double comm_cost2 = scen.phones[j].costs_.transfer_cost * data_transferred;
-                  di[j][k] = di[i][k];
-                  amount_transferred += data_transferred;
                   r.AddCost(i, comm_cost1, Cost::COMM);
                   r.AddCost(j, comm_cost2, Cost::COMM);
-                  nlog << "Phone " << i << " copy data of target " << k << " to phone " << j << ", transfer amount: " << data_transferred << ".\n";
+                  SIMLOG_TRACE(nlog) << "Phone " << i << " copy data of target " << k << " to phone " << j << ", transfer amount: " << data_transferred << ".\n";
                 }
+                dj[w] |= kMissing;
               }
               // break; // allow only one transfer.
             }
           } // End of for (int j
-        } // End of if (!di.empty())
+        } // End of if (!empty_storage)
       } // End of for (int i
       
       // Check if all target datas are uploaded
-      bool all_upload = true;
-      for (int i = 0; i < scen.target_count; ++i) {
-        if (target_status[i] == false) {
-          all_upload = false;
-          break;
-        }
-      }
-      if (all_upload == true) {
+      if (uploaded_count == scen.target_count) {
         break;
         nlog << "All set. Exit loop.\n";
       }
@@ -350,14 +395,7 @@ namespace mobile_sensing_sim {
     } // End of for (int t
     
     // Check if all target datas are uploaded
-    bool all_upload = true;
-    for (int i = 0; i < scen.target_count; ++i) {
-      if (target_status[i] == false) {
-        all_upload = false;
-        break;
-      }
-    }
-    if (!all_upload) {
+    if (uploaded_count != scen.target_count) {
       r.is_valid = false; // infeasible
       r.is_optimal = false;
     } else {
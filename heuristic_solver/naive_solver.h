@@ -10,15 +10,11 @@
 #define __MobileSensingSim__naive_solver__
 
 #include "../solver_base.h"
-#include <map>
 
 namespace mobile_sensing_sim {
-	// DataInfo
-	// key (i, j), indicates how much percentage of data
-	// of target j sensed by phone i has not been
-	// uploaded.
-	typedef std::map<std::pair<int, int>, double> DataInfo;
-	
+	// Phones sense every target in range, upload what they can and copy
+	// all other data to every neighbor. Data held by phones is kept in
+	// dense arrays and bit rows, see BitMatrix.
 	class NaiveSolver : public SolverBase {
 	public:
 		virtual Result Solve(const Scenario& scen);
@@ -6,6 +6,7 @@
 //  Copyright (c) 2014 Yuan. All rights reserved.
 //
 
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <boost/shared_ptr.hpp>
@@ -15,14 +16,35 @@
 #include "solver_base.h"
 #include "stat.h"
 #include "optimal_solver/optimal_solver.h"
+#ifdef PHONESIM_WITH_CPLEX
 #include "optimal_solver/optimal_balance_solver.h"
+#endif
 #include "heuristic_solver/heuristic_solver.h"
 #include "heuristic_solver/naive_solver.h"
 #include "heuristic_solver/agg_heuristic_solver.h"
 #include "heuristic_solver/heuristic_dyn_solver.h"
+#include "sweep_runner.h"
+#include "result_store.h"
+#include "simlog.h"
 
+// Output files, all in the working directory:
+//   phonesim_result.txt  Mean costs per phone count and solver (TSV),
+//                        replaced by every run.
+//   phonesim_runs.bin    Per phone costs of every run, appended by every
+//   phonesim_runs.csv    sweep, see mss::ResultStore.
+//   *_log.*.txt          Logs of every job, see SimLog::BindThread.
+//
+// Usage: phonesim [--scenario-cache DIR] [--scenario-cache-mb MB]
+//   --scenario-cache DIR   Keep generated scenarios in DIR and reuse them
+//                          in later runs with the same parameters. Off
+//                          by default.
+//   --scenario-cache-mb MB Size limit of the cache directory, least
+//                          recently used scenarios are removed first.
 namespace {
   const char * DEFAULT_OUTFILE = "phonesim_result.txt";
+  const char * RUNS_BINARY_FILE = "phonesim_runs.bin";
+  const char * RUNS_CSV_FILE = "phonesim_runs.csv";
+  const int kDefaultScenarioCacheMB = 2048;
 }
 
 namespace mss = mobile_sensing_sim;
@@ -75,8 +97,72 @@ mss::MonitorMap CreateMap() {
 
 
 
+// Solvers of the sweep, see mss::SolverFactory. Only solver_id is
+// built, the others (with their CPLEX environments) are just named.
+mss::SolverPtr CreateSolver(int solver_id, std::vector<std::string>& solver_names) {
+  double dyn_muliples[] = {1.25};
+  const int kDynMultipleSize = 1;
+  mss::SolverPtr solver;
+  
+  if (solver_id == solver_names.size()) {
+    solver.reset(new mss::OptimalSolver());
+  }
+  solver_names.push_back("Optimal solver");
+  
+#ifdef PHONESIM_WITH_CPLEX
+  if (solver_id == solver_names.size()) {
+    solver.reset(new mss::OptimalBalanceSolver());
+  }
+  solver_names.push_back("Optimal balance solver");
+#endif
+  
+  if (solver_id == solver_names.size()) {
+    solver.reset(new mss::HeuristicSolver(60));
+  }
+  solver_names.push_back("Heuristic solver");
+  
+  //    mss::HeuristicSolver hbs(60, true);
+  //    solvers.push_back(&hbs);
+  //    solver_names.push_back("Heuristic balance solver");
+  
+  for (int j = 0; j < kDynMultipleSize; ++j) {
+    if (solver_id == solver_names.size()) {
+      solver.reset(new mss::HeuristicDynSolver(60, dyn_muliples[j]));
+    }
+    std::string sname = "Heuristic Dynamic solver - Multiple = ";
+    sname += boost::lexical_cast<std::string>(dyn_muliples[j]);
+    solver_names.push_back(sname);
+  }
+  
+  if (solver_id == solver_names.size()) {
+    solver.reset(new mss::NaiveSolver());
+  }
+  solver_names.push_back("Naive solver");
+  //mss::AggressiveHeuristicSolver ahs(60);
+  //solvers.push_back(&ahs);
+  //solver_names.push_back("Aggressive heuristic solver");
+  return solver;
+}
+
 int main(int argc, const char * argv[])
 {
+  std::string scenario_cache_dir; // Empty without a cache.
+  int scenario_cache_mb = kDefaultScenarioCacheMB;
+  for (int k = 1; k < argc; ++k) {
+    const std::string kArg = argv[k];
+    if (kArg == "--scenario-cache" && k + 1 < argc) {
+      scenario_cache_dir = argv[++k];
+    } else if (kArg == "--scenario-cache-mb" && k + 1 < argc) {
+      scenario_cache_mb = std::atoi(argv[++k]);
+    } else {
+      scenario_cache_mb = 0;
+    }
+    if (scenario_cache_mb <= 0) {
+      std::cerr << "Usage: " << argv[0] << " [--scenario-cache DIR] [--scenario-cache-mb MB]" << std::endl;
+      return 1;
+    }
+  }
+  
   const int kScenarioNumber = 1;
   // Scenario parameters.
   mss::ScenarioParameters sp;
@@ -98,68 +184,71 @@ int main(int argc, const char * argv[])
   //  int phone_counts[] = {35};
   //  const int kPhoneCountsSize = 1;
   
-  double dyn_muliples[] = {1.25};
-  const int kDynMultipleSize = 1;
+  // Min cost flow engine used by optimal and heuristic solvers.
+  const mss::FlowEngine kFlowEngine = mss::FlowAdapterFactory::DefaultEngine();
+  
+  // Level of every log channel, LEVEL_TRACE keeps everything and
+  // LEVEL_WARNING only keeps warnings and errors.
+  const mss::SimLog::Level kLogLevel = mss::SimLog::LEVEL_TRACE;
+  
+  // Worker threads of the sweep, 0 uses all cores.
+  const int kThreadCount = 0;
+  // Threads of every job generating its scenario, building its flow
+  // graphs and solving them, 0 uses all cores. Jobs already share the
+  // cores, more than 1 only pays off when a sweep has fewer jobs than
+  // cores.
+  const int kScenarioThreadCount = 1;
+  const int kGraphThreadCount = 1;
+  const int kFlowThreadCount = 1;
+  
+  mss::SimLog::SetLevels(kLogLevel);
   
+  // Run all (phone count, seed, solver) jobs.
+  mss::SweepRunner runner(sp, CreateSolver, kThreadCount);
+  if (!scenario_cache_dir.empty()) {
+    runner.SetScenarioCache(mss::ScenarioCachePtr(new mss::ScenarioCache(scenario_cache_dir, static_cast<boost::uint64_t>(scenario_cache_mb) << 20)));
+  }
+  runner.SetMILP(false);
+  runner.SetFlowEngine(kFlowEngine);
+  runner.SetScenarioThreadCount(kScenarioThreadCount);
+  runner.SetGraphThreadCount(kGraphThreadCount);
+  runner.SetFlowThreadCount(kFlowThreadCount);
+  std::cout << "Running sweep on " << runner.ThreadCount() << " threads" << std::endl;
+  mss::SweepResults results;
+  runner.Run(std::vector<int>(phone_counts, phone_counts + kPhoneCountsSize), kScenarioNumber, results);
+  
+  std::vector<std::string> solver_names;
+  CreateSolver(-1, solver_names);
+  
+  // Keep all runs for later plotting.
+  mss::ResultStore store;
+  for (int i = 0; i < kPhoneCountsSize; ++i) {
+    for (int sid = 0; sid < kScenarioNumber; ++sid) {
+      for (int j = 0; j < solver_names.size(); ++j) {
+        store.AddRun(solver_names[j], sid, results[i][sid][j]);
+      }
+    }
+  }
+  store.AppendBinary(RUNS_BINARY_FILE);
+  store.AppendCsv(RUNS_CSV_FILE);
+  
+  // Merge results in sweep order.
   std::ofstream of(DEFAULT_OUTFILE);
   for (int i = 0; i < kPhoneCountsSize; ++i) {
-    std::vector<std::vector<mss::Statistics> > res_stats(4 + kDynMultipleSize,
-                                                         std::vector<mss::Statistics>(3));
+    std::vector<std::vector<mss::Statistics> > res_stats(solver_names.size(), std::vector<mss::Statistics>(3));
     for (int sid = 0; sid < kScenarioNumber; ++sid) {
       std::cout << "*****************************" << std::endl;
       std::cout << "Scenario ID: " << sid << std::endl;
       
-      sp.phone_count = phone_counts[i];
-      sp.seed = sid;
-      
-      // Create scneario generator.
-      mss::ScenarioGenerator sg(sp);
-      
-      // Generate scenario.
-      const mss::Scenario& scen = sg.GenerateDefaultScenario();
-      
-      // Create solvers
-      std::vector<boost::shared_ptr<mss::SolverBase> > solvers;
-      std::vector<std::string> solver_names;
-      
-      solvers.push_back(boost::shared_ptr<mss::SolverBase>(new mss::OptimalSolver()));
-      solver_names.push_back("Optimal solver");
-      
-      solvers.push_back(boost::shared_ptr<mss::SolverBase>(new mss::OptimalBalanceSolver()));
-      solver_names.push_back("Optimal balance solver");
-      
-      solvers.push_back(boost::shared_ptr<mss::SolverBase>(new mss::HeuristicSolver(60)));
-      solver_names.push_back("Heuristic solver");
-      
-      //    mss::HeuristicSolver hbs(60, true);
-      //    solvers.push_back(&hbs);
-      //    solver_names.push_back("Heuristic balance solver");
-      
-      for (int j = 0; j < kDynMultipleSize; ++j) {
-        solvers.push_back(boost::shared_ptr<mss::SolverBase>(new mss::HeuristicDynSolver(60, dyn_muliples[j])));
-        std::string sname = "Heuristic Dynamic solver - Multiple = ";
-        sname += boost::lexical_cast<std::string>(dyn_muliples[j]);
-        solver_names.push_back(sname);
-      }
-      
-      solvers.push_back(boost::shared_ptr<mss::SolverBase>(new mss::NaiveSolver()));
-      solver_names.push_back("Naive solver");
-      //mss::AggressiveHeuristicSolver ahs(60);
-      //solvers.push_back(&ahs);
-      //solver_names.push_back("Aggressive heuristic solver");
-      
-      assert(res_stats.size() == solvers.size());
-      
-      for (int j = 0; j < solvers.size(); ++j) {
-        solvers[j]->SetMILP(false);
+      for (int j = 0; j < solver_names.size(); ++j) {
         std::cout << "Running algorithm " << solver_names[j] << std::endl;
-        mss::Result r = solvers[j]->Solve(scen);
+        const mss::Result& r = results[i][sid][j];
         
         // Save result to statistics if valid.
         if (r.is_valid && r.is_optimal) {
           //mss::Statistics phone_stat;
           std::vector<mss::Statistics> cost_stat(3);
-          for (int k = 0; k < scen.phone_count; ++k) {
+          for (int k = 0; k < phone_counts[i]; ++k) {
             //phone_stat.AddValue(r.PhoneCost(k));
             cost_stat[0].AddValue(r.phone_cost[k][mss::Cost::SENSING]);
             cost_stat[1].AddValue(r.phone_cost[k][mss::Cost::COMM]);
@@ -186,4 +275,3 @@ int main(int argc, const char * argv[])
   
   return 0;
 }
-
@@ -0,0 +1,510 @@
+//
+//  cost_scaling_adapter.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/31/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include <boost/bind/bind.hpp>
+#include "cost_scaling_adapter.h"
+
+namespace {
+  const double kFlowEpsilon = 1.0E-9;
+  const int kAlpha = 16;
+  // Vertices per task of a round, up to this many active vertices are
+  // discharged on the calling thread.
+  const int kChunkSize = 512;
+  // Costs are scaled by the first of these making all of them integers.
+  const int kCostMultipliers[] = {1, 2, 4, 5, 8, 10, 20, 25, 50, 100, 1000};
+  const int kCostMultiplierCount = sizeof(kCostMultipliers) / sizeof(kCostMultipliers[0]);
+  // Bound of scaled costs and potentials, sums of three stay in range.
+  const boost::int64_t kMaxCost = boost::int64_t(1) << 60;
+  // Relabels per vertex between two global updates.
+  const double kUpdateFactor = 1.0;
+}
+
+namespace mobile_sensing_sim {
+  bool CostScalingAdapter::Solve(const Graph &g, Solution &s) {
+    if (g.vertex_count != g.vertex_supply.size() || g.edge_count != g.edge_tails.size()) {
+      s.Clear();
+      s.is_valid = false;
+      ErrorHandler::RunningWarning("Cost scaling: graph dimensions do not match its arrays!");
+      return false;
+    }
+    if (!LoadGraph(g)) {
+      return simplex_.Solve(g, s);
+    }
+
+    if (!pool_ && thread_count_ != 1) {
+      pool_.reset(new ThreadPool(thread_count_));
+    }
+    do {
+      epsilon_ = std::max<Cost>(epsilon_ / kAlpha, 1);
+      if (!Refine(pool_.get())) {
+        return simplex_.Solve(g, s);
+      }
+    } while (epsilon_ > 1);
+
+    // Flow left on the artificial vertex could not be routed.
+    int status = Solution::OPTIMAL;
+    const int kArtificial = node_num_ - 1;
+    for (int a = first_[kArtificial]; a < first_[kArtificial + 1]; ++a) {
+      if (res_[a] > kFlowEpsilon && cost_[a] < 0) {
+        status = Solution::INFEASIBLE;
+      } else if (res_[rev_[a]] > kFlowEpsilon && cost_[a] > 0) {
+        status = Solution::INFEASIBLE;
+      }
+    }
+
+    WriteSolution(g, status, s);
+    return true;
+  }
+
+  bool CostScalingAdapter::LoadGraph(const Graph &g) {
+    const int kVertexCount = g.vertex_count;
+    const int kEdgeCount = g.edge_count;
+    node_num_ = kVertexCount + 1;
+
+    // Costs scaled to integers, negative costs on uncapacitated arcs
+    // could form unbounded cycles.
+    int multiplier = 0;
+    for (int m = 0; m < kCostMultiplierCount && multiplier == 0; ++m) {
+      multiplier = kCostMultipliers[m];
+      for (int e = 0; e < kEdgeCount; ++e) {
+        const double kScaled = g.edge_costs[e] * kCostMultipliers[m];
+        if (std::abs(kScaled - std::floor(kScaled + 0.5)) > 1.0E-9 * std::max(1.0, std::abs(kScaled))) {
+          multiplier = 0;
+          break;
+        }
+      }
+    }
+    if (multiplier == 0) {
+      return false;
+    }
+    Cost max_cost = 0;
+    for (int e = 0; e < kEdgeCount; ++e) {
+      if (g.edge_capacity_uppper_bounds[e] >= Graph::kInfinity && g.edge_costs[e] < 0.0) {
+        return false;
+      }
+      if (g.edge_capacity_uppper_bounds[e] < g.edge_capacity_lower_bounds[e]) {
+        return false;
+      }
+      const double kScaled = std::abs(g.edge_costs[e]) * multiplier;
+      if (kScaled >= kMaxCost) {
+        return false;
+      }
+      max_cost = std::max(max_cost, static_cast<Cost>(kScaled + 0.5));
+    }
+
+    // Artificial arcs cost more than any path of graph arcs. Scaled by
+    // node_num_ + 1, epsilon 1 is below one original unit per vertex.
+    const double kArtificialCost = (static_cast<double>(max_cost) + 1) * node_num_;
+    if (kArtificialCost * (node_num_ + 1) >= kMaxCost) {
+      return false;
+    }
+    const Cost kScale = node_num_ + 1;
+    cost_unit_ = 1.0 / (static_cast<double>(multiplier) * kScale);
+
+    // Lower bounds are moved into the supplies of both ends.
+    std::vector<double> supply(g.vertex_supply.begin(), g.vertex_supply.end());
+    lower_.assign(g.edge_capacity_lower_bounds.begin(), g.edge_capacity_lower_bounds.end());
+    double bound = 0.0; // No arc needs more flow than this.
+    for (int e = 0; e < kEdgeCount; ++e) {
+      supply[g.edge_tails[e]] -= lower_[e];
+      supply[g.edge_heads[e]] += lower_[e];
+      if (g.edge_capacity_uppper_bounds[e] < Graph::kInfinity) {
+        bound += g.edge_capacity_uppper_bounds[e] - lower_[e];
+      }
+    }
+    for (int v = 0; v < kVertexCount; ++v) {
+      bound += std::max(supply[v], 0.0);
+    }
+
+    const Adjacency *adj = &g.GetAdjacency();
+
+    // Residual arcs of a vertex: graph arcs leaving it, graph arcs
+    // entering it backwards, then its artificial arc.
+    const int kArtificial = node_num_ - 1;
+    first_.assign(node_num_ + 1, 0);
+    int artificial_count = 0;
+    for (int v = 0; v < kVertexCount; ++v) {
+      const bool kHasArtificial = std::abs(supply[v]) > kFlowEpsilon;
+      first_[v + 1] = first_[v] + adj->OutArcs(v).size() + adj->InArcs(v).size() + (kHasArtificial ? 1 : 0);
+      artificial_count += kHasArtificial ? 1 : 0;
+    }
+    first_[node_num_] = first_[kArtificial] + artificial_count;
+    const int kArcCount = first_[node_num_];
+    head_.resize(kArcCount);
+    rev_.resize(kArcCount);
+    cost_.resize(kArcCount);
+    res_.resize(kArcCount);
+    edge_arcs_.resize(kEdgeCount);
+
+    int artificial_arc = first_[kArtificial];
+    for (int v = 0; v < kVertexCount; ++v) {
+      int a = first_[v];
+      for (const int *it = adj->OutArcs(v).begin(); it != adj->OutArcs(v).end(); ++it, ++a) {
+        const int e = *it;
+        const double kUpper = g.edge_capacity_uppper_bounds[e];
+        head_[a] = g.edge_heads[e];
+        cost_[a] = static_cast<Cost>(std::floor(g.edge_costs[e] * multiplier + 0.5)) * kScale;
+        res_[a] = kUpper >= Graph::kInfinity ? bound : kUpper - lower_[e];
+        edge_arcs_[e] = a;
+      }
+      for (const int *it = adj->InArcs(v).begin(); it != adj->InArcs(v).end(); ++it, ++a) {
+        // Linked to the forward arc once all of them are placed.
+        const int e = *it;
+        head_[a] = g.edge_tails[e];
+        res_[a] = 0.0;
+        rev_[a] = e; // Resolved below.
+      }
+      if (a < first_[v + 1]) {
+        const Cost kCost = static_cast<Cost>(kArtificialCost) * kScale;
+        const int kOut = supply[v] > 0.0 ? a : artificial_arc;
+        const int kIn = supply[v] > 0.0 ? artificial_arc : a;
+        head_[a] = kArtificial;
+        head_[artificial_arc] = v;
+        cost_[kOut] = kCost;
+        cost_[kIn] = -kCost;
+        res_[kOut] = std::abs(supply[v]);
+        res_[kIn] = 0.0;
+        rev_[a] = artificial_arc;
+        rev_[artificial_arc] = a;
+        ++artificial_arc;
+      }
+    }
+    for (int v = 0; v < kVertexCount; ++v) {
+      const int kInBegin = first_[v] + adj->OutArcs(v).size();
+      for (int a = kInBegin; a < kInBegin + adj->InArcs(v).size(); ++a) {
+        const int kForward = edge_arcs_[rev_[a]];
+        cost_[a] = -cost_[kForward];
+        rev_[a] = kForward;
+        rev_[kForward] = a;
+      }
+    }
+
+    excess_.assign(node_num_, 0.0);
+    std::copy(supply.begin(), supply.end(), excess_.begin());
+    saturation_.resize(node_num_);
+    pi_.assign(node_num_, 0);
+    next_pi_.resize(node_num_);
+    current_.resize(node_num_);
+    in_next_.assign(node_num_, 0);
+    rank_.resize(node_num_);
+    rank_stamp_.assign(node_num_, 0);
+    update_count_ = 0;
+    // The empty flow is max_cost optimal, artificial arcs only leave
+    // the vertices with supply.
+    epsilon_ = std::max<Cost>(max_cost * kScale, 1);
+    return true;
+  }
+
+  bool CostScalingAdapter::Refine(ThreadPool* pool) {
+    // Saturating every arc of negative reduced cost makes the flow
+    // 0-optimal, the excess it creates is pushed to the deficits.
+    ForChunks(pool, node_num_, &CostScalingAdapter::CountSaturation);
+    ForChunks(pool, node_num_, &CostScalingAdapter::Saturate);
+    active_.clear();
+    for (int v = 0; v < node_num_; ++v) {
+      if (excess_[v] > kFlowEpsilon) {
+        active_.push_back(v);
+      }
+    }
+    if (!active_.empty() && !UpdatePotentials()) {
+      return false;
+    }
+
+    int round = 0;
+    int relabel_count = 0;
+    std::fill(in_next_.begin(), in_next_.end(), 0);
+    while (!active_.empty()) {
+      if (active_.size() <= kChunkSize) {
+        if (!Discharge(&relabel_count)) {
+          return false;
+        }
+        continue;
+      }
+      ++round;
+      const int kChunkCount = (active_.size() + kChunkSize - 1) / kChunkSize;
+      if (gains_.size() < kChunkCount) {
+        gains_.resize(kChunkCount);
+      }
+      for (int c = 0; c < kChunkCount; ++c) {
+        gains_[c].clear();
+      }
+      ForChunks(pool, active_.size(), &CostScalingAdapter::Push);
+      ForChunks(pool, active_.size(), &CostScalingAdapter::Relabel);
+
+      // Vertices keeping excess stay active with their new potential,
+      // heads receiving excess follow in the order it was pushed.
+      next_active_.clear();
+      for (int k = 0; k < active_.size(); ++k) {
+        const int v = active_[k];
+        if (excess_[v] > kFlowEpsilon) {
+          if (next_pi_[v] <= -kMaxCost) {
+            return false;
+          }
+          pi_[v] = next_pi_[v];
+          next_active_.push_back(v);
+          in_next_[v] = round;
+          ++relabel_count;
+        }
+      }
+      for (int c = 0; c < kChunkCount; ++c) {
+        const std::vector<std::pair<int, double> > &gains = gains_[c];
+        for (int k = 0; k < gains.size(); ++k) {
+          const int w = gains[k].first;
+          excess_[w] += gains[k].second;
+          if (excess_[w] > kFlowEpsilon && in_next_[w] != round) {
+            next_active_.push_back(w);
+            in_next_[w] = round;
+          }
+        }
+      }
+      active_.swap(next_active_);
+      if (!active_.empty() && relabel_count >= kUpdateFactor * node_num_) {
+        if (!UpdatePotentials()) {
+          return false;
+        }
+        relabel_count = 0;
+      }
+    }
+    return true;
+  }
+
+  bool CostScalingAdapter::UpdatePotentials() {
+    // Dijkstra from the deficits over reversed residual arcs. An arc
+    // of reduced cost c is floor(c / epsilon) + 1 long, not negative
+    // for an epsilon optimal flow. Stops once every vertex with excess
+    // is reached, the others count as that far away.
+    ++update_count_;
+    heap_.clear();
+    std::greater<std::pair<Cost, int> > later;
+    int unreached = 0;
+    for (int v = 0; v < node_num_; ++v) {
+      if (excess_[v] < -kFlowEpsilon) {
+        rank_[v] = 0;
+        rank_stamp_[v] = update_count_;
+        heap_.push_back(std::make_pair(0, v));
+      } else if (excess_[v] > kFlowEpsilon) {
+        ++unreached;
+      }
+    }
+    std::make_heap(heap_.begin(), heap_.end(), later);
+    // Settled vertices are negated in rank_stamp_.
+    Cost last_rank = 0;
+    while (!heap_.empty() && unreached > 0) {
+      std::pop_heap(heap_.begin(), heap_.end(), later);
+      const Cost r = heap_.back().first;
+      const int u = heap_.back().second;
+      heap_.pop_back();
+      if (rank_stamp_[u] == -update_count_ || r > rank_[u]) {
+        continue;
+      }
+      rank_stamp_[u] = -update_count_;
+      last_rank = r;
+      if (excess_[u] > kFlowEpsilon) {
+        --unreached;
+      }
+      for (int a = first_[u]; a < first_[u + 1]; ++a) {
+        const int kIn = rev_[a]; // From v to u.
+        const int v = head_[a];
+        if (res_[kIn] <= kFlowEpsilon || rank_stamp_[v] == -update_count_) {
+          continue;
+        }
+        const Cost kReduced = cost_[kIn] + pi_[v] - pi_[u];
+        const Cost kRank = r + (kReduced + epsilon_) / epsilon_;
+        if (rank_stamp_[v] != update_count_ || kRank < rank_[v]) {
+          rank_[v] = kRank;
+          rank_stamp_[v] = update_count_;
+          heap_.push_back(std::make_pair(kRank, v));
+          std::push_heap(heap_.begin(), heap_.end(), later);
+        }
+      }
+    }
+
+    for (int v = 0; v < node_num_; ++v) {
+      const Cost kRank = rank_stamp_[v] == -update_count_ ? rank_[v] : last_rank;
+      if (kRank > (kMaxCost + pi_[v]) / epsilon_) {
+        return false;
+      }
+      pi_[v] -= kRank * epsilon_;
+      current_[v] = first_[v];
+    }
+    return true;
+  }
+
+  void CostScalingAdapter::CountSaturation(int begin, int end) {
+    for (int v = begin; v < end; ++v) {
+      double change = 0.0;
+      for (int a = first_[v]; a < first_[v + 1]; ++a) {
+        const Cost kReduced = cost_[a] + pi_[v] - pi_[head_[a]];
+        if (kReduced < 0) {
+          change -= res_[a];
+        } else if (kReduced > 0) {
+          // The reverse arc has negative reduced cost at the head.
+          change += res_[rev_[a]];
+        }
+      }
+      saturation_[v] = change;
+    }
+  }
+
+  void CostScalingAdapter::Saturate(int begin, int end) {
+    for (int v = begin; v < end; ++v) {
+      for (int a = first_[v]; a < first_[v + 1]; ++a) {
+        if (cost_[a] + pi_[v] - pi_[head_[a]] < 0) {
+          res_[rev_[a]] += res_[a];
+          res_[a] = 0.0;
+        }
+      }
+      excess_[v] += saturation_[v];
+      current_[v] = first_[v];
+    }
+  }
+
+  void CostScalingAdapter::Push(int begin, int end) {
+    std::vector<std::pair<int, double> > &gains = gains_[begin / kChunkSize];
+    for (int k = begin; k < end; ++k) {
+      const int v = active_[k];
+      double excess = excess_[v];
+      const int kEnd = first_[v + 1];
+      int a = current_[v];
+      for (; a < kEnd; ++a) {
+        // Reduced costs are tested first. An arc with negative reduced
+        // cost at v has positive reduced cost at its head, so its
+        // residual capacities are only touched from here this round.
+        if (cost_[a] + pi_[v] - pi_[head_[a]] >= 0 || res_[a] <= kFlowEpsilon) {
+          continue;
+        }
+        const double kAmount = std::min(excess, res_[a]);
+        res_[a] -= kAmount;
+        res_[rev_[a]] += kAmount;
+        excess -= kAmount;
+        gains.push_back(std::make_pair(head_[a], kAmount));
+        if (excess <= kFlowEpsilon) {
+          break;
+        }
+      }
+      current_[v] = a;
+      excess_[v] = excess;
+    }
+  }
+
+  void CostScalingAdapter::Relabel(int begin, int end) {
+    for (int k = begin; k < end; ++k) {
+      const int v = active_[k];
+      if (excess_[v] <= kFlowEpsilon) {
+        continue;
+      }
+      // Highest potential keeping every residual arc epsilon optimal,
+      // read from the potentials of the round start.
+      Cost best = -kMaxCost;
+      for (int a = first_[v]; a < first_[v + 1]; ++a) {
+        if (res_[a] > kFlowEpsilon) {
+          best = std::max(best, pi_[head_[a]] - cost_[a]);
+        }
+      }
+      next_pi_[v] = best - epsilon_;
+      current_[v] = first_[v];
+    }
+  }
+
+  bool CostScalingAdapter::Discharge(int* relabel_count) {
+    // active_ is the queue, queued vertices are marked -1 in in_next_.
+    for (int k = 0; k < active_.size(); ++k) {
+      in_next_[active_[k]] = -1;
+    }
+    int next = 0;
+    while (next < active_.size()) {
+      if (active_.size() - next > 2 * kChunkSize) {
+        // Enough work for threads again.
+        active_.erase(active_.begin(), active_.begin() + next);
+        return true;
+      }
+      const int v = active_[next++];
+      in_next_[v] = 0;
+      while (excess_[v] > kFlowEpsilon) {
+        const int kEnd = first_[v + 1];
+        int a = current_[v];
+        for (; a < kEnd; ++a) {
+          const int w = head_[a];
+          if (res_[a] <= kFlowEpsilon || cost_[a] + pi_[v] - pi_[w] >= 0) {
+            continue;
+          }
+          const double kAmount = std::min(excess_[v], res_[a]);
+          res_[a] -= kAmount;
+          res_[rev_[a]] += kAmount;
+          excess_[v] -= kAmount;
+          excess_[w] += kAmount;
+          if (excess_[w] > kFlowEpsilon && in_next_[w] != -1) {
+            active_.push_back(w);
+            in_next_[w] = -1;
+          }
+          if (excess_[v] <= kFlowEpsilon) {
+            break;
+          }
+        }
+        current_[v] = a;
+        if (excess_[v] <= kFlowEpsilon) {
+          break;
+        }
+
+        Cost best = -kMaxCost;
+        for (a = first_[v]; a < kEnd; ++a) {
+          if (res_[a] > kFlowEpsilon) {
+            best = std::max(best, pi_[head_[a]] - cost_[a]);
+          }
+        }
+        if (best - epsilon_ <= -kMaxCost) {
+          return false;
+        }
+        pi_[v] = best - epsilon_;
+        current_[v] = first_[v];
+        if (++*relabel_count >= kUpdateFactor * node_num_) {
+          if (!UpdatePotentials()) {
+            return false;
+          }
+          *relabel_count = 0;
+        }
+      }
+    }
+    active_.clear();
+    return true;
+  }
+
+  void CostScalingAdapter::ForChunks(ThreadPool* pool, int count, ChunkTask task) {
+    if (pool == NULL || count <= kChunkSize) {
+      // All gains go to the first buffer, in the same order.
+      (this->*task)(0, count);
+      return;
+    }
+    for (int begin = 0; begin < count; begin += kChunkSize) {
+      pool->Submit(boost::bind(task, this, begin, std::min(begin + kChunkSize, count)));
+    }
+    pool->Wait();
+  }
+
+  void CostScalingAdapter::WriteSolution(const Graph &g, int status, Solution &s) const {
+    s.Clear();
+    s.edge_count = g.edge_count;
+    s.vertex_count = g.vertex_count;
+    s.solution_status = status;
+    s.edge_values.resize(g.edge_count);
+    s.edge_costs.resize(g.edge_count);
+    s.obj = 0.0;
+
+    for (int e = 0; e < g.edge_count; ++e) {
+      const double kValue = lower_[e] + res_[rev_[edge_arcs_[e]]];
+      s.edge_values[e] = kValue;
+      s.edge_costs[e] = g.edge_costs[e] + (pi_[g.edge_tails[e]] - pi_[g.edge_heads[e]]) * cost_unit_;
+      s.obj += g.edge_costs[e] * kValue;
+    }
+
+    s.is_valid = true;
+  }
+}
@@ -0,0 +1,114 @@
+//
+//  cost_scaling_adapter.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/31/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__cost_scaling_adapter__
+#define __PhoneSim__cost_scaling_adapter__
+
+#include <vector>
+#include <utility>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "flow_adapter_base.h"
+#include "graph_converter.h"
+#include "network_simplex_adapter.h"
+#include "../thread_pool.h"
+
+namespace mobile_sensing_sim {
+  // Cost scaling push-relabel (Goldberg) on several threads. Costs are
+  // scaled to integers and multiplied by vertex count + 1, each phase
+  // divides epsilon by kAlpha until the flow is 1-optimal, which is
+  // optimal for the original costs.
+  //
+  // Phases run in synchronous rounds. All active vertices push along
+  // their admissible arcs under the potentials of the round start,
+  // then the ones left with excess relabel. An arc is admissible from
+  // at most one of its ends, so every residual capacity has a single
+  // writer in a round and no locks are needed. Excess received is
+  // buffered per chunk of vertices and added in chunk order, so the
+  // flow is the same for any thread count. With few active vertices,
+  // as when excess walks along the time layers, they are discharged
+  // one by one on the calling thread instead.
+  //
+  // Potentials are reset from residual distances to the deficits at
+  // the start of each phase and after every node_num_ relabels.
+  //
+  // Supplies the graph cannot route go over an expensive artificial
+  // vertex and the solution is reported infeasible, like network
+  // simplex does. Graphs whose costs do not scale to integers, or
+  // with negative costs on uncapacitated arcs, are solved by network
+  // simplex.
+  class CostScalingAdapter : public FlowAdapterBase {
+  public:
+    // thread_count <= 0 uses all hardware threads. The threads are
+    // started by the first Solve and kept until the adapter goes.
+    explicit CostScalingAdapter(int thread_count = 0) : thread_count_(thread_count) {}
+    bool Solve(const Graph &g, Solution &s);
+  private:
+    typedef boost::int64_t Cost;
+
+    typedef void (CostScalingAdapter::*ChunkTask)(int begin, int end);
+
+    // Residual arcs of vertex v are [first_[v], first_[v + 1]). False
+    // if the graph is left to network simplex.
+    bool LoadGraph(const Graph &g);
+    // Turn the flow epsilon_ optimal, false if potentials would
+    // leave the range of Cost.
+    bool Refine(ThreadPool* pool);
+    // Saturate arcs of vertices [begin, end) with negative reduced
+    // cost. CountSaturation only computes the excess change.
+    void CountSaturation(int begin, int end);
+    void Saturate(int begin, int end);
+    // Push excess of active_[begin, end) along admissible arcs, the
+    // excess of the heads is buffered in gains_ of the chunk.
+    void Push(int begin, int end);
+    // New potentials of active_[begin, end) still holding excess.
+    void Relabel(int begin, int end);
+    // Push and relabel active_ one vertex at a time on the calling
+    // thread, until none is left or the queue outgrows a few chunks.
+    // Counts relabels in relabel_count, false like Refine.
+    bool Discharge(int* relabel_count);
+    // Lower potentials by the distances to the deficits in residual
+    // arcs, measured in epsilon_ (global update). Runs on the calling
+    // thread, false if potentials would leave the range of Cost.
+    bool UpdatePotentials();
+    // Run task on chunks of [0, count), on pool if there is one.
+    void ForChunks(ThreadPool* pool, int count, ChunkTask task);
+    void WriteSolution(const Graph &g, int status, Solution &s) const;
+
+    int thread_count_;
+    boost::scoped_ptr<ThreadPool> pool_; // NULL with one thread.
+    NetworkSimplexAdapter simplex_;
+
+    int node_num_; // Graph vertices plus the artificial one.
+    double cost_unit_; // Graph cost of one scaled cost unit.
+    Cost epsilon_;
+    std::vector<int> first_;
+    std::vector<int> head_;
+    std::vector<int> rev_; // Reverse residual arc.
+    std::vector<Cost> cost_;
+    std::vector<double> res_;
+    std::vector<int> edge_arcs_; // Forward residual arc of every graph edge.
+    std::vector<double> lower_;
+
+    std::vector<double> excess_;
+    std::vector<double> saturation_;
+    std::vector<Cost> pi_;
+    std::vector<Cost> next_pi_;
+    std::vector<int> current_; // Current arc of every vertex.
+    std::vector<int> active_;
+    std::vector<int> next_active_;
+    std::vector<int> in_next_; // Round a vertex was last queued in.
+    std::vector<std::vector<std::pair<int, double> > > gains_;
+    std::vector<Cost> rank_; // Distances of UpdatePotentials.
+    std::vector<int> rank_stamp_; // Update a rank was last set in.
+    int update_count_;
+    std::vector<std::pair<Cost, int> > heap_;
+  };
+}
+
+#endif /* defined(__PhoneSim__cost_scaling_adapter__) */
@@ -12,25 +12,10 @@
 #include <vector>
 #include <ilcplex/cplex.h>
 #include "graph_converter.h"
-#include "../milp_base.h"
+#include "flow_adapter_base.h"
 
 namespace mobile_sensing_sim {
-  struct Solution {
-    Solution() : is_valid(false), obj(0.0) {}
-    void Clear() {
-      edge_values.clear();
-      edge_costs.clear();
-    }
-    bool is_valid;
-    double obj;
-    int solution_status;
-    int edge_count;
-    int vertex_count;
-    std::vector<double> edge_values;
-    std::vector<double> edge_costs;
-  };
-  
-  class CplexAdapterBase : public MilpBase {
+  class CplexAdapterBase : public FlowAdapterBase {
   public:
     CplexAdapterBase() : env_(NULL), net_(NULL) {}
     virtual bool Solve(const Graph &g, Solution &s) { return true; }
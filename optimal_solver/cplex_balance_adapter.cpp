@@ -54,7 +54,7 @@ namespace mobile_sensing_sim {
       // Create variable type array.
       boost::scoped_array<char> ctype(new char[g.edge_count]);
       for (int i = 0; i < g.edge_count; ++i) {
-        if (g.edges[i].type == Edge::TARGET_TO_PHONE) {
+        if (g.edge_info.Type(i) == Edge::TARGET_TO_PHONE) {
           ctype[i] = 'B';
         } else {
           ctype[i] = 'C';
@@ -245,8 +245,8 @@ namespace mobile_sensing_sim {
     
     int count = 0;
     int start_id = cur_numrows - rcnt;
-    for (int i = 0; i < g.edges.size(); ++i) {
-      Edge e = g.edges[i];
+    for (int i = 0; i < g.edge_count; ++i) {
+      Edge e = g.GetEdge(i);
       if(e.type == Edge::SRC_TO_TARGET ||
          e.type == Edge::PHONE_TO_SELF ||
          (e.type == Edge::TARGET_TO_PHONE && !bo.sensing) ||
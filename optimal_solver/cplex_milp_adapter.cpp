@@ -47,7 +47,7 @@ namespace mobile_sensing_sim {
 		// Create variable type array.
 		boost::scoped_array<char> ctype(new char[g.edge_count]);
 		for (int i = 0; i < g.edge_count; ++i) {
-			if (g.edges[i].type == Edge::TARGET_TO_PHONE) {
+			if (g.edge_info.Type(i) == Edge::TARGET_TO_PHONE) {
 				ctype[i] = 'B';
 			} else {
 				ctype[i] = 'C';
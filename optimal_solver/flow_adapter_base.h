@@ -0,0 +1,66 @@
+//
+//  flow_adapter_base.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/2/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__flow_adapter_base__
+#define __PhoneSim__flow_adapter_base__
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include "graph_converter.h"
+#include "../milp_base.h"
+
+namespace mobile_sensing_sim {
+  struct Solution {
+    // Status codes follow CPX_STAT_* so that solutions from
+    // every engine can be checked the same way.
+    enum Status {
+      OPTIMAL = 1,
+      UNBOUNDED = 2,
+      INFEASIBLE = 3
+    };
+
+    Solution() : is_valid(false), obj(0.0) {}
+    void Clear() {
+      edge_values.clear();
+      edge_costs.clear();
+    }
+    bool is_valid;
+    double obj;
+    int solution_status;
+    int edge_count;
+    int vertex_count;
+    std::vector<double> edge_values;
+    std::vector<double> edge_costs;
+  };
+
+  // Engines able to solve the min cost flow problem
+  // built by GraphConverter.
+  enum FlowEngine {
+    CPLEX_ENGINE = 0,
+    NETWORK_SIMPLEX_ENGINE,
+    SUCCESSIVE_PATH_ENGINE, // Few targets, see SuccessivePathAdapter.
+    COST_SCALING_ENGINE // Large graphs on all cores, see CostScalingAdapter.
+  };
+
+  // Common interface of min cost flow solvers.
+  class FlowAdapterBase : public MilpBase {
+  public:
+    virtual ~FlowAdapterBase() {}
+    virtual bool Solve(const Graph &g, Solution &s) = 0;
+    // Solve g again starting from the basis of the last Solve or
+    // Resolve, delta describes g relative to that graph. Engines
+    // without warm start support solve from scratch.
+    virtual bool Resolve(const Graph &g, const GraphDelta & /* delta */, Solution &s) {
+      return Solve(g, s);
+    }
+  };
+
+  typedef boost::shared_ptr<FlowAdapterBase> FlowAdapterPtr;
+}
+
+#endif /* defined(__PhoneSim__flow_adapter_base__) */
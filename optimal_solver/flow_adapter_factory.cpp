@@ -0,0 +1,46 @@
+//
+//  flow_adapter_factory.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/2/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include "flow_adapter_factory.h"
+#include "network_simplex_adapter.h"
+#include "successive_path_adapter.h"
+#include "cost_scaling_adapter.h"
+#ifdef PHONESIM_WITH_CPLEX
+#include "cplex_adapter.h"
+#endif
+
+namespace mobile_sensing_sim {
+  FlowAdapterPtr FlowAdapterFactory::Create(FlowEngine engine, int thread_count) {
+    switch (engine) {
+      case CPLEX_ENGINE:
+#ifdef PHONESIM_WITH_CPLEX
+        return FlowAdapterPtr(new CplexAdapter());
+#else
+        ErrorHandler::RunningWarning("CPLEX is not compiled in. Use network simplex instead.");
+        return FlowAdapterPtr(new NetworkSimplexAdapter());
+#endif
+      case NETWORK_SIMPLEX_ENGINE:
+        return FlowAdapterPtr(new NetworkSimplexAdapter());
+      case SUCCESSIVE_PATH_ENGINE:
+        return FlowAdapterPtr(new SuccessivePathAdapter());
+      case COST_SCALING_ENGINE:
+        return FlowAdapterPtr(new CostScalingAdapter(thread_count));
+      default:
+        ErrorHandler::CodingError("Unknown flow engine!");
+    }
+    return FlowAdapterPtr();
+  }
+  
+  FlowEngine FlowAdapterFactory::DefaultEngine() {
+#ifdef PHONESIM_WITH_CPLEX
+    return CPLEX_ENGINE;
+#else
+    return NETWORK_SIMPLEX_ENGINE;
+#endif
+  }
+}
@@ -0,0 +1,30 @@
+//
+//  flow_adapter_factory.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/2/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__flow_adapter_factory__
+#define __PhoneSim__flow_adapter_factory__
+
+#include "flow_adapter_base.h"
+
+namespace mobile_sensing_sim {
+  class FlowAdapterFactory {
+  public:
+    // Create a min cost flow adapter for the given engine.
+    // Falls back to the default engine if the requested one
+    // is not compiled in. Engines solving on several threads use
+    // thread_count of them, <= 0 uses all hardware threads.
+    static FlowAdapterPtr Create(FlowEngine engine, int thread_count = 0);
+    
+    // CPLEX if it is available, network simplex otherwise.
+    static FlowEngine DefaultEngine();
+  private:
+    FlowAdapterFactory();
+  };
+}
+
+#endif /* defined(__PhoneSim__flow_adapter_factory__) */
@@ -7,37 +7,130 @@
 //
 
 #include "graph_converter.h"
+#include <algorithm>
+#include <boost/bind/bind.hpp>
 #include <boost/lexical_cast.hpp>
 
+namespace {
+	using mobile_sensing_sim::ContactList;
+	using mobile_sensing_sim::ContactSlice;
+	using mobile_sensing_sim::ThreadPool;
+	
+	// Windows of slices or phones per thread when building a graph,
+	// so threads given dense windows do not hold up the others.
+	const int kWindowsPerThread = 4;
+	
+	// Split [0, count) into window_count windows, window w is
+	// [bounds[w], bounds[w + 1]).
+	void SplitWindows(int count, int window_count, std::vector<int>& bounds) {
+		window_count = std::max(1, std::min(window_count, count));
+		bounds.resize(window_count + 1);
+		for (int w = 0; w <= window_count; ++w) {
+			bounds[w] = static_cast<long long>(count) * w / window_count;
+		}
+	}
+	
+	// Run task on pool, or right away without one.
+	void RunTask(ThreadPool* pool, const ThreadPool::Task& task) {
+		if (pool == NULL) {
+			task();
+		} else {
+			pool->Submit(task);
+		}
+	}
+	
+	void WaitTasks(ThreadPool* pool) {
+		if (pool != NULL) {
+			pool->Wait();
+		}
+	}
+	
+	// One side of Adjacency: arcs grouped by ends[arc] with a stable
+	// counting sort. Counts are shifted by one more slot so that the
+	// scatter moves offsets[v + 1] from the start to the end of v.
+	void BuildArcIndex(int vertex_count, const std::vector<int>& ends, std::vector<int>& offsets, std::vector<int>& arcs) {
+		const int kEdgeCount = ends.size();
+		const int *end_ids = ends.data();
+		offsets.assign(vertex_count + 2, 0);
+		int *begins = offsets.data();
+		for (int k = 0; k < kEdgeCount; ++k) {
+			++begins[end_ids[k] + 2];
+		}
+		for (int v = 2; v <= vertex_count; ++v) {
+			begins[v] += begins[v - 1];
+		}
+		arcs.resize(kEdgeCount);
+		int *arc_ids = arcs.data();
+		for (int k = 0; k < kEdgeCount; ++k) {
+			arc_ids[begins[end_ids[k] + 1]++] = k;
+		}
+		offsets.pop_back();
+	}
+	
+	std::string PhoneName(int time, int index) {
+		return "Phone " + boost::lexical_cast<std::string>(index) + " at time " + boost::lexical_cast<std::string>(time);
+	}
+	
+	int FindRoot(std::vector<int>& parent, int i) {
+		while (parent[i] != i) {
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	}
+	
+	// Component of every phone under the phone contacts of slice.
+	void FindComponents(const ContactSlice& slice, int phone_count, std::vector<int>& comp) {
+		comp.resize(phone_count);
+		for (int i = 0; i < phone_count; ++i) {
+			comp[i] = i;
+		}
+		for (int i = 0; i < phone_count; ++i) {
+			for (int k = slice.offsets[i]; k < slice.offsets[i + 1] && slice.ids[k] < phone_count; ++k) {
+				int r1 = FindRoot(comp, i);
+				int r2 = FindRoot(comp, slice.ids[k]);
+				if (r1 != r2) {
+					comp[std::max(r1, r2)] = std::min(r1, r2);
+				}
+			}
+		}
+		for (int i = 0; i < phone_count; ++i) {
+			comp[i] = FindRoot(comp, i);
+		}
+	}
+	
+	// Whether the phone contacts of row i differ from time - 1 or
+	// a new target is in range.
+	bool RowChanged(const ContactList& contacts, int time, int i) {
+		const int kPhoneCount = contacts.PhoneCount();
+		const ContactSlice &cur = contacts.Slice(time);
+		const ContactSlice &prev = contacts.Slice(time - 1);
+		int k = cur.offsets[i];
+		int l = prev.offsets[i];
+		const int kEnd = cur.offsets[i + 1];
+		const int kPrevEnd = prev.offsets[i + 1];
+		for (; k < kEnd && cur.ids[k] < kPhoneCount; ++k, ++l) {
+			if (l == kPrevEnd || prev.ids[l] != cur.ids[k]) {
+				return true;
+			}
+		}
+		if (l < kPrevEnd && prev.ids[l] < kPhoneCount) {
+			return true;
+		}
+		for (; k < kEnd; ++k) {
+			if (!contacts.IsConnected(time - 1, i, cur.ids[k])) {
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
 namespace mobile_sensing_sim {
 	double Graph::kInfinity = 1.0E+20;
 	void GraphConverter::ConvertToGraph(const Scenario& scen) {
 		Clear();
-		Graph &g = g_;
-		g.Clear();
-		// Suppose there are n phones, m targets running for T times.
-		// Vertices count: n * T + m + 2 (2 is for source and sink)
-		// n * T nodes are arranged in the sequence of time.
-		g.vertex_count = scen.phone_count * scen.running_time + scen.target_count + 2;
-		
-		// Save frequently used IDs.
-		const int kSinkID = g.vertex_count - 1;
-		const int kSourceID = g.vertex_count - 2;
-		g_.source_id = kSourceID;
-		g_.sink_id = kSinkID;
-		std::vector<int> target_ids;
-		for (int i = 0; i < scen.target_count; ++i) {
-			target_ids.push_back(scen.phone_count * scen.running_time + i);
-		}
-		
-		///////////////////////////////////////////////
-		// Vertex supply
-		///////////////////////////////////////////////
-		
-		// Only source and sink have supplies = target count.
-		g.vertex_supply = std::vector<double>(g.vertex_count, 0.0);
-		g.vertex_supply[kSourceID] = scen.target_count;
-		g.vertex_supply[kSinkID] = -scen.target_count;
+		AddVertices(scen);
 		
 		///////////////////////////////////////////////
 		// Edges
@@ -61,97 +154,362 @@ namespace mobile_sensing_sim {
 		//    Note: the capcaty can be set to capacity of
 		//          phone's storage space
 		
+		AddSourceEdges(scen);
+		AddSinkEdges(scen);
+		
+		// Type 3 and 4 edges take two passes. Contact edges of every
+		// slice are counted, the prefix sums give where each slice
+		// starts, then all edges are set in place. Slices and phones
+		// are independent in both passes, so windows of them run on
+		// threads and the edge order is the same as built serially.
+		const ContactList &contacts = scen.contacts;
+		const int kRunningTime = scen.running_time;
+		assert(kRunningTime <= contacts.TimeSize());
+		if (!pool_ && thread_count_ != 1) {
+			pool_.reset(new ThreadPool(thread_count_));
+		}
+		ThreadPool *pool = pool_.get();
+		const int kWindowCount = pool == NULL ? 1 : pool->ThreadCount() * kWindowsPerThread;
+		std::vector<int> windows;
+		SplitWindows(kRunningTime, kWindowCount, windows);
+		
+		// Slice t starts at slice_begins[t], self edges at the end.
+		std::vector<int> slice_begins(kRunningTime + 1, 0);
+		for (int w = 0; w + 1 < windows.size(); ++w) {
+			RunTask(pool, boost::bind(&GraphConverter::CountContactEdges, this, &contacts, windows[w], windows[w + 1], &slice_begins[1]));
+		}
+		WaitTasks(pool);
+		slice_begins[0] = g_.edge_count;
+		for (int t = 0; t < kRunningTime; ++t) {
+			slice_begins[t + 1] += slice_begins[t];
+		}
+		const int kSelfBegin = slice_begins[kRunningTime];
+		ResizeEdges(kSelfBegin + scen.phone_count * std::max(kRunningTime - 1, 0));
+		
+		for (int w = 0; w + 1 < windows.size(); ++w) {
+			RunTask(pool, boost::bind(&GraphConverter::FillContactEdges, this, &scen, windows[w], windows[w + 1], &slice_begins[0]));
+		}
+		std::vector<int> phone_windows;
+		SplitWindows(scen.phone_count, kWindowCount, phone_windows);
+		for (int w = 0; w + 1 < phone_windows.size(); ++w) {
+			RunTask(pool, boost::bind(&GraphConverter::SetSelfEdges, this, boost::cref(scen), kSelfBegin, phone_windows[w], phone_windows[w + 1]));
+		}
+		WaitTasks(pool);
+	}
+	
+	void GraphConverter::ConvertToGraph(const Scenario& scen, GraphDelta& delta) {
+		std::vector<int> prev_tails, prev_heads;
+		prev_tails.swap(g_.edge_tails);
+		prev_heads.swap(g_.edge_heads);
+		ConvertToGraph(scen);
+		delta.MatchEdges(prev_tails, prev_heads, 0, g_);
+	}
+	
+	void GraphConverter::ConvertToEventGraph(const Scenario& scen) {
+		Clear();
+		const int kPhoneCount = scen.phone_count;
+		const int kRunningTime = scen.running_time;
+		const ContactList &contacts = scen.contacts;
+		assert(kRunningTime <= contacts.TimeSize());
+		
+		// Blocks: a phone starts a new block when a phone of its
+		// component before or after t changes its phone contacts or
+		// meets a new target. Data in a block whose component stays
+		// the same can be spread evenly over its seconds, so one vertex
+		// per block gives the same optimum.
+		std::vector<std::vector<int> > block_times(kPhoneCount);
+		std::vector<std::vector<int> > block_vertices(kPhoneCount);
+		int phone_vertex_count = 0;
+		std::vector<int> comp, prev_comp;
+		std::vector<char> comp_changed(kPhoneCount), prev_comp_changed(kPhoneCount);
+		std::vector<char> changed(kPhoneCount);
+		for (int t = 0; t < kRunningTime; ++t) {
+			FindComponents(contacts.Slice(t), kPhoneCount, comp);
+			std::fill(comp_changed.begin(), comp_changed.end(), 0);
+			std::fill(prev_comp_changed.begin(), prev_comp_changed.end(), 0);
+			for (int i = 0; i < kPhoneCount; ++i) {
+				if (t != 0 && RowChanged(contacts, t, i)) {
+					comp_changed[comp[i]] = 1;
+					prev_comp_changed[prev_comp[i]] = 1;
+				}
+			}
+			for (int i = 0; i < kPhoneCount; ++i) {
+				if (t == 0 || comp_changed[comp[i]] || prev_comp_changed[prev_comp[i]]) {
+					block_times[i].push_back(t);
+					block_vertices[i].push_back(phone_vertex_count++);
+				}
+			}
+			prev_comp.swap(comp);
+		}
+		
+		AddVertices(scen, phone_vertex_count);
+		
+		// Edges of the same types and order as ConvertToGraph.
+		AddSourceEdges(scen);
+		
+		// Type 2
+		for (int i = 0; i < kPhoneCount; ++i) {
+			Edge e;
+			e.tail = block_vertices[i].back();
+			e.head = g_.sink_id;
+			e.cost = scen.phones[i].costs_.upload_cost;
+			e.capacity_lower_bound = 0.0;
+			e.capacity_upper_bound = scen.phones[i].upload_limit_;
+			e.type = Edge::PHONE_TO_SINK;
+			e.time = e.end_time = kRunningTime - 1;
+			e.phone1_id = e.phone2_id = i;
+			e.target_id = -1;
+			e.target_seqid = -1;
+			AddEdge(e);
+		}
+		
+		// Type 3, edges are opened at the start of a block and collect
+		// the capacity of its later seconds. Rows do not change within
+		// a block, so row_edges follows the row order.
+		std::vector<int> block_index(kPhoneCount, -1);
+		std::vector<std::vector<int> > row_edges(kPhoneCount);
+		// Whether phone i starts a block in second t, rewritten for
+		// every phone each second.
+		std::vector<char> is_new_block(kPhoneCount);
+		for (int t = 0; t < kRunningTime; ++t) {
+			const ContactSlice &slice = contacts.Slice(t);
+			for (int i = 0; i < kPhoneCount; ++i) {
+				const int next = block_index[i] + 1;
+				is_new_block[i] = next < block_times[i].size() && block_times[i][next] == t;
+				if (is_new_block[i]) {
+					block_index[i] = next;
+					row_edges[i].clear();
+				}
+			}
+			for (int i = 0; i < kPhoneCount; ++i) {
+				const int kVertex = block_vertices[i][block_index[i]];
+				int row_edge = 0;
+				for (int k = slice.offsets[i]; k < slice.offsets[i + 1]; ++k) {
+					const int j = slice.ids[k];
+					if (i == j) {
+						continue;
+					}
+					if (j < kPhoneCount) {
+						// Type 3a
+						if (!is_new_block[i]) {
+							const int kEdge = row_edges[i][row_edge++];
+							g_.edge_capacity_uppper_bounds[kEdge] += slice.data[k];
+							g_.edge_info.end_times[kEdge] = t;
+							continue;
+						}
+						Edge e;
+						e.tail = kVertex;
+						e.head = block_vertices[j][block_index[j]];
+						e.cost = scen.phones[i].costs_.transfer_cost + scen.phones[j].costs_.transfer_cost;
+						e.capacity_lower_bound = 0.0;
+						e.capacity_upper_bound = slice.data[k];
+						e.type = Edge::PHONE_TO_PHONE;
+						e.time = e.end_time = t;
+						e.phone1_id = i;
+						e.phone2_id = j;
+						e.target_id = -1;
+						e.target_seqid = -1;
+						AddEdge(e);
+						row_edges[i].push_back(g_.edge_count - 1);
+					} else {
+						// Type 3b, new targets always start a block.
+						if (t != 0 && contacts.IsConnected(t - 1, i, j)) {
+							continue;
+						}
+						assert(is_new_block[i]);
+						const int tid = j - kPhoneCount;
+						Edge e;
+						e.tail = target_ids_[tid];
+						e.head = kVertex;
+						e.cost = scen.phones[i].costs_.sensing_cost;
+						e.capacity_lower_bound = 0.0;
+						e.capacity_upper_bound = slice.data[k];
+						e.type = Edge::TARGET_TO_PHONE;
+						e.time = e.end_time = t;
+						e.phone1_id = e.phone2_id = i;
+						e.target_id = j;
+						e.target_seqid = tid;
+						AddEdge(e);
+					}
+				}
+			}
+		}
+		
+		// Type 4, connecting consecutive blocks.
+		for (int i = 0; i < kPhoneCount; ++i) {
+			for (int b = 0; b + 1 < block_times[i].size(); ++b) {
+				Edge e;
+				e.tail = block_vertices[i][b];
+				e.head = block_vertices[i][b + 1];
+				e.cost = 0.0;
+				e.capacity_lower_bound = 0.0;
+				e.capacity_upper_bound = Graph::kInfinity;
+				e.type = Edge::PHONE_TO_SELF;
+				e.time = block_times[i][b];
+				e.end_time = block_times[i][b + 1] - 1;
+				e.phone1_id = e.phone2_id = i;
+				e.target_id = -1;
+				e.target_seqid = -1;
+				AddEdge(e);
+			}
+		}
+	}
+	
+	void GraphConverter::AddVertices(const Scenario& scen) {
+		// Suppose there are n phones, m targets running for T times.
+		// n * T phone vertices are arranged in the sequence of time.
+		AddVertices(scen, scen.phone_count * scen.running_time);
+	}
+	
+	void GraphConverter::AddVertices(const Scenario& scen, int phone_vertex_count) {
+		Graph &g = g_;
+		// Vertices count: phone vertices + m + 2 (2 is for source and sink)
+		g.vertex_count = phone_vertex_count + scen.target_count + 2;
+		g.DropAdjacency();
+		
+		// Save frequently used IDs.
+		const int kSinkID = g.vertex_count - 1;
+		const int kSourceID = g.vertex_count - 2;
+		g_.source_id = kSourceID;
+		g_.sink_id = kSinkID;
+		g_.edge_info.phone_count = scen.phone_count;
+		target_ids_.clear();
+		for (int i = 0; i < scen.target_count; ++i) {
+			target_ids_.push_back(phone_vertex_count + i);
+		}
+		
+		///////////////////////////////////////////////
+		// Vertex supply
+		///////////////////////////////////////////////
+		
+		// Only source and sink have supplies = target count.
+		g.vertex_supply = std::vector<double>(g.vertex_count, 0.0);
+		g.vertex_supply[kSourceID] = scen.target_count;
+		g.vertex_supply[kSinkID] = -scen.target_count;
 		g.edge_count = 0;
+	}
+	
+	void GraphConverter::AddSourceEdges(const Scenario& scen) {
 		// Type 1
 		for (int i = 0; i < scen.target_count; ++i) {
 			Edge e;
-			e.tail = kSourceID;
-			e.head = target_ids[i];
+			e.tail = g_.source_id;
+			e.head = target_ids_[i];
 			e.cost = 0.0;
 			e.capacity_lower_bound = 0.0;
 			e.capacity_upper_bound = 1.0;
-			e.name = "Source to Target " + boost::lexical_cast<std::string>(i);
 			e.type = Edge::SRC_TO_TARGET;
-			e.time = -1; // no time associated
+			e.time = e.end_time = -1; // no time associated
 			e.phone1_id = e.phone2_id = -1;
 			e.target_id = -1;
             e.target_seqid = i;
 			AddEdge(e);
 		}
-		
+	}
+	
+	void GraphConverter::AddSinkEdges(const Scenario& scen) {
 		// Type 2
 		for (int i = 0; i < scen.phone_count; ++i) {
 			Edge e;
 			e.tail = GetVertexID(scen.phone_count, scen.running_time - 1, i); // running time is 0-indexed
-			e.head = kSinkID;
+			e.head = g_.sink_id;
 			e.cost = scen.phones[i].costs_.upload_cost;
 			e.capacity_lower_bound = 0.0;
 			e.capacity_upper_bound = scen.phones[i].upload_limit_;
-			e.name = ConstructPhoneName(scen.running_time - 1, i) + " to Sink";
 			e.type = Edge::PHONE_TO_SINK;
-			e.time = scen.running_time - 1;
+			e.time = e.end_time = scen.running_time - 1;
 			e.phone1_id = e.phone2_id = i;
 			e.target_id = -1;
             e.target_seqid = -1;
 			AddEdge(e);
 		}
-		
+	}
+	
+	void GraphConverter::AddContactEdges(const Scenario& scen, const ContactList& contacts, int t) {
+		const int kFirstEdge = g_.edge_count;
+		ResizeEdges(kFirstEdge + ContactEdgeCount(contacts, t));
+		SetContactEdges(scen, contacts, t, kFirstEdge);
+	}
+	
+	int GraphConverter::ContactEdgeCount(const ContactList& contacts, int t) const {
+		const ContactSlice &slice = contacts.Slice(t);
+		const int kPhoneCount = contacts.PhoneCount();
+		int count = 0;
+		for (int i = 0; i < kPhoneCount; ++i) {
+			for (int k = slice.offsets[i]; k < slice.offsets[i + 1]; ++k) {
+				const int j = slice.ids[k];
+				if (i == j || (j >= kPhoneCount && t != 0 && contacts.IsConnected(t - 1, i, j))) {
+					continue;
+				}
+				++count;
+			}
+		}
+		return count;
+	}
+	
+	void GraphConverter::SetContactEdges(const Scenario& scen, const ContactList& contacts, int t, int first_edge) {
 		// Type 3
-		const ThreeDimVector<int> &am = scen.adj_mats;
-		assert(scen.running_time <= am.DimOneSize());
-		for (int t = 0; t < scen.running_time; ++t) {
-			for (int i = 0; i < am.DimTwoSize(); ++i) {
-				// Only add outgoing edges from i
-				// Incoming edges will be added in other
-				// adjacency matrices.
-				Edge e;
-				e.tail = GetVertexID(scen.phone_count, t, i);
-				e.capacity_lower_bound = 0.0;
-				e.time = t; // time associated
-				for (int j = 0; j < am.DimThreeSize(); ++j) {
-					if (i!=j && am(t, i, j) != 0) {
-						if (j < scen.phone_count) {
-							// Type 3a
-							e.head = GetVertexID(scen.phone_count, t, j);
-							e.cost = scen.phones[i].costs_.transfer_cost + scen.phones[j].costs_.transfer_cost;
-							const ThreeDimVector<double> &data_mats = scen.data_mats;
-							e.capacity_upper_bound = data_mats(t, i, j); // Example: 0.5 means: One data unit takes 1/0.5 = 2 sec to transmit
-							e.name = ConstructPhoneName(t, i) + " to " + ConstructPhoneName(t, j);
-							e.type = Edge::PHONE_TO_PHONE;
-							e.phone1_id = i;
-							e.phone2_id = j;
-							e.target_id= -1;
-                            e.target_seqid = -1;
-							AddEdge(e);
-						} else {
-							// Type 3b
-							// Only add edge if this is a new target to
-							// phone.
-							if (t != 0 && am(t-1, i, j) == 1.0) {
-								continue;
-							}
-							int tid = j - scen.phone_count;
-							e.tail = target_ids[tid];
-							e.head = GetVertexID(scen.phone_count, t, i);
-							e.cost = scen.phones[i].costs_.sensing_cost;
-							//e.cost = t;// The more time passed, the larger cost.
-							// e.cost = 0.0;
-							const ThreeDimVector<double> &data_mat = scen.data_mats;
-							e.capacity_upper_bound = data_mat(t, i, j);
-							e.name = "Target " + boost::lexical_cast<std::string>(tid) + " to " + ConstructPhoneName(t, i);
-							e.type = Edge::TARGET_TO_PHONE;
-							e.phone1_id = e.phone2_id = i;
-							e.target_id = j;
-                            e.target_seqid = tid;
-							AddEdge(e);
-						}
+		const ContactSlice &slice = contacts.Slice(t);
+		int edge_id = first_edge;
+		for (int i = 0; i < contacts.PhoneCount(); ++i) {
+			// Only add outgoing edges from i
+			// Incoming edges will be added in other
+			// rows.
+			Edge e;
+			e.tail = GetVertexID(scen.phone_count, t, i);
+			e.capacity_lower_bound = 0.0;
+			e.time = e.end_time = t; // time associated
+			for (int k = slice.offsets[i]; k < slice.offsets[i + 1]; ++k) {
+				const int j = slice.ids[k];
+				if (i == j) {
+					continue;
+				}
+				if (j < scen.phone_count) {
+					// Type 3a
+					e.head = GetVertexID(scen.phone_count, t, j);
+					e.cost = scen.phones[i].costs_.transfer_cost + scen.phones[j].costs_.transfer_cost;
+					e.capacity_upper_bound = slice.data[k]; // Example: 0.5 means: One data unit takes 1/0.5 = 2 sec to transmit
+					e.type = Edge::PHONE_TO_PHONE;
+					e.phone1_id = i;
+					e.phone2_id = j;
+					e.target_id= -1;
+                    e.target_seqid = -1;
+					SetEdge(edge_id++, e);
+				} else {
+					// Type 3b
+					// Only add edge if this is a new target to
+					// phone.
+					if (t != 0 && contacts.IsConnected(t - 1, i, j)) {
+						continue;
 					}
-				} // for j
-			} // for i
-		} // for t
-		
+					int tid = j - scen.phone_count;
+					e.tail = target_ids_[tid];
+					e.head = GetVertexID(scen.phone_count, t, i);
+					e.cost = scen.phones[i].costs_.sensing_cost;
+					//e.cost = t;// The more time passed, the larger cost.
+					// e.cost = 0.0;
+					e.capacity_upper_bound = slice.data[k];
+					e.type = Edge::TARGET_TO_PHONE;
+					e.phone1_id = e.phone2_id = i;
+					e.target_id = j;
+                    e.target_seqid = tid;
+					SetEdge(edge_id++, e);
+				}
+			} // for k
+		} // for i
+	}
+	
+	void GraphConverter::AddSelfEdges(const Scenario& scen) {
+		const int kFirstEdge = g_.edge_count;
+		ResizeEdges(kFirstEdge + scen.phone_count * std::max(scen.running_time - 1, 0));
+		SetSelfEdges(scen, kFirstEdge, 0, scen.phone_count);
+	}
+	
+	void GraphConverter::SetSelfEdges(const Scenario& scen, int first_edge, int first_phone, int end_phone) {
 		// Type 4
-		for (int i = 0; i < scen.phone_count; ++i) {
+		const int kEdgesPerPhone = std::max(scen.running_time - 1, 0);
+		for (int i = first_phone; i < end_phone; ++i) {
+			int edge_id = first_edge + i * kEdgesPerPhone;
 			for (int t = 0; t < scen.running_time - 1; ++t) {
 				Edge e;
 				e.tail = GetVertexID(scen.phone_count, t, i);
@@ -159,16 +517,42 @@ namespace mobile_sensing_sim {
 				e.cost = 0.0;
 				e.capacity_lower_bound = 0.0;
 				e.capacity_upper_bound = Graph::kInfinity;
-				e.name = ConstructPhoneName(t, i) + " to " + ConstructPhoneName(t + 1, i);
 				e.type = Edge::PHONE_TO_SELF;
-				e.time = t;
+				e.time = e.end_time = t;
 				e.phone1_id = e.phone2_id = i;
 				e.target_id = -1;
                 e.target_seqid = -1;
-				AddEdge(e);
+				SetEdge(edge_id++, e);
 			}
 		}
-		g.edges = edges_;
+	}
+	
+	void GraphConverter::CountContactEdges(const ContactList* contacts, int first_time, int end_time, int* counts) const {
+		for (int t = first_time; t < end_time; ++t) {
+			counts[t] = ContactEdgeCount(*contacts, t);
+		}
+	}
+	
+	void GraphConverter::FillContactEdges(const Scenario* scen, int first_time, int end_time, const int* slice_begins) {
+		for (int t = first_time; t < end_time; ++t) {
+			SetContactEdges(*scen, scen->contacts, t, slice_begins[t]);
+		}
+	}
+	
+	void GraphConverter::TruncateEdges(int edge_count) {
+		assert(edge_count <= g_.edge_count);
+		ResizeEdges(edge_count);
+	}
+	
+	void GraphConverter::ResizeEdges(int edge_count) {
+		g_.edge_heads.resize(edge_count);
+		g_.edge_tails.resize(edge_count);
+		g_.edge_costs.resize(edge_count);
+		g_.edge_capacity_lower_bounds.resize(edge_count);
+		g_.edge_capacity_uppper_bounds.resize(edge_count);
+		g_.edge_info.Resize(edge_count);
+		g_.edge_count = edge_count;
+		g_.DropAdjacency();
 	}
 	
 	void GraphConverter::AddEdge(const Edge &e) {
@@ -177,17 +561,141 @@ namespace mobile_sensing_sim {
 		g_.edge_costs.push_back(e.cost);
 		g_.edge_capacity_lower_bounds.push_back(e.capacity_lower_bound);
 		g_.edge_capacity_uppper_bounds.push_back(e.capacity_upper_bound);
-		edges_.push_back(e);
+		
+		// Only ids the type does not imply are stored.
+		EdgeInfo &info = g_.edge_info;
+		info.types.push_back(e.type);
+		info.times.push_back(e.time);
+		info.end_times.push_back(e.end_time);
+		info.phone1_ids.push_back(e.phone1_id);
+		info.second_ids.push_back(e.type == Edge::PHONE_TO_PHONE ? e.phone2_id : e.target_seqid);
 		++g_.edge_count;
+		g_.DropAdjacency();
 	}
 	
-	int GraphConverter::GetVertexID(int phone_count, int time, int index) {
-		// Both time and index should be 0-indexed
-		return time * phone_count + index;
+	void GraphConverter::SetEdge(int edge_id, const Edge &e) {
+		g_.edge_heads[edge_id] = e.head;
+		g_.edge_tails[edge_id] = e.tail;
+		g_.edge_costs[edge_id] = e.cost;
+		g_.edge_capacity_lower_bounds[edge_id] = e.capacity_lower_bound;
+		g_.edge_capacity_uppper_bounds[edge_id] = e.capacity_upper_bound;
+		
+		EdgeInfo &info = g_.edge_info;
+		info.types[edge_id] = e.type;
+		info.times[edge_id] = e.time;
+		info.end_times[edge_id] = e.end_time;
+		info.phone1_ids[edge_id] = e.phone1_id;
+		info.second_ids[edge_id] = e.type == Edge::PHONE_TO_PHONE ? e.phone2_id : e.target_seqid;
 	}
 	
-	std::string GraphConverter::ConstructPhoneName(int time, int index) {
-		return "Phone " + boost::lexical_cast<std::string>(index) + " at time " + boost::lexical_cast<std::string>(time);
+	void Adjacency::Build(int vertex_count, const std::vector<int>& tails, const std::vector<int>& heads) {
+		BuildArcIndex(vertex_count, tails, out_offsets, out_arcs);
+		BuildArcIndex(vertex_count, heads, in_offsets, in_arcs);
+	}
+	
+	const Adjacency& Graph::GetAdjacency() const {
+		if (!has_adjacency_) {
+			adjacency_.Build(vertex_count, edge_tails, edge_heads);
+			has_adjacency_ = true;
+		}
+		return adjacency_;
+	}
+	
+	Edge Graph::GetEdge(int edge_id) const {
+		Edge e;
+		e.type = edge_info.Type(edge_id);
+		e.head = edge_heads[edge_id];
+		e.tail = edge_tails[edge_id];
+		e.cost = edge_costs[edge_id];
+		e.capacity_lower_bound = edge_capacity_lower_bounds[edge_id];
+		e.capacity_upper_bound = edge_capacity_uppper_bounds[edge_id];
+		e.time = edge_info.times[edge_id];
+		e.end_time = edge_info.end_times[edge_id];
+		e.phone1_id = edge_info.phone1_ids[edge_id];
+		e.phone2_id = e.phone1_id;
+		e.target_id = -1;
+		e.target_seqid = -1;
+		switch (e.type) {
+			case Edge::SRC_TO_TARGET:
+				e.target_seqid = edge_info.second_ids[edge_id];
+				break;
+			case Edge::PHONE_TO_PHONE:
+				e.phone2_id = edge_info.second_ids[edge_id];
+				break;
+			case Edge::TARGET_TO_PHONE:
+				e.target_seqid = edge_info.second_ids[edge_id];
+				e.target_id = edge_info.phone_count + e.target_seqid;
+				break;
+			default:
+				break;
+		}
+		return e;
+	}
+	
+	std::string Graph::GetEdgeName(int edge_id) const {
+		const Edge e = GetEdge(edge_id);
+		switch (e.type) {
+			case Edge::SRC_TO_TARGET:
+				return "Source to Target " + boost::lexical_cast<std::string>(e.target_seqid);
+			case Edge::PHONE_TO_SINK:
+				return PhoneName(e.time, e.phone1_id) + " to Sink";
+			case Edge::PHONE_TO_PHONE:
+				return PhoneName(e.time, e.phone1_id) + " to " + PhoneName(e.time, e.phone2_id);
+			case Edge::TARGET_TO_PHONE:
+				return "Target " + boost::lexical_cast<std::string>(e.target_seqid) + " to " + PhoneName(e.time, e.phone1_id);
+			case Edge::PHONE_TO_SELF:
+				return PhoneName(e.time, e.phone1_id) + " to " + PhoneName(e.end_time + 1, e.phone1_id);
+		}
+		return "";
+	}
+	
+	void GraphDelta::MatchEdges(const std::vector<int>& prev_tails, const std::vector<int>& prev_heads, int prefix, const Graph& cur) {
+		Clear();
+		arc_origin.assign(cur.edge_count, -1);
+		for (int i = 0; i < prefix && i < cur.edge_count; ++i) {
+			arc_origin[i] = i;
+		}
+		
+		// Bucket previous edges by tail, sorted by head inside a bucket.
+		const int kPrevCount = prev_tails.size();
+		std::vector<int> begin(cur.vertex_count + 1, 0);
+		for (int k = 0; k < kPrevCount; ++k) {
+			if (prev_tails[k] < cur.vertex_count) {
+				++begin[prev_tails[k] + 1];
+			}
+		}
+		for (int v = 0; v < cur.vertex_count; ++v) {
+			begin[v + 1] += begin[v];
+		}
+		std::vector<std::pair<int, int> > bucket(begin[cur.vertex_count]); // (head, previous id)
+		std::vector<int> pos(begin.begin(), begin.end() - 1);
+		for (int k = 0; k < kPrevCount; ++k) {
+			if (prev_tails[k] < cur.vertex_count) {
+				bucket[pos[prev_tails[k]]++] = std::make_pair(prev_heads[k], prefix + k);
+			}
+		}
+		for (int v = 0; v < cur.vertex_count; ++v) {
+			std::sort(bucket.begin() + begin[v], bucket.begin() + begin[v + 1]);
+		}
+		
+		// Parallel edges are matched in order.
+		std::vector<bool> used(bucket.size(), false);
+		for (int i = prefix; i < cur.edge_count; ++i) {
+			const int tail = cur.edge_tails[i];
+			std::vector<std::pair<int, int> >::iterator it = std::lower_bound(bucket.begin() + begin[tail], bucket.begin() + begin[tail + 1], std::make_pair(cur.edge_heads[i], -1));
+			for (; it != bucket.begin() + begin[tail + 1] && it->first == cur.edge_heads[i]; ++it) {
+				if (!used[it - bucket.begin()]) {
+					used[it - bucket.begin()] = true;
+					arc_origin[i] = it->second;
+					break;
+				}
+			}
+		}
+	}
+	
+	int GraphConverter::GetVertexID(int phone_count, int time, int index) const {
+		// Both time and index should be 0-indexed
+		return time * phone_count + index;
 	}
 	
 	void GraphConverter::PrintInformation() {
@@ -206,12 +714,11 @@ namespace mobile_sensing_sim {
 //		}
 								
 		for (int i = 0; i < g_.edge_count; ++i) {
-			std::cout << "Edge " << i << ": " << edges_[i].name << " (" << g_.edge_tails[i] << " to " << g_.edge_heads[i] << "), Capacity: [" << g_.edge_capacity_lower_bounds[i] << "," << g_.edge_capacity_uppper_bounds[i] <<"]" << std::endl;
+			std::cout << "Edge " << i << ": " << g_.GetEdgeName(i) << " (" << g_.edge_tails[i] << " to " << g_.edge_heads[i] << "), Capacity: [" << g_.edge_capacity_lower_bounds[i] << "," << g_.edge_capacity_uppper_bounds[i] <<"]" << std::endl;
 		}
 	}
 	
 	void GraphConverter::Clear() {
-		edges_.clear();
 		g_.Clear();
 	}
 }
@@ -11,8 +11,11 @@
 
 #include <vector>
 #include <string>
+#include <boost/scoped_ptr.hpp>
 #include "../error_handler.h"
+#include "../thread_pool.h"
 #include "../scenario_generator/scenario_generator.h"
+#include "../scenario_generator/array_view.h"
 
 namespace mobile_sensing_sim {
 	struct Edge {
@@ -29,16 +32,71 @@ namespace mobile_sensing_sim {
 		double cost;
 		double capacity_lower_bound;
 		double capacity_upper_bound;
-		std::string name;
 		int time;
+		int end_time; // Last second of the edge, differs from time only in event graphs.
 		int phone1_id;
 		int phone2_id;
 		int target_id;
         int target_seqid;
 	};
 	
+	// Edge metadata in structure of arrays form, one entry per edge.
+	// Ids implied by the edge type are not stored, Graph::GetEdge
+	// fills them in.
+	struct EdgeInfo {
+		EdgeInfo() : phone_count(0) {}
+		int phone_count; // Target columns of the contact lists start here.
+		std::vector<unsigned char> types;
+		std::vector<int> times;
+		std::vector<int> end_times;
+		std::vector<int> phone1_ids;
+		std::vector<int> second_ids; // Phone 2 of type 3a, target sequence id of types 1 and 3b.
+		void Resize(int edge_count) {
+			types.resize(edge_count);
+			times.resize(edge_count);
+			end_times.resize(edge_count);
+			phone1_ids.resize(edge_count);
+			second_ids.resize(edge_count);
+		}
+		void Clear() {
+			Resize(0);
+		}
+		Edge::EdgeType Type(int edge_id) const {
+			return static_cast<Edge::EdgeType>(types[edge_id]);
+		}
+	};
+	
+	// Arcs of every vertex in compressed sparse row form. Arcs leaving
+	// v are out_arcs [out_offsets[v], out_offsets[v + 1]), arcs entering
+	// v are in_arcs [in_offsets[v], in_offsets[v + 1]), both in
+	// increasing edge id. Only edge ids are stored, tails, heads, costs
+	// and bounds are read from the edge arrays of the graph, see
+	// Graph::GetAdjacency.
+	struct Adjacency {
+		std::vector<int> out_offsets; // Size = vertex count + 1
+		std::vector<int> out_arcs; // Size = edge count
+		std::vector<int> in_offsets; // Size = vertex count + 1
+		std::vector<int> in_arcs; // Size = edge count
+		void Build(int vertex_count, const std::vector<int>& tails, const std::vector<int>& heads);
+		void Clear() {
+			out_offsets.clear();
+			out_arcs.clear();
+			in_offsets.clear();
+			in_arcs.clear();
+		}
+		ArrayView<int> OutArcs(int v) const {
+			return ArrayView<int>(out_arcs.data() + out_offsets[v], out_offsets[v + 1] - out_offsets[v]);
+		}
+		ArrayView<int> InArcs(int v) const {
+			return ArrayView<int>(in_arcs.data() + in_offsets[v], in_offsets[v + 1] - in_offsets[v]);
+		}
+	};
+	
+	// Min cost flow problem in structure of arrays form. Solvers borrow
+	// it from the converter, e.g. CPLEX takes the edge arrays as they
+	// are, so nothing is copied on the way.
 	struct Graph {
-		Graph() : vertex_count(0), edge_count(0){}
+		Graph() : vertex_count(0), edge_count(0), has_adjacency_(false) {}
 		int vertex_count;
 		int edge_count;
 		std::vector<double> vertex_supply; // Size = Vertex count
@@ -47,6 +105,7 @@ namespace mobile_sensing_sim {
 		std::vector<double> edge_costs; // Size = edge count
 		std::vector<double> edge_capacity_lower_bounds; // Size = edge count
 		std::vector<double> edge_capacity_uppper_bounds; // Size = edge count
+		EdgeInfo edge_info; // Size = edge count
 		static double kInfinity; // Infinity value
 		int source_id;
 		int sink_id;
@@ -59,36 +118,119 @@ namespace mobile_sensing_sim {
 			edge_costs.clear();
 			edge_capacity_lower_bounds.clear();
 			edge_capacity_uppper_bounds.clear();
-			edges.clear();
+			edge_info.Clear();
+			DropAdjacency();
 		}
-		std::vector<Edge> edges;
+		// Gather all data of an edge.
+		Edge GetEdge(int edge_id) const;
+		// Names are built on request, they are only used in logs.
+		std::string GetEdgeName(int edge_id) const;
+		// Arc index of the edges. The first flow engine asking for it
+		// builds it, later solves of the same graph share it. Not to be
+		// called from several threads at once.
+		const Adjacency& GetAdjacency() const;
+		// Call after changing vertices or edge ends. GraphConverter
+		// does when it resizes or adds edges.
+		void DropAdjacency() {
+			has_adjacency_ = false;
+		}
+	private:
+		mutable Adjacency adjacency_;
+		mutable bool has_adjacency_;
+	};
+	
+	// Difference of a graph to the previously solved one, flow
+	// engines use it to warm start from their last basis.
+	struct GraphDelta {
+		void Clear() {
+			arc_origin.clear();
+		}
+		
+		// Edge i was edge arc_origin[i] of the previous graph, -1 if it
+		// is new. Previous edges not referenced any more are removed.
+		std::vector<int> arc_origin;
+		
+		// Keep the first prefix edges and match the others to previous
+		// edges [prefix, prefix + prev_tails.size()) with the same end
+		// vertices.
+		void MatchEdges(const std::vector<int>& prev_tails, const std::vector<int>& prev_heads, int prefix, const Graph& cur);
 	};
 	
 	class GraphConverter {
 	public:
+		GraphConverter() : thread_count_(1) {}
+		// Threads building the graph of ConvertToGraph, each takes
+		// windows of time slices or phones. 1 (the default) builds it
+		// on the calling thread, <= 0 uses all hardware threads. The
+		// graph, edge order included, does not depend on it. Threads
+		// start at the first conversion and are kept for later ones.
+		void SetThreadCount(int thread_count) {
+			if (thread_count != thread_count_) {
+				pool_.reset();
+			}
+			thread_count_ = thread_count;
+		}
 		void ConvertToGraph(const Scenario& scen);
+		// Also describe the new graph relative to the previous one.
+		void ConvertToGraph(const Scenario& scen, GraphDelta& delta);
+		// Same flow problem with idle seconds collapsed. A phone only
+		// gets a vertex when the contacts of its component change, so
+		// vertices stand for time blocks and contacts of a block are
+		// one edge with the summed capacity. The optimum equals the one
+		// of ConvertToGraph, edge times give the first and last second.
+		void ConvertToEventGraph(const Scenario& scen);
 		std::string GetVertexName(int vertex_id) const;
 		const Edge GetEdge(int edge_id) const {
-			if (edges_.empty()) {
+			if (g_.edge_count == 0) {
 				ErrorHandler::RunningError("Failed to get edge. Edge vector is empty!");
 			}
-			return edges_[edge_id];
+			return g_.GetEdge(edge_id);
+		}
+		std::string GetEdgeName(int edge_id) const {
+			return g_.GetEdgeName(edge_id);
 		}
 		const Graph& GetGraph() const{
 			return g_;
 		}
 		void AddEdge(const Edge &e);
-		const std::vector<Edge>& GetEdges() {
-			return edges_;
-		}
 		
 		void PrintInformation();
 		void Clear();
-	private:
-		int GetVertexID(int phone_count, int time, int index);
+	protected:
+		// Graph building steps, edges are appended in the order
+		// ConvertToGraph uses.
+		void AddVertices(const Scenario& scen);
+		void AddVertices(const Scenario& scen, int phone_vertex_count);
+		void AddSourceEdges(const Scenario& scen);
+		void AddSinkEdges(const Scenario& scen);
+		void AddContactEdges(const Scenario& scen, const ContactList& contacts, int t);
+		void AddSelfEdges(const Scenario& scen);
+		// Drop all edges from edge_count on.
+		void TruncateEdges(int edge_count);
+		
+		// Edges are also placed in two passes: edge arrays are resized
+		// to the counted edges, which are then set in place. Different
+		// edges can be set from different threads.
+		void ResizeEdges(int edge_count);
+		void SetEdge(int edge_id, const Edge& e);
+		// Type 3 edges of slice t, set from first_edge on.
+		int ContactEdgeCount(const ContactList& contacts, int t) const;
+		void SetContactEdges(const Scenario& scen, const ContactList& contacts, int t, int first_edge);
+		// Type 4 edges of phones [first_phone, end_phone), the ones of
+		// phone 0 start at first_edge.
+		void SetSelfEdges(const Scenario& scen, int first_edge, int first_phone, int end_phone);
+		
+		int GetVertexID(int phone_count, int time, int index) const;
 		Graph g_;
-		std::vector<Edge> edges_;
-		std::string ConstructPhoneName(int time, int index);
+		std::vector<int> target_ids_;
+	private:
+		// Tasks of ConvertToGraph over windows of slices or phones.
+		// counts[t] is set to the type 3 edge count of slice t.
+		void CountContactEdges(const ContactList* contacts, int first_time, int end_time, int* counts) const;
+		void FillContactEdges(const Scenario* scen, int first_time, int end_time, const int* slice_begins);
+		
+		int thread_count_;
+		boost::scoped_ptr<ThreadPool> pool_; // NULL with one thread.
 	};
 }
 
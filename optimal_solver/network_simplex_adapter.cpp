@@ -0,0 +1,629 @@
+//
+//  network_simplex_adapter.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/2/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <algorithm>
+#include "network_simplex_adapter.h"
+
+namespace {
+  const int kMinBlockSize = 10;
+  const double kFlowEpsilon = 1.0E-9;
+}
+
+namespace mobile_sensing_sim {
+  bool NetworkSimplexAdapter::Solve(const Graph &g, Solution &s) {
+    s.Clear();
+    s.is_valid = false;
+
+    if (g.vertex_count != g.vertex_supply.size() || g.edge_count != g.edge_tails.size()) {
+      ErrorHandler::RunningWarning("Network simplex: graph dimensions do not match its arrays!");
+      return false;
+    }
+
+    const bool has_basis = Init(g);
+    const int status = has_basis ? Run() : Solution::INFEASIBLE;
+    has_basis_ = status == Solution::OPTIMAL;
+
+    WriteSolution(g, status, has_basis, s);
+    return true;
+  }
+
+  bool NetworkSimplexAdapter::Resolve(const Graph &g, const GraphDelta &delta, Solution &s) {
+    if (!has_basis_ || g.vertex_count != node_num_ || delta.arc_origin.size() != g.edge_count) {
+      return Solve(g, s);
+    }
+
+    s.Clear();
+    s.is_valid = false;
+
+    if (g.vertex_count != g.vertex_supply.size() || g.edge_count != g.edge_tails.size()) {
+      ErrorHandler::RunningWarning("Network simplex: graph dimensions do not match its arrays!");
+      return false;
+    }
+
+    if (!WarmInit(g, delta)) {
+      return Solve(g, s);
+    }
+
+    // Which supplies an infeasible run leaves unmet depends on the
+    // artificial arcs still in the tree, so only a cold solve gives
+    // the same flow as Solve.
+    const int status = Run();
+    if (status != Solution::OPTIMAL) {
+      return Solve(g, s);
+    }
+    has_basis_ = true;
+
+    WriteSolution(g, status, true, s);
+    return true;
+  }
+
+  bool NetworkSimplexAdapter::LoadGraph(const Graph &g) {
+    node_num_ = g.vertex_count;
+    arc_num_ = g.edge_count;
+    all_arc_num_ = arc_num_ + node_num_;
+    root_ = node_num_;
+
+    source_.resize(all_arc_num_);
+    target_.resize(all_arc_num_);
+    cap_.resize(all_arc_num_);
+    cost_.resize(all_arc_num_);
+    flow_.assign(all_arc_num_, 0.0);
+    state_.resize(all_arc_num_);
+
+    supply_.resize(node_num_ + 1);
+    pi_.resize(node_num_ + 1);
+    parent_.resize(node_num_ + 1);
+    pred_.resize(node_num_ + 1);
+    thread_.resize(node_num_ + 1);
+    rev_thread_.resize(node_num_ + 1);
+    succ_num_.resize(node_num_ + 1);
+    last_succ_.resize(node_num_ + 1);
+    pred_dir_.resize(node_num_ + 1);
+
+    // Copy supplies and arcs. Lower bounds are removed by
+    // shifting them into the supplies of both end points.
+    std::copy(g.vertex_supply.begin(), g.vertex_supply.end(), supply_.begin());
+    max_cost_ = 0.0;
+    for (int e = 0; e < arc_num_; ++e) {
+      const int tail = g.edge_tails[e];
+      const int head = g.edge_heads[e];
+      const double lower = g.edge_capacity_lower_bounds[e];
+      const double upper = g.edge_capacity_uppper_bounds[e];
+      source_[e] = tail;
+      target_[e] = head;
+      cost_[e] = g.edge_costs[e];
+      if (upper >= Graph::kInfinity) {
+        cap_[e] = Graph::kInfinity;
+      } else {
+        cap_[e] = upper - lower;
+        if (cap_[e] < 0.0) {
+          // Lower bound above upper bound, no feasible flow.
+          return false;
+        }
+      }
+      if (lower != 0.0) {
+        supply_[tail] -= lower;
+        supply_[head] += lower;
+      }
+      max_cost_ = std::max(max_cost_, std::abs(cost_[e]));
+    }
+
+    double sum_supply = 0.0;
+    for (int u = 0; u < node_num_; ++u) {
+      sum_supply += supply_[u];
+    }
+    if (std::abs(sum_supply) > kFlowEpsilon) {
+      // Unbalanced supplies.
+      return false;
+    }
+    supply_[root_] = 0.0;
+
+    art_cost_ = (max_cost_ + 1) * (node_num_ + 1);
+    epsilon_ = art_cost_ * 1.0E-12;
+
+    block_size_ = std::max(static_cast<int>(std::sqrt(static_cast<double>(arc_num_))), kMinBlockSize);
+    next_arc_ = 0;
+    return true;
+  }
+
+  bool NetworkSimplexAdapter::Init(const Graph &g) {
+    if (!LoadGraph(g)) {
+      return false;
+    }
+    std::fill(state_.begin(), state_.begin() + arc_num_, static_cast<signed char>(STATE_LOWER));
+
+    // Initial tree: every vertex hangs on the root via an
+    // artificial arc carrying its supply.
+    parent_[root_] = -1;
+    pred_[root_] = -1;
+    thread_[root_] = 0;
+    rev_thread_[0] = root_;
+    succ_num_[root_] = node_num_ + 1;
+    last_succ_[root_] = root_ - 1;
+    pi_[root_] = 0.0;
+
+    for (int u = 0; u < node_num_; ++u) {
+      thread_[u] = u + 1;
+      rev_thread_[u + 1] = u;
+      succ_num_[u] = 1;
+      last_succ_[u] = u;
+      HangOnRoot(u, supply_[u]);
+      pi_[u] = pred_dir_[u] == DIR_UP ? 0.0 : art_cost_;
+    }
+
+    return true;
+  }
+
+  void NetworkSimplexAdapter::HangOnRoot(int u, double excess) {
+    // Excess is sent up to the root for free, a deficit is
+    // covered by the root at the artificial cost.
+    const int e = arc_num_ + u;
+    parent_[u] = root_;
+    pred_[u] = e;
+    cap_[e] = Graph::kInfinity;
+    state_[e] = STATE_TREE;
+    if (excess >= 0) {
+      pred_dir_[u] = DIR_UP;
+      source_[e] = u;
+      target_[e] = root_;
+      flow_[e] = excess;
+      cost_[e] = 0.0;
+    } else {
+      pred_dir_[u] = DIR_DOWN;
+      source_[e] = root_;
+      target_[e] = u;
+      flow_[e] = -excess;
+      cost_[e] = art_cost_;
+    }
+  }
+
+  bool NetworkSimplexAdapter::WarmInit(const Graph &g, const GraphDelta &delta) {
+    // Keep what is needed of the previous basis.
+    const int old_arc_num = arc_num_;
+    std::vector<int> old_source, old_target;
+    std::vector<signed char> old_state;
+    old_source.swap(source_);
+    old_target.swap(target_);
+    old_state.swap(state_);
+    std::vector<int> order;
+    order.reserve(node_num_);
+    for (int u = thread_[root_]; u != root_; u = thread_[u]) {
+      order.push_back(u);
+    }
+
+    if (!LoadGraph(g)) {
+      return false;
+    }
+
+    // Arcs kept keep their state, new arcs start at their lower bound.
+    std::vector<int> old_to_new(old_arc_num, -1);
+    for (int e = 0; e < arc_num_; ++e) {
+      const int o = delta.arc_origin[e];
+      state_[e] = STATE_LOWER;
+      if (o < 0 || o >= old_arc_num || old_source[o] != source_[e] || old_target[o] != target_[e]) {
+        continue;
+      }
+      old_to_new[o] = e;
+      state_[e] = old_state[o];
+      if (state_[e] == STATE_UPPER && cap_[e] >= Graph::kInfinity) {
+        state_[e] = STATE_LOWER;
+      }
+    }
+    for (int e = arc_num_; e < all_arc_num_; ++e) {
+      state_[e] = STATE_LOWER;
+    }
+
+    // Excess each vertex has to send up the tree given the flows
+    // on the non tree arcs.
+    std::vector<double> excess(supply_.begin(), supply_.end());
+    for (int e = 0; e < arc_num_; ++e) {
+      if (state_[e] == STATE_UPPER) {
+        flow_[e] = cap_[e];
+        excess[source_[e]] -= cap_[e];
+        excess[target_[e]] += cap_[e];
+      }
+    }
+
+    // Children are visited before their parents. A tree arc that was
+    // removed or cannot carry the flow of its subtree is cut and the
+    // subtree hangs on the root from then on.
+    for (int k = order.size() - 1; k >= 0; --k) {
+      const int u = order[k];
+      const int e = pred_[u] < old_arc_num ? old_to_new[pred_[u]] : -1;
+      const double excess_u = excess[u];
+      if (e == -1) {
+        HangOnRoot(u, excess_u);
+        continue;
+      }
+      pred_[u] = e;
+      const int p = parent_[u];
+      double f = pred_dir_[u] == DIR_UP ? excess_u : -excess_u;
+      if (f >= -epsilon_ && f <= cap_[e] + epsilon_) {
+        flow_[e] = std::min(std::max(f, 0.0), cap_[e]);
+        excess[p] += excess_u;
+        continue;
+      }
+      const double bound = f < 0.0 ? 0.0 : cap_[e];
+      state_[e] = f < 0.0 ? STATE_LOWER : STATE_UPPER;
+      flow_[e] = bound;
+      if (pred_dir_[u] == DIR_UP) {
+        excess[p] += bound;
+        HangOnRoot(u, excess_u - bound);
+      } else {
+        excess[p] -= bound;
+        HangOnRoot(u, excess_u + bound);
+      }
+    }
+
+    RebuildThread();
+
+    // Potentials follow from zero reduced costs on tree arcs.
+    pi_[root_] = 0.0;
+    for (int u = thread_[root_]; u != root_; u = thread_[u]) {
+      const int e = pred_[u];
+      pi_[u] = pred_dir_[u] == DIR_UP ? pi_[parent_[u]] - cost_[e] : pi_[parent_[u]] + cost_[e];
+    }
+    return true;
+  }
+
+  void NetworkSimplexAdapter::RebuildThread() {
+    // Children lists, then a depth first preorder from the root.
+    std::vector<int> first_child(node_num_ + 1, -1);
+    std::vector<int> next_sibling(node_num_ + 1, -1);
+    for (int u = node_num_ - 1; u >= 0; --u) {
+      next_sibling[u] = first_child[parent_[u]];
+      first_child[parent_[u]] = u;
+    }
+    parent_[root_] = -1;
+    pred_[root_] = -1;
+
+    std::vector<int> order;
+    order.reserve(node_num_ + 1);
+    std::vector<int> stack(1, root_);
+    while (!stack.empty()) {
+      const int u = stack.back();
+      stack.pop_back();
+      order.push_back(u);
+      // Push in reverse so that children keep their list order.
+      const int mark = stack.size();
+      for (int c = first_child[u]; c != -1; c = next_sibling[c]) {
+        stack.push_back(c);
+      }
+      std::reverse(stack.begin() + mark, stack.end());
+    }
+
+    for (int k = 0; k <= node_num_; ++k) {
+      const int u = order[k];
+      const int next = order[(k + 1) % (node_num_ + 1)];
+      thread_[u] = next;
+      rev_thread_[next] = u;
+      succ_num_[u] = 1;
+    }
+    for (int k = node_num_; k > 0; --k) {
+      succ_num_[parent_[order[k]]] += succ_num_[order[k]];
+    }
+    for (int k = 0; k <= node_num_; ++k) {
+      last_succ_[order[k]] = order[k + succ_num_[order[k]] - 1];
+    }
+  }
+
+  bool NetworkSimplexAdapter::FindEnteringArc() {
+    // Block search: scan arcs in blocks and take the most violating
+    // arc of the first block containing a violating one.
+    double min = -epsilon_;
+    int cnt = block_size_;
+    int e;
+    bool found = false;
+    for (e = next_arc_; e != arc_num_; ++e) {
+      double c = state_[e] * (cost_[e] + pi_[source_[e]] - pi_[target_[e]]);
+      if (c < min) {
+        min = c;
+        in_arc_ = e;
+        found = true;
+      }
+      if (--cnt == 0) {
+        if (found) {
+          next_arc_ = e;
+          return true;
+        }
+        cnt = block_size_;
+      }
+    }
+    for (e = 0; e != next_arc_; ++e) {
+      double c = state_[e] * (cost_[e] + pi_[source_[e]] - pi_[target_[e]]);
+      if (c < min) {
+        min = c;
+        in_arc_ = e;
+        found = true;
+      }
+      if (--cnt == 0) {
+        if (found) {
+          next_arc_ = e;
+          return true;
+        }
+        cnt = block_size_;
+      }
+    }
+    next_arc_ = e;
+    return found;
+  }
+
+  void NetworkSimplexAdapter::FindJoinNode() {
+    int u = source_[in_arc_];
+    int v = target_[in_arc_];
+    while (u != v) {
+      if (succ_num_[u] < succ_num_[v]) {
+        u = parent_[u];
+      } else {
+        v = parent_[v];
+      }
+    }
+    join_ = u;
+  }
+
+  bool NetworkSimplexAdapter::FindLeavingArc() {
+    // Flow is pushed along in_arc from first to second.
+    int first, second;
+    if (state_[in_arc_] == STATE_LOWER) {
+      first = source_[in_arc_];
+      second = target_[in_arc_];
+    } else {
+      first = target_[in_arc_];
+      second = source_[in_arc_];
+    }
+    delta_ = cap_[in_arc_];
+    int result = 0;
+
+    // Path from join down to first carries the cycle flow downwards.
+    for (int u = first; u != join_; u = parent_[u]) {
+      int e = pred_[u];
+      double d = flow_[e];
+      bool at_lower = true;
+      if (pred_dir_[u] == DIR_DOWN) {
+        d = cap_[e] >= Graph::kInfinity ? Graph::kInfinity : cap_[e] - d;
+        at_lower = false;
+      }
+      if (d < delta_) {
+        delta_ = d;
+        u_out_ = u;
+        out_at_lower_ = at_lower;
+        result = 1;
+      }
+    }
+
+    // Path from second up to join carries the cycle flow upwards.
+    for (int u = second; u != join_; u = parent_[u]) {
+      int e = pred_[u];
+      double d = flow_[e];
+      bool at_lower = true;
+      if (pred_dir_[u] == DIR_UP) {
+        d = cap_[e] >= Graph::kInfinity ? Graph::kInfinity : cap_[e] - d;
+        at_lower = false;
+      }
+      if (d <= delta_) {
+        delta_ = d;
+        u_out_ = u;
+        out_at_lower_ = at_lower;
+        result = 2;
+      }
+    }
+
+    if (result == 1) {
+      u_in_ = first;
+      v_in_ = second;
+    } else {
+      u_in_ = second;
+      v_in_ = first;
+    }
+
+    if (delta_ < 0.0) {
+      delta_ = 0.0;
+    }
+    return result != 0;
+  }
+
+  void NetworkSimplexAdapter::ChangeFlow(bool change) {
+    // Augment along the cycle.
+    if (delta_ > 0.0) {
+      double val = state_[in_arc_] * delta_;
+      flow_[in_arc_] += val;
+      for (int u = source_[in_arc_]; u != join_; u = parent_[u]) {
+        flow_[pred_[u]] -= pred_dir_[u] * val;
+      }
+      for (int u = target_[in_arc_]; u != join_; u = parent_[u]) {
+        flow_[pred_[u]] += pred_dir_[u] * val;
+      }
+    }
+
+    // Update the state of the entering and leaving arcs. The leaving
+    // arc is snapped onto its bound to keep rounding errors out of
+    // later ratio tests.
+    if (change) {
+      state_[in_arc_] = STATE_TREE;
+      int e = pred_[u_out_];
+      if (out_at_lower_) {
+        flow_[e] = 0.0;
+        state_[e] = STATE_LOWER;
+      } else {
+        flow_[e] = cap_[e];
+        state_[e] = STATE_UPPER;
+      }
+    } else {
+      flow_[in_arc_] = state_[in_arc_] == STATE_LOWER ? cap_[in_arc_] : 0.0;
+      state_[in_arc_] = -state_[in_arc_];
+    }
+  }
+
+  void NetworkSimplexAdapter::UpdateTreeStructure() {
+    int old_rev_thread = rev_thread_[u_out_];
+    int old_succ_num = succ_num_[u_out_];
+    int old_last_succ = last_succ_[u_out_];
+    v_out_ = parent_[u_out_];
+
+    if (u_in_ == u_out_) {
+      // Only the subtree of u_in is moved under v_in.
+      parent_[u_in_] = v_in_;
+      pred_[u_in_] = in_arc_;
+      pred_dir_[u_in_] = u_in_ == source_[in_arc_] ? DIR_UP : DIR_DOWN;
+
+      if (thread_[v_in_] != u_out_) {
+        int after = thread_[old_last_succ];
+        thread_[old_rev_thread] = after;
+        rev_thread_[after] = old_rev_thread;
+        after = thread_[v_in_];
+        thread_[v_in_] = u_out_;
+        rev_thread_[u_out_] = v_in_;
+        thread_[old_last_succ] = after;
+        rev_thread_[after] = old_last_succ;
+      }
+    } else {
+      // When old_rev_thread equals v_in, join and v_out coincide.
+      int thread_continue = old_rev_thread == v_in_ ? thread_[old_last_succ] : thread_[v_in_];
+
+      // Re-hang the stem nodes between u_in and u_out, reversing
+      // their parent relation and splicing their subtrees into the
+      // thread after v_in.
+      int stem = u_in_;
+      int par_stem = v_in_;
+      int next_stem;
+      int last = last_succ_[u_in_];
+      int before, after = thread_[last];
+      thread_[v_in_] = u_in_;
+      dirty_revs_.clear();
+      dirty_revs_.push_back(v_in_);
+      while (stem != u_out_) {
+        next_stem = parent_[stem];
+        thread_[last] = next_stem;
+        dirty_revs_.push_back(last);
+
+        before = rev_thread_[stem];
+        thread_[before] = after;
+        rev_thread_[after] = before;
+
+        parent_[stem] = par_stem;
+        par_stem = stem;
+        stem = next_stem;
+
+        last = last_succ_[stem] == last_succ_[par_stem] ? rev_thread_[par_stem] : last_succ_[stem];
+        after = thread_[last];
+      }
+      parent_[u_out_] = par_stem;
+      thread_[last] = thread_continue;
+      rev_thread_[thread_continue] = last;
+      last_succ_[u_out_] = last;
+
+      if (old_rev_thread != v_in_) {
+        thread_[old_rev_thread] = after;
+        rev_thread_[after] = old_rev_thread;
+      }
+
+      for (int i = 0; i < dirty_revs_.size(); ++i) {
+        int u = dirty_revs_[i];
+        rev_thread_[thread_[u]] = u;
+      }
+
+      // Fix pred, pred_dir, last_succ and succ_num along the stem.
+      int tmp_sc = 0;
+      int tmp_ls = last_succ_[u_out_];
+      for (int u = u_out_, p = parent_[u]; u != u_in_; u = p, p = parent_[u]) {
+        pred_[u] = pred_[p];
+        pred_dir_[u] = -pred_dir_[p];
+        tmp_sc += succ_num_[u] - succ_num_[p];
+        succ_num_[u] = tmp_sc;
+        last_succ_[p] = tmp_ls;
+      }
+      pred_[u_in_] = in_arc_;
+      pred_dir_[u_in_] = u_in_ == source_[in_arc_] ? DIR_UP : DIR_DOWN;
+      succ_num_[u_in_] = old_succ_num;
+    }
+
+    // Update last_succ from v_in towards the root.
+    int up_limit_out = last_succ_[join_] == v_in_ ? join_ : -1;
+    int last_succ_out = last_succ_[u_out_];
+    for (int u = v_in_; u != -1 && last_succ_[u] == v_in_; u = parent_[u]) {
+      last_succ_[u] = last_succ_out;
+    }
+
+    // Update last_succ from v_out towards the root.
+    if (join_ != old_rev_thread && v_in_ != old_rev_thread) {
+      for (int u = v_out_; u != up_limit_out && last_succ_[u] == old_last_succ; u = parent_[u]) {
+        last_succ_[u] = old_rev_thread;
+      }
+    } else if (last_succ_out != old_last_succ) {
+      for (int u = v_out_; u != up_limit_out && last_succ_[u] == old_last_succ; u = parent_[u]) {
+        last_succ_[u] = last_succ_out;
+      }
+    }
+
+    // Update succ_num from v_in and v_out to join.
+    for (int u = v_in_; u != join_; u = parent_[u]) {
+      succ_num_[u] += old_succ_num;
+    }
+    for (int u = v_out_; u != join_; u = parent_[u]) {
+      succ_num_[u] -= old_succ_num;
+    }
+  }
+
+  void NetworkSimplexAdapter::UpdatePotential() {
+    // Shift potentials of the moved subtree so that in_arc
+    // gets zero reduced cost.
+    double sigma = pi_[v_in_] - pi_[u_in_] - pred_dir_[u_in_] * cost_[in_arc_];
+    int end = thread_[last_succ_[u_in_]];
+    for (int u = u_in_; u != end; u = thread_[u]) {
+      pi_[u] += sigma;
+    }
+  }
+
+  int NetworkSimplexAdapter::Run() {
+    while (FindEnteringArc()) {
+      FindJoinNode();
+      bool change = FindLeavingArc();
+      if (delta_ >= Graph::kInfinity) {
+        return Solution::UNBOUNDED;
+      }
+      ChangeFlow(change);
+      if (change) {
+        UpdateTreeStructure();
+        UpdatePotential();
+      }
+    }
+
+    // Any flow left on artificial arcs means supplies cannot be met.
+    for (int e = arc_num_; e < all_arc_num_; ++e) {
+      if (std::abs(flow_[e]) > kFlowEpsilon) {
+        return Solution::INFEASIBLE;
+      }
+    }
+
+    return Solution::OPTIMAL;
+  }
+
+  void NetworkSimplexAdapter::WriteSolution(const Graph &g, int status, bool has_basis, Solution &s) const {
+    s.edge_count = g.edge_count;
+    s.vertex_count = g.vertex_count;
+    s.solution_status = status;
+    s.edge_values.resize(g.edge_count);
+    s.edge_costs.resize(g.edge_count);
+    s.obj = 0.0;
+
+    for (int e = 0; e < g.edge_count; ++e) {
+      double value = g.edge_capacity_lower_bounds[e];
+      double reduced_cost = g.edge_costs[e];
+      if (has_basis) {
+        value += flow_[e];
+        reduced_cost += pi_[g.edge_tails[e]] - pi_[g.edge_heads[e]];
+      }
+      s.edge_values[e] = value;
+      s.edge_costs[e] = reduced_cost;
+      s.obj += g.edge_costs[e] * value;
+    }
+
+    s.is_valid = true;
+  }
+}
@@ -0,0 +1,100 @@
+//
+//  network_simplex_adapter.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/2/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__network_simplex_adapter__
+#define __PhoneSim__network_simplex_adapter__
+
+#include <vector>
+#include "flow_adapter_base.h"
+#include "graph_converter.h"
+
+namespace mobile_sensing_sim {
+  // Primal network simplex working directly on the Graph vectors.
+  // The spanning tree is stored with parent / thread indices and an
+  // artificial root, arcs entering the basis are picked by block search.
+  //
+  // Resolve keeps the spanning tree of the last optimal solve. Tree
+  // arcs that were removed or cannot carry the new tree flow are cut
+  // and their subtrees re-hung on the root, so the set up is linear
+  // and the number of pivots grows with the size of the change. A
+  // warm run that does not end optimal is solved again from scratch.
+  class NetworkSimplexAdapter : public FlowAdapterBase {
+  public:
+    NetworkSimplexAdapter() : node_num_(0), arc_num_(0), all_arc_num_(0), root_(-1), has_basis_(false) {}
+    bool Solve(const Graph &g, Solution &s);
+    bool Resolve(const Graph &g, const GraphDelta &delta, Solution &s);
+  private:
+    enum ArcState {
+      STATE_UPPER = -1,
+      STATE_TREE = 0,
+      STATE_LOWER = 1
+    };
+
+    enum ArcDirection {
+      DIR_DOWN = -1,
+      DIR_UP = 1
+    };
+
+    bool LoadGraph(const Graph &g);
+    bool Init(const Graph &g);
+    bool WarmInit(const Graph &g, const GraphDelta &delta);
+    void HangOnRoot(int u, double excess);
+    void RebuildThread();
+    bool FindEnteringArc();
+    void FindJoinNode();
+    bool FindLeavingArc();
+    void ChangeFlow(bool change);
+    void UpdateTreeStructure();
+    void UpdatePotential();
+    int Run();
+    void WriteSolution(const Graph &g, int status, bool has_basis, Solution &s) const;
+
+    int node_num_;
+    int arc_num_;
+    int all_arc_num_;
+    int root_;
+    bool has_basis_; // The tree is optimal for the last graph.
+    double max_cost_;
+    double art_cost_;
+
+    // Arc data (original arcs first, then one artificial arc per vertex).
+    std::vector<int> source_;
+    std::vector<int> target_;
+    std::vector<double> cap_;
+    std::vector<double> cost_;
+    std::vector<double> flow_;
+    std::vector<signed char> state_;
+
+    // Vertex data.
+    std::vector<double> supply_;
+    std::vector<double> pi_;
+    std::vector<int> parent_;
+    std::vector<int> pred_;
+    std::vector<int> thread_;
+    std::vector<int> rev_thread_;
+    std::vector<int> succ_num_;
+    std::vector<int> last_succ_;
+    std::vector<signed char> pred_dir_;
+    std::vector<int> dirty_revs_;
+
+    // Pivot data.
+    int block_size_;
+    int next_arc_;
+    int in_arc_;
+    int join_;
+    int u_in_;
+    int v_in_;
+    int u_out_;
+    int v_out_;
+    double delta_;
+    bool out_at_lower_;
+    double epsilon_;
+  };
+}
+
+#endif /* defined(__PhoneSim__network_simplex_adapter__) */
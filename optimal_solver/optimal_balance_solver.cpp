@@ -71,7 +71,7 @@ namespace mobile_sensing_sim {
     oblog << "Objective status: " << s.solution_status << "\n";
     for (int i = 0; i < s.edge_values.size(); ++i) {
       if (s.edge_values[i] != 0.0 && gc_.GetEdge(i).type != Edge::PHONE_TO_SELF) {
-        oblog << "name: " << gc_.GetEdge(i).name << "\t value: " << s.edge_values[i] << "\n";
+        SIMLOG_TRACE(oblog) << "name: " << gc_.GetEdgeName(i) << "\t value: " << s.edge_values[i] << "\n";
       }
     }
     
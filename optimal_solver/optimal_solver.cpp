@@ -12,14 +12,25 @@
 namespace mobile_sensing_sim {
   Result OptimalSolver::Solve(const Scenario& scen) {
     olog.Reset();
-    gc_.ConvertToGraph(scen);
+    gc_.SetThreadCount(GetGraphThreadCount());
+    if (use_event_graph_) {
+      gc_.ConvertToEventGraph(scen);
+    } else {
+      gc_.ConvertToGraph(scen);
+    }
     const Graph& g = gc_.GetGraph();
+    olog << "Graph: " << g.vertex_count << " vertices, " << g.edge_count << " edges.\n";
     //		gc.PrintInformation();
     Solution s;
     if (UseMILP()) {
+#ifdef PHONESIM_WITH_CPLEX
       cplex_milp_adapter_.Solve(g, s);
+#else
+      ErrorHandler::RunningError("Optimal algorithm: MILP requires CPLEX!");
+#endif
     } else {
-      cplex_adapter_.Solve(g, s);
+      FlowAdapterPtr flow_adapter = FlowAdapterFactory::Create(GetFlowEngine(), GetFlowThreadCount());
+      flow_adapter->Solve(g, s);
     }
     
     // Recompute objective value as we may have used
@@ -67,7 +78,7 @@ namespace mobile_sensing_sim {
     olog << "Objective status: " << s.solution_status << "\n";
     for (int i = 0; i < s.edge_values.size(); ++i) {
       if (s.edge_values[i] != 0.0 && gc_.GetEdge(i).type != Edge::PHONE_TO_SELF) {
-        olog << "name: " << gc_.GetEdge(i).name << "\t value: " << s.edge_values[i] << "\n";
+        SIMLOG_TRACE(olog) << "name: " << gc_.GetEdgeName(i) << "\t value: " << s.edge_values[i] << "\n";
       }
     }
     
@@ -10,21 +10,33 @@
 #define __MobileSensingSim__optimal_solver__
 
 #include "../solver_base.h"
-#include "cplex_adapter.h"
+#include "flow_adapter_factory.h"
+#ifdef PHONESIM_WITH_CPLEX
 #include "cplex_milp_adapter.h"
+#endif
 
 namespace mobile_sensing_sim {
 
 	class OptimalSolver : public SolverBase {
 	public:
+		OptimalSolver() : use_event_graph_(false) {}
 		Result Solve(const Scenario& scen);
+		// Solve on the event graph or on the graph with one vertex per
+		// phone and second (default). The event graph reaches the same
+		// total cost, but its optimum may split it differently between
+		// phones and cost types.
+		void SetEventGraph(bool use_event_graph) {
+			use_event_graph_ = use_event_graph;
+		}
 		const GraphConverter& GetGraphConverter() {
 			return gc_;
 		}
 	private:
-		CplexAdapter cplex_adapter_;
+#ifdef PHONESIM_WITH_CPLEX
     CplexMILPAdapter cplex_milp_adapter_;
+#endif
 		GraphConverter gc_;
+		bool use_event_graph_;
 	};
 }
 
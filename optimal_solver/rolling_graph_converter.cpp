@@ -0,0 +1,72 @@
+//
+//  rolling_graph_converter.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/18/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include "rolling_graph_converter.h"
+
+namespace mobile_sensing_sim {
+	void RollingGraphConverter::Init(const Scenario& scen) {
+		scen_ = &scen;
+		horizon_ = 0;
+		contacts_.Resize(scen.running_time, scen.phone_count, scen.target_count);
+		executed_.Resize(scen.running_time, scen.phone_count, scen.target_count);
+		
+		Clear();
+		AddVertices(scen);
+		AddSourceEdges(scen);
+		AddSinkEdges(scen);
+		fixed_edge_count_ = g_.edge_count;
+		
+		// All layers are empty.
+		layer_begin_.assign(scen.running_time + 1, fixed_edge_count_);
+		Rebuild(scen.running_time);
+		delta_.Clear();
+		delta_.arc_origin.assign(g_.edge_count, -1);
+	}
+	
+	void RollingGraphConverter::SetExecuted(int time, int row, int col, double data) {
+		assert(scen_ != NULL && time >= horizon_);
+		executed_.SetContact(time, row, col, data);
+	}
+	
+	void RollingGraphConverter::SetPrediction(const ContactList& prediction, int time) {
+		assert(scen_ != NULL && time >= horizon_);
+		const int kRunningTime = scen_->running_time;
+		
+		// Freeze layers passed since the last horizon, only
+		// executed actions remain there.
+		for (int t = horizon_; t < time; ++t) {
+			contacts_.CopySlice(executed_, t);
+		}
+		for (int t = time; t < kRunningTime; ++t) {
+			contacts_.CopySlice(prediction, t);
+		}
+		
+		const int kFromTime = horizon_;
+		horizon_ = time;
+		Rebuild(kFromTime);
+	}
+	
+	void RollingGraphConverter::Rebuild(int from_time) {
+		const int kRunningTime = scen_->running_time;
+		
+		// Layers before from_time are kept as they are, edges
+		// from there on are matched to their previous version.
+		const int kPrefix = layer_begin_[from_time];
+		std::vector<int> prev_tails(g_.edge_tails.begin() + kPrefix, g_.edge_tails.end());
+		std::vector<int> prev_heads(g_.edge_heads.begin() + kPrefix, g_.edge_heads.end());
+		TruncateEdges(kPrefix);
+		for (int t = from_time; t < kRunningTime; ++t) {
+			layer_begin_[t] = g_.edge_count;
+			AddContactEdges(*scen_, contacts_, t);
+		}
+		layer_begin_[kRunningTime] = g_.edge_count;
+		AddSelfEdges(*scen_);
+		
+		delta_.MatchEdges(prev_tails, prev_heads, kPrefix, g_);
+	}
+}
@@ -0,0 +1,68 @@
+//
+//  rolling_graph_converter.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/18/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__rolling_graph_converter__
+#define __PhoneSim__rolling_graph_converter__
+
+#include <vector>
+#include "graph_converter.h"
+
+namespace mobile_sensing_sim {
+	// Graph of a rolling horizon run, kept up to date between report
+	// periods instead of being converted from scratch.
+	//
+	// Time layers before the horizon are frozen and only hold the
+	// actions executed there. Layers from the horizon on hold the
+	// predicted contacts. Each period the executed actions since the
+	// previous horizon are patched in, the predicted layers are
+	// replaced and only edges from the old horizon on are rebuilt.
+	// The graph is identical, edge order included, to ConvertToGraph
+	// of the fully replayed scenario.
+	class RollingGraphConverter : public GraphConverter {
+	public:
+		RollingGraphConverter() : scen_(NULL), horizon_(0) {}
+		
+		// Start a run on scen. Phones, costs and running time are
+		// taken from scen, which must outlive the converter.
+		void Init(const Scenario& scen);
+		
+		// Record an executed action at time (>= horizon), it replaces
+		// the prediction of that contact once the horizon moves past.
+		void SetExecuted(int time, int row, int col, double data);
+		
+		// Move the horizon to time and use the contacts of prediction
+		// for layers [time, running time). Rebuilds the graph.
+		void SetPrediction(const ContactList& prediction, int time);
+		
+		int Horizon() const {
+			return horizon_;
+		}
+		
+		const ContactList& GetContacts() const {
+			return contacts_;
+		}
+		
+		// Edges of the current graph relative to the graph before the
+		// last SetPrediction, edges before the old horizon are kept.
+		const GraphDelta& GetDelta() const {
+			return delta_;
+		}
+	private:
+		void Rebuild(int from_time);
+		
+		const Scenario *scen_;
+		int horizon_;
+		int fixed_edge_count_; // Type 1 and 2 edges.
+		std::vector<int> layer_begin_; // First edge of layer t, size = running time + 1.
+		ContactList contacts_; // Executed before horizon, predicted after.
+		ContactList executed_;
+		GraphDelta delta_;
+	};
+}
+
+#endif /* defined(__PhoneSim__rolling_graph_converter__) */
@@ -0,0 +1,197 @@
+//
+//  successive_path_adapter.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/30/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <algorithm>
+#include <functional>
+#include "successive_path_adapter.h"
+
+namespace {
+  const double kFlowEpsilon = 1.0E-9;
+}
+
+namespace mobile_sensing_sim {
+  bool SuccessivePathAdapter::Solve(const Graph &g, Solution &s) {
+    if (g.vertex_count != g.vertex_supply.size() || g.edge_count != g.edge_tails.size()) {
+      s.Clear();
+      s.is_valid = false;
+      ErrorHandler::RunningWarning("Successive paths: graph dimensions do not match its arrays!");
+      return false;
+    }
+    if (!IsSensingProblem(g)) {
+      return simplex_.Solve(g, s);
+    }
+
+    // Costs are not negative, so zero potentials start valid.
+    flow_.assign(g.edge_count, 0.0);
+    pi_.assign(g.vertex_count, 0.0);
+    dist_.resize(g.vertex_count);
+    pred_arc_.resize(g.vertex_count);
+    state_.assign(g.vertex_count, 0);
+    touched_.clear();
+
+    int status = Solution::OPTIMAL;
+    double remaining = g.vertex_supply[g.source_id];
+    while (remaining > kFlowEpsilon) {
+      if (!FindPath(g)) {
+        status = Solution::INFEASIBLE;
+        break;
+      }
+      remaining -= Augment(g, remaining);
+    }
+
+    WriteSolution(g, status, s);
+    return true;
+  }
+
+  bool SuccessivePathAdapter::IsSensingProblem(const Graph &g) {
+    if (g.source_id < 0 || g.source_id >= g.vertex_count || g.sink_id < 0 || g.sink_id >= g.vertex_count || g.source_id == g.sink_id) {
+      return false;
+    }
+    for (int v = 0; v < g.vertex_count; ++v) {
+      if (v != g.source_id && v != g.sink_id && g.vertex_supply[v] != 0.0) {
+        return false;
+      }
+    }
+    if (g.vertex_supply[g.source_id] < 0.0 || std::abs(g.vertex_supply[g.source_id] + g.vertex_supply[g.sink_id]) > kFlowEpsilon) {
+      return false;
+    }
+    for (int e = 0; e < g.edge_count; ++e) {
+      if (g.edge_costs[e] < 0.0 || g.edge_capacity_lower_bounds[e] != 0.0 || g.edge_capacity_uppper_bounds[e] < 0.0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool SuccessivePathAdapter::FindPath(const Graph &g) {
+    for (int k = 0; k < touched_.size(); ++k) {
+      state_[touched_[k]] = 0;
+    }
+    touched_.clear();
+    heap_.clear();
+
+    const Adjacency &adj = g.GetAdjacency();
+    std::greater<std::pair<double, int> > later;
+    dist_[g.source_id] = 0.0;
+    pred_arc_[g.source_id] = 0;
+    state_[g.source_id] = 1;
+    touched_.push_back(g.source_id);
+    heap_.push_back(std::make_pair(0.0, g.source_id));
+    while (!heap_.empty()) {
+      std::pop_heap(heap_.begin(), heap_.end(), later);
+      const double d = heap_.back().first;
+      const int u = heap_.back().second;
+      heap_.pop_back();
+      if (state_[u] == 2 || d > dist_[u]) {
+        continue;
+      }
+      state_[u] = 2;
+      if (u == g.sink_id) {
+        break;
+      }
+
+      // Residual arcs are forward arcs below capacity and backward
+      // arcs with flow, reduced costs of both are not negative up to
+      // rounding.
+      for (const int *it = adj.OutArcs(u).begin(); it != adj.OutArcs(u).end(); ++it) {
+        const int e = *it;
+        if (g.edge_capacity_uppper_bounds[e] - flow_[e] <= kFlowEpsilon) {
+          continue;
+        }
+        const int v = g.edge_heads[e];
+        const double nd = d + std::max(g.edge_costs[e] + pi_[u] - pi_[v], 0.0);
+        if (state_[v] == 0 || (state_[v] == 1 && nd < dist_[v])) {
+          if (state_[v] == 0) {
+            state_[v] = 1;
+            touched_.push_back(v);
+          }
+          dist_[v] = nd;
+          pred_arc_[v] = e + 1;
+          heap_.push_back(std::make_pair(nd, v));
+          std::push_heap(heap_.begin(), heap_.end(), later);
+        }
+      }
+      for (const int *it = adj.InArcs(u).begin(); it != adj.InArcs(u).end(); ++it) {
+        const int e = *it;
+        if (flow_[e] <= kFlowEpsilon) {
+          continue;
+        }
+        const int v = g.edge_tails[e];
+        const double nd = d + std::max(pi_[u] - pi_[v] - g.edge_costs[e], 0.0);
+        if (state_[v] == 0 || (state_[v] == 1 && nd < dist_[v])) {
+          if (state_[v] == 0) {
+            state_[v] = 1;
+            touched_.push_back(v);
+          }
+          dist_[v] = nd;
+          pred_arc_[v] = -(e + 1);
+          heap_.push_back(std::make_pair(nd, v));
+          std::push_heap(heap_.begin(), heap_.end(), later);
+        }
+      }
+    }
+    if (state_[g.sink_id] != 2) {
+      return false;
+    }
+
+    // Vertices settled before the sink move by their distance, the
+    // others by the sink distance. Shifted by the sink distance so
+    // that untouched vertices keep their potential.
+    const double kSinkDist = dist_[g.sink_id];
+    for (int k = 0; k < touched_.size(); ++k) {
+      const int v = touched_[k];
+      if (state_[v] == 2) {
+        pi_[v] += dist_[v] - kSinkDist;
+      }
+    }
+    return true;
+  }
+
+  double SuccessivePathAdapter::Augment(const Graph &g, double amount) {
+    for (int v = g.sink_id; v != g.source_id; ) {
+      const int a = pred_arc_[v];
+      if (a > 0) {
+        amount = std::min(amount, g.edge_capacity_uppper_bounds[a - 1] - flow_[a - 1]);
+        v = g.edge_tails[a - 1];
+      } else {
+        amount = std::min(amount, flow_[-a - 1]);
+        v = g.edge_heads[-a - 1];
+      }
+    }
+    for (int v = g.sink_id; v != g.source_id; ) {
+      const int a = pred_arc_[v];
+      if (a > 0) {
+        flow_[a - 1] += amount;
+        v = g.edge_tails[a - 1];
+      } else {
+        flow_[-a - 1] -= amount;
+        v = g.edge_heads[-a - 1];
+      }
+    }
+    return amount;
+  }
+
+  void SuccessivePathAdapter::WriteSolution(const Graph &g, int status, Solution &s) const {
+    s.Clear();
+    s.edge_count = g.edge_count;
+    s.vertex_count = g.vertex_count;
+    s.solution_status = status;
+    s.edge_values.resize(g.edge_count);
+    s.edge_costs.resize(g.edge_count);
+    s.obj = 0.0;
+
+    for (int e = 0; e < g.edge_count; ++e) {
+      s.edge_values[e] = flow_[e];
+      s.edge_costs[e] = g.edge_costs[e] + pi_[g.edge_tails[e]] - pi_[g.edge_heads[e]];
+      s.obj += g.edge_costs[e] * flow_[e];
+    }
+
+    s.is_valid = true;
+  }
+}
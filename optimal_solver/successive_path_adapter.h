@@ -0,0 +1,61 @@
+//
+//  successive_path_adapter.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/30/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__successive_path_adapter__
+#define __PhoneSim__successive_path_adapter__
+
+#include <vector>
+#include <utility>
+#include "flow_adapter_base.h"
+#include "graph_converter.h"
+#include "network_simplex_adapter.h"
+
+namespace mobile_sensing_sim {
+  // Successive shortest paths for the flow problems GraphConverter
+  // builds: the source supplies one unit per target, costs are not
+  // negative and lower bounds are zero. Paths from the source to the
+  // sink are found by Dijkstra on reduced costs, the potentials keep
+  // them non-negative as flow is pushed back in time on residual arcs.
+  //
+  // A search only touches vertices reachable from the source and
+  // stops once the sink is settled, so its work grows with the time
+  // layers after the contacts of the targets rather than with the
+  // graph. With a handful of targets a solve takes a few searches.
+  //
+  // Arcs are walked through the arc index of the graph, costs and
+  // bounds are read from its edge arrays. Graphs of another form are
+  // solved by network simplex.
+  class SuccessivePathAdapter : public FlowAdapterBase {
+  public:
+    SuccessivePathAdapter() {}
+    bool Solve(const Graph &g, Solution &s);
+  private:
+    // Supply only at the source, non-negative costs and no lower bounds.
+    static bool IsSensingProblem(const Graph &g);
+    // Shortest path from the source to the sink in the residual graph
+    // into pred_arc_, false if the sink cannot be reached.
+    bool FindPath(const Graph &g);
+    // Push up to amount along the path found, returns the amount pushed.
+    double Augment(const Graph &g, double amount);
+    void WriteSolution(const Graph &g, int status, Solution &s) const;
+
+    std::vector<double> flow_;
+    std::vector<double> pi_;
+
+    // Search data, only entries of touched_ vertices are valid.
+    std::vector<double> dist_;
+    std::vector<int> pred_arc_; // Forward arc e as e + 1, backward as -(e + 1).
+    std::vector<signed char> state_; // 0 untouched, 1 labeled, 2 settled.
+    std::vector<int> touched_;
+    std::vector<std::pair<double, int> > heap_; // (distance, vertex), min heap.
+
+    NetworkSimplexAdapter simplex_;
+  };
+}
+
+#endif /* defined(__PhoneSim__successive_path_adapter__) */
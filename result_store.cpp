@@ -0,0 +1,243 @@
+//
+//  result_store.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/26/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cstring>
+#include <fstream>
+#include <boost/filesystem.hpp>
+#include "error_handler.h"
+#include "result_store.h"
+
+namespace mobile_sensing_sim {
+  namespace {
+    const char kMagic[8] = {'P', 'H', 'R', 'E', 'S', '\0', '\0', '\0'};
+    const boost::uint32_t kByteOrder = 0x01020304;
+
+    // A block holds the runs of one AppendBinary call. It is followed
+    // by the solver names (uint32 length and bytes each), the run
+    // columns and the phone columns, every column stored whole.
+    struct BlockHeader {
+      char magic[8];
+      boost::uint32_t version;
+      boost::uint32_t byte_order;
+      boost::uint64_t run_count;
+      boost::uint64_t row_count;
+      boost::uint64_t name_count;
+    };
+
+    template <typename T>
+    void WriteColumn(std::ostream& os, const std::vector<T>& column) {
+      if (!column.empty()) {
+        os.write(reinterpret_cast<const char*>(&column[0]), column.size() * sizeof(T));
+      }
+    }
+
+    // Append count values read from is to column.
+    template <typename T>
+    bool ReadColumn(std::istream& is, boost::uint64_t count, std::vector<T>& column) {
+      const size_t kOldSize = column.size();
+      column.resize(kOldSize + count);
+      if (count > 0) {
+        is.read(reinterpret_cast<char*>(&column[kOldSize]), count * sizeof(T));
+      }
+      return is.good();
+    }
+  }
+
+  void ResultStore::AddRun(const std::string& solver, int seed, const Result& res) {
+    const int kPhoneCount = res.phone_cost.size();
+    solver_ids_.push_back(SolverId(solver));
+    phone_counts_.push_back(kPhoneCount);
+    seeds_.push_back(seed);
+    is_valids_.push_back(res.is_valid);
+    is_optimals_.push_back(res.is_optimal);
+    solution_statuses_.push_back(res.solution_status);
+    all_costs_.push_back(res.all_cost);
+    solve_seconds_.push_back(res.solve_seconds);
+    first_rows_.push_back(RowCount());
+    for (int k = 0; k < Cost::kTypeCount; ++k) {
+      const Cost::CostType kType = static_cast<Cost::CostType>(k);
+      for (int i = 0; i < kPhoneCount; ++i) {
+        costs_[k].push_back(res.phone_cost[i][kType]);
+      }
+    }
+  }
+
+  void ResultStore::Clear() {
+    *this = ResultStore();
+  }
+
+  int ResultStore::SolverId(const std::string& solver) {
+    for (int i = 0; i < solver_names_.size(); ++i) {
+      if (solver_names_[i] == solver) {
+        return i;
+      }
+    }
+    solver_names_.push_back(solver);
+    return solver_names_.size() - 1;
+  }
+
+  bool ResultStore::AppendBinary(const std::string& path) const {
+    std::ofstream os(path.c_str(), std::ios::binary | std::ios::app);
+    if (!os) {
+      ErrorHandler::RunningWarning("ResultStore::AppendBinary: cannot open " + path);
+      return false;
+    }
+
+    BlockHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.run_count = RunCount();
+    header.row_count = RowCount();
+    header.name_count = solver_names_.size();
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (int i = 0; i < solver_names_.size(); ++i) {
+      const boost::uint32_t kLength = solver_names_[i].size();
+      os.write(reinterpret_cast<const char*>(&kLength), sizeof(kLength));
+      os.write(solver_names_[i].data(), kLength);
+    }
+
+    WriteColumn(os, solver_ids_);
+    WriteColumn(os, phone_counts_);
+    WriteColumn(os, seeds_);
+    WriteColumn(os, is_valids_);
+    WriteColumn(os, is_optimals_);
+    WriteColumn(os, solution_statuses_);
+    WriteColumn(os, all_costs_);
+    WriteColumn(os, solve_seconds_);
+    for (int k = 0; k < Cost::kTypeCount; ++k) {
+      WriteColumn(os, costs_[k]);
+    }
+
+    if (!os.flush()) {
+      ErrorHandler::RunningWarning("ResultStore::AppendBinary: write failed for " + path);
+      return false;
+    }
+    return true;
+  }
+
+  bool ResultStore::ReadBinary(const std::string& path) {
+    std::ifstream is(path.c_str(), std::ios::binary);
+    if (!is) {
+      ErrorHandler::RunningWarning("ResultStore::ReadBinary: cannot open " + path);
+      return false;
+    }
+
+    boost::system::error_code ec;
+    const boost::uint64_t kFileSize = boost::filesystem::file_size(path, ec);
+    if (ec) {
+      ErrorHandler::RunningWarning("ResultStore::ReadBinary: cannot stat " + path);
+      return false;
+    }
+
+    // Read into a copy so a bad block leaves this store untouched.
+    ResultStore st = *this;
+    while (is.peek() != std::char_traits<char>::eof()) {
+      BlockHeader header;
+      if (!is.read(reinterpret_cast<char*>(&header), sizeof(header))
+          || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+          || header.byte_order != kByteOrder) {
+        ErrorHandler::RunningWarning("ResultStore::ReadBinary: not a result file " + path);
+        return false;
+      }
+      if (header.version != kVersion) {
+        ErrorHandler::RunningWarning("ResultStore::ReadBinary: unsupported version in " + path);
+        return false;
+      }
+
+      // Map solver ids of the block to ids of the store.
+      std::vector<int> ids(header.name_count);
+      for (int i = 0; i < ids.size(); ++i) {
+        boost::uint32_t length = 0;
+        is.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!is || length > kFileSize) {
+          break;
+        }
+        std::string name(length, '\0');
+        if (length > 0) {
+          is.read(&name[0], length);
+        }
+        if (!is) {
+          break;
+        }
+        ids[i] = st.SolverId(name);
+      }
+
+      // Check counts against the file before allocating columns.
+      const boost::uint64_t kRunBytes = 4 * sizeof(boost::int32_t) + 2 * sizeof(char) + 2 * sizeof(double);
+      const boost::uint64_t kRowBytes = Cost::kTypeCount * sizeof(double);
+      const boost::uint64_t kLeft = is.good() ? kFileSize - static_cast<boost::uint64_t>(is.tellg()) : 0;
+      const size_t kFirstRun = st.RunCount();
+      bool ok = is.good()
+          && header.run_count <= kLeft / kRunBytes
+          && header.row_count <= (kLeft - header.run_count * kRunBytes) / kRowBytes
+          && ReadColumn(is, header.run_count, st.solver_ids_)
+          && ReadColumn(is, header.run_count, st.phone_counts_)
+          && ReadColumn(is, header.run_count, st.seeds_)
+          && ReadColumn(is, header.run_count, st.is_valids_)
+          && ReadColumn(is, header.run_count, st.is_optimals_)
+          && ReadColumn(is, header.run_count, st.solution_statuses_)
+          && ReadColumn(is, header.run_count, st.all_costs_)
+          && ReadColumn(is, header.run_count, st.solve_seconds_);
+      for (int k = 0; ok && k < Cost::kTypeCount; ++k) {
+        ok = ReadColumn(is, header.row_count, st.costs_[k]);
+      }
+
+      // Rebuild first rows, the phone counts have to add up to the rows.
+      boost::int64_t row = st.first_rows_.empty() ? 0 : st.first_rows_.back() + st.phone_counts_[kFirstRun - 1];
+      for (size_t r = kFirstRun; ok && r < st.RunCount(); ++r) {
+        if (st.solver_ids_[r] < 0 || st.solver_ids_[r] >= ids.size() || st.phone_counts_[r] < 0) {
+          ok = false;
+          break;
+        }
+        st.solver_ids_[r] = ids[st.solver_ids_[r]];
+        st.first_rows_.push_back(row);
+        row += st.phone_counts_[r];
+      }
+      if (!ok || row != st.RowCount()) {
+        ErrorHandler::RunningWarning("ResultStore::ReadBinary: truncated or corrupt block in " + path);
+        return false;
+      }
+    }
+
+    *this = st;
+    return true;
+  }
+
+  bool ResultStore::AppendCsv(const std::string& path) const {
+    boost::system::error_code ec;
+    const bool kIsNew = !boost::filesystem::exists(path, ec) || boost::filesystem::file_size(path, ec) == 0;
+    std::ofstream os(path.c_str(), std::ios::app);
+    if (!os) {
+      ErrorHandler::RunningWarning("ResultStore::AppendCsv: cannot open " + path);
+      return false;
+    }
+
+    if (kIsNew) {
+      os << "solver,phone_count,seed,is_valid,is_optimal,solution_status,all_cost,solve_seconds,phone,sensing,comm,upload\n";
+    }
+    os.precision(17);
+    for (int r = 0; r < RunCount(); ++r) {
+      for (int i = 0; i < phone_counts_[r]; ++i) {
+        const boost::int64_t kRow = first_rows_[r] + i;
+        // Solver names contain spaces, never quotes or commas.
+        os << '"' << SolverName(r) << "\"," << phone_counts_[r] << ',' << seeds_[r] << ','
+            << static_cast<int>(is_valids_[r]) << ',' << static_cast<int>(is_optimals_[r]) << ','
+            << solution_statuses_[r] << ',' << all_costs_[r] << ',' << solve_seconds_[r] << ',' << i << ','
+            << costs_[Cost::SENSING][kRow] << ',' << costs_[Cost::COMM][kRow] << ',' << costs_[Cost::UPLOAD][kRow] << '\n';
+      }
+    }
+
+    if (!os.flush()) {
+      ErrorHandler::RunningWarning("ResultStore::AppendCsv: write failed for " + path);
+      return false;
+    }
+    return true;
+  }
+}
@@ -0,0 +1,105 @@
+//
+//  result_store.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/26/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__result_store__
+#define __PhoneSim__result_store__
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include "solver_base.h"
+
+namespace mobile_sensing_sim {
+  // Results of many solver runs kept column by column. Every run adds
+  // one entry to each run column (solver, phone count, seed, status,
+  // timing) and one row per phone to the three cost columns, so
+  // millions of phone costs take three flat arrays.
+  //
+  // Stores are appended to files and read back for plotting, either as
+  // binary blocks or as CSV with one line per phone.
+  class ResultStore {
+  public:
+    // Bump when the binary block layout changes.
+    static const unsigned kVersion = 1;
+
+    ResultStore() {}
+
+    // Add result of solver on the scenario generated with seed.
+    void AddRun(const std::string& solver, int seed, const Result& res);
+    void Clear();
+
+    int RunCount() const {
+      return phone_counts_.size();
+    }
+    boost::int64_t RowCount() const {
+      return costs_[0].size();
+    }
+
+    const std::string& SolverName(int run) const {
+      return solver_names_[solver_ids_[run]];
+    }
+    int PhoneCount(int run) const {
+      return phone_counts_[run];
+    }
+    int Seed(int run) const {
+      return seeds_[run];
+    }
+    bool IsValid(int run) const {
+      return is_valids_[run] != 0;
+    }
+    bool IsOptimal(int run) const {
+      return is_optimals_[run] != 0;
+    }
+    int SolutionStatus(int run) const {
+      return solution_statuses_[run];
+    }
+    double AllCost(int run) const {
+      return all_costs_[run];
+    }
+    double SolveSeconds(int run) const {
+      return solve_seconds_[run];
+    }
+    // Row of phone 0 of run, phone i is at FirstRow(run) + i.
+    boost::int64_t FirstRow(int run) const {
+      return first_rows_[run];
+    }
+    // Cost column of ctype over all rows.
+    const std::vector<double>& Costs(Cost::CostType ctype) const {
+      return costs_[ctype];
+    }
+
+    // Append all runs as one block to a binary file, creating it if needed.
+    bool AppendBinary(const std::string& path) const;
+    // Add the runs of every block in path.
+    bool ReadBinary(const std::string& path);
+
+    // Append one line per phone to a CSV file, with a header line when
+    // the file is new.
+    bool AppendCsv(const std::string& path) const;
+  private:
+    int SolverId(const std::string& solver);
+
+    std::vector<std::string> solver_names_; // Distinct names, runs keep indexes.
+
+    // Run columns.
+    std::vector<int> solver_ids_;
+    std::vector<int> phone_counts_;
+    std::vector<int> seeds_;
+    std::vector<char> is_valids_;
+    std::vector<char> is_optimals_;
+    std::vector<int> solution_statuses_;
+    std::vector<double> all_costs_;
+    std::vector<double> solve_seconds_;
+    std::vector<boost::int64_t> first_rows_;
+
+    // Phone columns, indexed by Cost::CostType.
+    std::vector<double> costs_[Cost::kTypeCount];
+  };
+}
+
+#endif /* defined(__PhoneSim__result_store__) */
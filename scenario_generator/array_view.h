@@ -0,0 +1,55 @@
+//
+//  array_view.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/21/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef PhoneSim_array_view_h
+#define PhoneSim_array_view_h
+
+#include <cstddef>
+#include <cassert>
+
+namespace mobile_sensing_sim {
+	// Read-only view of an array owned elsewhere, either a vector or
+	// a memory mapped file. Offers the read interface of std::vector.
+	template <typename T>
+	class ArrayView {
+	public:
+		typedef const T* const_iterator;
+
+		ArrayView() : data_(NULL), size_(0) {}
+		ArrayView(const T* data, std::size_t size) : data_(data), size_(size) {}
+
+		const T& operator[](std::size_t i) const {
+			assert(i < size_);
+			return data_[i];
+		}
+		const T* begin() const {
+			return data_;
+		}
+		const T* end() const {
+			return data_ + size_;
+		}
+		const T* data() const {
+			return data_;
+		}
+		const T& back() const {
+			assert(size_ > 0);
+			return data_[size_ - 1];
+		}
+		std::size_t size() const {
+			return size_;
+		}
+		bool empty() const {
+			return size_ == 0;
+		}
+	private:
+		const T* data_;
+		std::size_t size_;
+	};
+}
+
+#endif
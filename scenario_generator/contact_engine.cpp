@@ -0,0 +1,330 @@
+//
+//  contact_engine.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/28/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <utility>
+#include <algorithm>
+#include "contact_engine.h"
+#include "../error_handler.h"
+
+namespace mobile_sensing_sim {
+	namespace {
+		// A location stays on a segment while it is this close to the
+		// straight line, repeated additions of the speed drift far less.
+		const double kTolerance = 1.0E-6;
+		// Ranges are widened by this for the roots, so candidate seconds
+		// include every second in range despite the tolerance.
+		const double kSlack = 1.0E-3;
+		// Cell size in ranges, a segment is listed in every cell its box
+		// touches. Small ranges still get no more cells per side than
+		// kMaxCells, as segments are usually as long as streets.
+		const double kCellRanges = 2.0;
+		const int kMaxCells = 32;
+
+		void Insert(std::vector<int>& sorted, int value) {
+			sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), value), value);
+		}
+
+		void Erase(std::vector<int>& sorted, int value) {
+			sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), value));
+		}
+
+		// Does box (min_x, min_y, max_x, max_y) come within range of the
+		// other box?
+		bool BoxesMeet(double min_x1, double min_y1, double max_x1, double max_y1, double min_x2, double min_y2, double max_x2, double max_y2, double range) {
+			return min_x1 - range <= max_x2 && min_x2 - range <= max_x1 && min_y1 - range <= max_y2 && min_y2 - range <= max_y1;
+		}
+	}
+
+	ContactEngine::ContactEngine(const AreaMap& area_map, const std::vector<Point>& targets, double comm_range, double sensing_range)
+	: comm_range_(comm_range), sensing_range_(sensing_range), targets_(targets), phone_count_(0), first_time_(0), end_time_(0) {
+		cell_size_ = std::max(std::max(comm_range, sensing_range) * kCellRanges, std::max(std::max(area_map.length_, area_map.width_) / kMaxCells, 1.0));
+		cell_xcount_ = static_cast<int>(std::floor(area_map.length_ / cell_size_)) + 1;
+		cell_ycount_ = static_cast<int>(std::floor(area_map.width_ / cell_size_)) + 1;
+		cell_targets_.resize(cell_xcount_ * cell_ycount_);
+		for (int j = 0; j < targets_.size(); ++j) {
+			const int kCell = CellIndex(targets_[j].y, cell_ycount_) * cell_xcount_ + CellIndex(targets_[j].x, cell_xcount_);
+			cell_targets_[kCell].push_back(j);
+		}
+	}
+
+	int ContactEngine::CellIndex(double pos, int cell_count) const {
+		const int kIndex = static_cast<int>(std::floor(pos / cell_size_));
+		return std::min(std::max(kIndex, 0), cell_count - 1);
+	}
+
+	void ContactEngine::CellBox(const Segment& seg, double margin, int& x0, int& y0, int& x1, int& y1) const {
+		x0 = CellIndex(seg.min_x - margin, cell_xcount_);
+		y0 = CellIndex(seg.min_y - margin, cell_ycount_);
+		x1 = CellIndex(seg.max_x + margin, cell_xcount_);
+		y1 = CellIndex(seg.max_y + margin, cell_ycount_);
+	}
+
+	void ContactEngine::Build(const TrajectoryTable& locations, const std::vector<int>& begins, const std::vector<int>& ends) {
+		Build(locations, begins, ends, 0, locations.TimeSize());
+	}
+
+	void ContactEngine::Build(const TrajectoryTable& locations, const std::vector<int>& begins, const std::vector<int>& ends, int first_time, int end_time) {
+		if (begins.size() != locations.PhoneCount() || ends.size() != locations.PhoneCount()) {
+			ErrorHandler::CodingError("ContactEngine::Build: active seconds do not match the phones.");
+		}
+		if (first_time < 0 || first_time > end_time || end_time > locations.TimeSize()) {
+			ErrorHandler::CodingError("ContactEngine::Build: seconds out of the trajectories.");
+		}
+		phone_count_ = locations.PhoneCount();
+		first_time_ = first_time;
+		end_time_ = end_time;
+		intervals_.clear();
+		BuildSegments(locations, begins, ends);
+		FindTargetContacts(locations);
+		FindPhoneContacts(locations);
+	}
+
+	void ContactEngine::BuildSegments(const TrajectoryTable& locations, const std::vector<int>& begins, const std::vector<int>& ends) {
+		segments_.clear();
+		// Walk the table in time order and extend the open segment of
+		// each phone while its locations stay on the line.
+		std::vector<int> open(phone_count_, -1);
+		for (int t = first_time_; t < end_time_; ++t) {
+			const Point *row = locations[t];
+			for (int i = 0; i < phone_count_; ++i) {
+				if (t < begins[i] || t >= ends[i]) {
+					continue;
+				}
+				const Point &p = row[i];
+				if (open[i] != -1) {
+					Segment &seg = segments_[open[i]];
+					const int kStep = t - seg.begin;
+					if (kStep == 1) {
+						seg.vx = p.x - seg.x;
+						seg.vy = p.y - seg.y;
+					}
+					if (std::abs(seg.x + seg.vx * kStep - p.x) <= kTolerance && std::abs(seg.y + seg.vy * kStep - p.y) <= kTolerance) {
+						seg.end = t + 1;
+						seg.min_x = std::min(seg.min_x, p.x);
+						seg.min_y = std::min(seg.min_y, p.y);
+						seg.max_x = std::max(seg.max_x, p.x);
+						seg.max_y = std::max(seg.max_y, p.y);
+						continue;
+					}
+				}
+				// Phone turned or became active.
+				const Segment kSeg = {i, t, t + 1, p.x, p.y, 0.0, 0.0, p.x, p.y, p.x, p.y};
+				open[i] = segments_.size();
+				segments_.push_back(kSeg);
+			}
+		}
+	}
+
+	ContactEngine::Motion ContactEngine::Relative(const Segment& seg, int begin, int end, double x, double y, double vx, double vy) {
+		const Motion kMotion = {begin, end, seg.x + seg.vx * (begin - seg.begin) - x, seg.y + seg.vy * (begin - seg.begin) - y, seg.vx - vx, seg.vy - vy};
+		return kMotion;
+	}
+
+	bool ContactEngine::RootRange(const Motion& motion, double range, int widen, int& first, int& last) {
+		// In range while a * s^2 + 2 * b * s + c <= 0.
+		const double kA = motion.dvx * motion.dvx + motion.dvy * motion.dvy;
+		const double kB = motion.dx * motion.dvx + motion.dy * motion.dvy;
+		const double kC = motion.dx * motion.dx + motion.dy * motion.dy - range * range;
+		const double kLength = motion.end - motion.begin;
+		double lo = 0;
+		double hi = kLength - 1;
+		if (kA == 0) {
+			// Same velocity, the distance never changes.
+			if (kC > 0) {
+				return false;
+			}
+		} else {
+			const double kDisc = kB * kB - kA * kC;
+			if (kDisc < 0) {
+				return false;
+			}
+			const double kRoot = std::sqrt(kDisc);
+			lo = std::max(std::ceil((-kB - kRoot) / kA) - widen, lo);
+			hi = std::min(std::floor((-kB + kRoot) / kA) + widen, hi);
+		}
+		if (lo > hi) {
+			return false;
+		}
+		first = static_cast<int>(lo);
+		last = static_cast<int>(hi);
+		return true;
+	}
+
+	double ContactEngine::DistanceSquareAt(const Motion& motion, int s) {
+		const double kDx = motion.dx + motion.dvx * s;
+		const double kDy = motion.dy + motion.dvy * s;
+		return kDx * kDx + kDy * kDy;
+	}
+
+	void ContactEngine::AddContacts(const TrajectoryTable& locations, int row, int column, const Motion& motion, double range) {
+		int first, last;
+		if (!RootRange(motion, range + kSlack, 1, first, last)) {
+			return;
+		}
+		// Locations are within the tolerance of the line, so seconds well
+		// inside the range on it are in range. The distance is convex in
+		// time, checking both ends of the inner seconds covers them all.
+		int inner_first = -1;
+		int inner_last = -2;
+		int f, l;
+		const double kInnerSquare = (range - kSlack) * (range - kSlack);
+		if (range > kSlack && RootRange(motion, range - kSlack, -1, f, l) && DistanceSquareAt(motion, f) <= kInnerSquare && DistanceSquareAt(motion, l) <= kInnerSquare) {
+			inner_first = f;
+			inner_last = l;
+		}
+
+		// Check the other seconds at the recorded locations, with the
+		// test PhoneGrid and SensingKernel use.
+		const bool kIsTarget = column >= phone_count_;
+		const double kRangeSquare = range * range;
+		int begin = -1;
+		for (int s = first; s <= last + 1; ++s) {
+			bool in_range = false;
+			if (s >= inner_first && s <= inner_last) {
+				in_range = true;
+			} else if (s <= last) {
+				const Point *row_locations = locations[motion.begin + s];
+				const Point &other = kIsTarget ? targets_[column - phone_count_] : row_locations[column];
+				in_range = Point::DistanceSquare(row_locations[row], other) <= kRangeSquare;
+			}
+			if (in_range && begin == -1) {
+				begin = s;
+			} else if (!in_range && begin != -1) {
+				const ContactInterval kInterval = {row, column, motion.begin + begin, motion.begin + s};
+				intervals_.push_back(kInterval);
+				begin = -1;
+			}
+			if (s == inner_first) {
+				s = inner_last;
+			}
+		}
+	}
+
+	void ContactEngine::FindTargetContacts(const TrajectoryTable& locations) {
+		for (int s = 0; s < segments_.size(); ++s) {
+			const Segment &seg = segments_[s];
+			int x0, y0, x1, y1;
+			CellBox(seg, sensing_range_ + kSlack, x0, y0, x1, y1);
+			for (int cy = y0; cy <= y1; ++cy) {
+				for (int cx = x0; cx <= x1; ++cx) {
+					const std::vector<int> &targets = cell_targets_[cy * cell_xcount_ + cx];
+					for (int k = 0; k < targets.size(); ++k) {
+						const Point &pt = targets_[targets[k]];
+						if (!BoxesMeet(seg.min_x, seg.min_y, seg.max_x, seg.max_y, pt.x, pt.y, pt.x, pt.y, sensing_range_ + kSlack)) {
+							continue;
+						}
+						AddContacts(locations, seg.phone, phone_count_ + targets[k], Relative(seg, seg.begin, seg.end, pt.x, pt.y, 0.0, 0.0), sensing_range_);
+					}
+				}
+			}
+		}
+	}
+
+	void ContactEngine::FindPhoneContacts(const TrajectoryTable& locations) {
+		// Pair every segment with the segments that began before it and
+		// have not ended, so each pair overlapping in time is seen once.
+		std::vector<std::pair<int, int> > order(segments_.size());
+		for (int s = 0; s < segments_.size(); ++s) {
+			order[s] = std::make_pair(segments_[s].begin, s);
+		}
+		std::sort(order.begin(), order.end());
+
+		// A segment is listed in the cells of its box widened by the
+		// range and looks in the cells of its own box.
+		cell_segments_.assign(cell_xcount_ * cell_ycount_, std::vector<int>());
+		std::vector<int> seen(segments_.size(), -1);
+		for (int o = 0; o < order.size(); ++o) {
+			const int a = order[o].second;
+			const Segment &sa = segments_[a];
+			int x0, y0, x1, y1;
+			CellBox(sa, 0.0, x0, y0, x1, y1);
+			for (int cy = y0; cy <= y1; ++cy) {
+				for (int cx = x0; cx <= x1; ++cx) {
+					std::vector<int> &cell = cell_segments_[cy * cell_xcount_ + cx];
+					int kept = 0;
+					for (int k = 0; k < cell.size(); ++k) {
+						const int b = cell[k];
+						const Segment &sb = segments_[b];
+						// Ended segments meet no later one.
+						if (sb.end <= sa.begin) {
+							continue;
+						}
+						cell[kept++] = b;
+						if (seen[b] == a || sb.phone == sa.phone) {
+							continue;
+						}
+						seen[b] = a;
+						if (!BoxesMeet(sa.min_x, sa.min_y, sa.max_x, sa.max_y, sb.min_x, sb.min_y, sb.max_x, sb.max_y, comm_range_ + kSlack)) {
+							continue;
+						}
+						// sb began first, both run in [sa.begin, kEnd).
+						const int kEnd = std::min(sa.end, sb.end);
+						const int kStep = sa.begin - sb.begin;
+						const Motion kMotion = Relative(sa, sa.begin, kEnd, sb.x + sb.vx * kStep, sb.y + sb.vy * kStep, sb.vx, sb.vy);
+						AddContacts(locations, std::min(sa.phone, sb.phone), std::max(sa.phone, sb.phone), kMotion, comm_range_);
+					}
+					cell.resize(kept);
+				}
+			}
+
+			CellBox(sa, comm_range_ + kSlack, x0, y0, x1, y1);
+			for (int cy = y0; cy <= y1; ++cy) {
+				for (int cx = x0; cx <= x1; ++cx) {
+					cell_segments_[cy * cell_xcount_ + cx].push_back(a);
+				}
+			}
+		}
+	}
+
+	void ContactEngine::Fill(ContactList& contacts, double phone_data, double target_data) const {
+		if (contacts.PhoneCount() != phone_count_ || contacts.TargetCount() != targets_.size() || contacts.TimeSize() < end_time_) {
+			ErrorHandler::CodingError("ContactEngine::Fill: contact list does not match the trajectories.");
+		}
+
+		// Columns of each row in range in the current second, kept sorted
+		// and changed only where intervals begin or end.
+		std::vector<std::pair<int, int> > begins(intervals_.size());
+		std::vector<std::pair<int, int> > ends(intervals_.size());
+		for (int k = 0; k < intervals_.size(); ++k) {
+			begins[k] = std::make_pair(intervals_[k].begin, k);
+			ends[k] = std::make_pair(intervals_[k].end, k);
+		}
+		std::sort(begins.begin(), begins.end());
+		std::sort(ends.begin(), ends.end());
+
+		std::vector<std::vector<int> > rows(phone_count_);
+		int next_begin = 0;
+		int next_end = 0;
+		for (int t = first_time_; t < end_time_; ++t) {
+			for (; next_end < ends.size() && ends[next_end].first == t; ++next_end) {
+				const ContactInterval &in = intervals_[ends[next_end].second];
+				Erase(rows[in.row], in.column);
+				if (in.column < phone_count_) {
+					Erase(rows[in.column], in.row);
+				}
+			}
+			for (; next_begin < begins.size() && begins[next_begin].first == t; ++next_begin) {
+				const ContactInterval &in = intervals_[begins[next_begin].second];
+				Insert(rows[in.row], in.column);
+				if (in.column < phone_count_) {
+					Insert(rows[in.column], in.row);
+				}
+			}
+
+			contacts.BeginSlice(t);
+			for (int i = 0; i < phone_count_; ++i) {
+				const std::vector<int> &columns = rows[i];
+				for (int k = 0; k < columns.size(); ++k) {
+					contacts.AddContact(t, i, columns[k], columns[k] < phone_count_ ? phone_data : target_data);
+				}
+			}
+			contacts.EndSlice(t);
+		}
+	}
+}
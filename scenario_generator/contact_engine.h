@@ -0,0 +1,126 @@
+//
+//  contact_engine.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/28/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__contact_engine__
+#define __PhoneSim__contact_engine__
+
+#include <vector>
+#include "area_map.h"
+#include "contact_list.h"
+#include "trajectory_table.h"
+
+namespace mobile_sensing_sim {
+	// Contact of row and column in seconds [begin, end). Columns are
+	// numbered as in ContactList, targets start at phone count. Phone
+	// pairs are listed once with row < column, intervals of one pair
+	// never overlap.
+	struct ContactInterval {
+		int row;
+		int column;
+		int begin;
+		int end;
+	};
+
+	// Finds contacts from whole trajectories instead of testing every
+	// second. Phones move along straight streets at constant speed, so
+	// a trajectory is a few linear segments between turns, and the
+	// seconds two segments (or a segment and a target) are in range
+	// solve a quadratic inequality. Only segments sharing a cell of a
+	// coarse grid are paired.
+	//
+	// The roots are widened by a small slack and the seconds found are
+	// checked against the recorded locations with the test PhoneGrid
+	// and SensingKernel use, so the contacts are the same as sampling
+	// every second.
+	class ContactEngine {
+	public:
+		ContactEngine(const AreaMap& area_map, const std::vector<Point>& targets, double comm_range, double sensing_range);
+
+		// Contacts of phones at locations, phone i is active in seconds
+		// [begins[i], ends[i]).
+		void Build(const TrajectoryTable& locations, const std::vector<int>& begins, const std::vector<int>& ends);
+		// Same for seconds [first_time, end_time) only. Engines of
+		// disjoint seconds are independent, e.g. run on different threads.
+		void Build(const TrajectoryTable& locations, const std::vector<int>& begins, const std::vector<int>& ends, int first_time, int end_time);
+
+		const std::vector<ContactInterval>& Intervals() const {
+			return intervals_;
+		}
+
+		int SegmentCount() const {
+			return segments_.size();
+		}
+
+		// Replace the slices of the built seconds by the intervals, with
+		// data per second of phone and target contacts. Other slices are
+		// not touched.
+		void Fill(ContactList& contacts, double phone_data, double target_data) const;
+	private:
+		// Phone at (x + vx * s, y + vy * s) in second begin + s.
+		struct Segment {
+			int phone;
+			int begin;
+			int end;
+			double x;
+			double y;
+			double vx;
+			double vy;
+			double min_x; // Bounding box of the locations.
+			double min_y;
+			double max_x;
+			double max_y;
+		};
+
+		// Distance vector (dx + dvx * s, dy + dvy * s) of a phone and a
+		// phone or target in second begin + s, s < end - begin.
+		struct Motion {
+			int begin;
+			int end;
+			double dx;
+			double dy;
+			double dvx;
+			double dvy;
+		};
+
+		void BuildSegments(const TrajectoryTable& locations, const std::vector<int>& begins, const std::vector<int>& ends);
+		void FindTargetContacts(const TrajectoryTable& locations);
+		void FindPhoneContacts(const TrajectoryTable& locations);
+		// Motion of seg in [begin, end) relative to the point moving from
+		// (x, y) in second begin by (vx, vy) per second.
+		static Motion Relative(const Segment& seg, int begin, int end, double x, double y, double vx, double vy);
+		// Seconds [first, last] of motion, counted from its begin, in
+		// which the distance is at most range by the roots. Widened (or
+		// shrunk if negative) by widen seconds against rounding of the
+		// roots and clamped to the motion. False if there is none.
+		static bool RootRange(const Motion& motion, double range, int widen, int& first, int& last);
+		static double DistanceSquareAt(const Motion& motion, int s);
+		// Add intervals of the seconds row and column of motion are
+		// within range.
+		void AddContacts(const TrajectoryTable& locations, int row, int column, const Motion& motion, double range);
+		// Cells of box widened by margin, clamped to the grid.
+		void CellBox(const Segment& seg, double margin, int& x0, int& y0, int& x1, int& y1) const;
+		int CellIndex(double pos, int cell_count) const;
+
+		double comm_range_;
+		double sensing_range_;
+		std::vector<Point> targets_;
+		double cell_size_;
+		int cell_xcount_;
+		int cell_ycount_;
+		std::vector<std::vector<int> > cell_targets_;
+		std::vector<std::vector<int> > cell_segments_; // Segments that may still meet a later one.
+
+		int phone_count_;
+		int first_time_;
+		int end_time_;
+		std::vector<Segment> segments_;
+		std::vector<ContactInterval> intervals_;
+	};
+}
+
+#endif /* defined(__PhoneSim__contact_engine__) */
@@ -0,0 +1,288 @@
+//
+//  contact_list.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/9/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef PhoneSim_contact_list_h
+#define PhoneSim_contact_list_h
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include "array_view.h"
+
+namespace mobile_sensing_sim {
+	// Contacts of one second in compressed sparse row form.
+	// Row i lists the phones and targets in range of phone i sorted by
+	// column id, targets use column phone count + target id.
+	// Entries of row i are [offsets[i], offsets[i + 1]).
+	struct ContactSlice {
+		ArrayView<int> offsets; // Size = phone count + 1
+		ArrayView<int> ids;
+		ArrayView<double> data; // Data units transferable in this second.
+	};
+
+	// Sparse replacement of the dense adjacency / data capacity
+	// matrices over time. Memory is proportional to the number of
+	// contacts instead of running time * phones * (phones + targets).
+	//
+	// Slices either own their arrays or view read-only arrays of a
+	// mapped scenario file, which are copied on the first change.
+	class ContactList {
+	public:
+		ContactList() : phone_count_(0), target_count_(0) {}
+		ContactList(int running_time, int phone_count, int target_count) {
+			Resize(running_time, phone_count, target_count);
+		}
+		ContactList(const ContactList& other) {
+			*this = other;
+		}
+
+		ContactList& operator=(const ContactList& other) {
+			phone_count_ = other.phone_count_;
+			target_count_ = other.target_count_;
+			owned_ = other.owned_;
+			slices_ = other.slices_;
+			is_owned_ = other.is_owned_;
+			storage_ = other.storage_;
+			for (int t = 0; t < slices_.size(); ++t) {
+				if (is_owned_[t]) {
+					Bind(t);
+				}
+			}
+			return *this;
+		}
+
+		// Resize and remove all contacts.
+		void Resize(int running_time, int phone_count, int target_count) {
+			phone_count_ = phone_count;
+			target_count_ = target_count;
+			owned_.resize(running_time);
+			slices_.resize(running_time);
+			is_owned_.assign(running_time, 1);
+			storage_.reset();
+			Clear();
+		}
+
+		// View all slices in read-only arrays kept alive by storage.
+		// Slice t holds ids / data [slice_begins[t], slice_begins[t + 1])
+		// and row offsets [t * (phone count + 1), (t + 1) * (phone count + 1)),
+		// counted from the start of the slice.
+		void Map(int running_time, int phone_count, int target_count, const boost::int64_t* slice_begins, const int* offsets, const int* ids, const double* data, const boost::shared_ptr<const void>& storage) {
+			phone_count_ = phone_count;
+			target_count_ = target_count;
+			owned_.clear();
+			owned_.resize(running_time);
+			slices_.resize(running_time);
+			is_owned_.assign(running_time, 0);
+			storage_ = storage;
+			for (int t = 0; t < running_time; ++t) {
+				ContactSlice &slice = slices_[t];
+				const boost::int64_t kBegin = slice_begins[t];
+				const std::size_t kCount = slice_begins[t + 1] - kBegin;
+				slice.offsets = ArrayView<int>(offsets + static_cast<std::size_t>(t) * (phone_count + 1), phone_count + 1);
+				slice.ids = ArrayView<int>(ids + kBegin, kCount);
+				slice.data = ArrayView<double>(data + kBegin, kCount);
+			}
+		}
+
+		void Clear() {
+			for (int t = 0; t < slices_.size(); ++t) {
+				ClearSlice(t);
+			}
+		}
+
+		void ClearSlice(int time) {
+			SliceData &slice = owned_[time];
+			slice.offsets.assign(phone_count_ + 1, 0);
+			slice.ids.clear();
+			slice.data.clear();
+			is_owned_[time] = 1;
+			Bind(time);
+		}
+
+		// Replace slice time by the same slice of other.
+		void CopySlice(const ContactList& other, int time) {
+			assert(other.phone_count_ == phone_count_ && other.target_count_ == target_count_);
+			const ContactSlice &from = other.Slice(time);
+			SliceData &slice = owned_[time];
+			slice.offsets.assign(from.offsets.begin(), from.offsets.end());
+			slice.ids.assign(from.ids.begin(), from.ids.end());
+			slice.data.assign(from.data.begin(), from.data.end());
+			is_owned_[time] = 1;
+			Bind(time);
+		}
+
+		int TimeSize() const {
+			return slices_.size();
+		}
+
+		int PhoneCount() const {
+			return phone_count_;
+		}
+
+		int TargetCount() const {
+			return target_count_;
+		}
+
+		int ColumnSize() const {
+			return phone_count_ + target_count_;
+		}
+
+		bool Empty() const {
+			return slices_.empty();
+		}
+
+		const ContactSlice& Slice(int time) const {
+			assert(time < slices_.size());
+			return slices_[time];
+		}
+
+		//////////////////////////////////////////////
+		// Sequential building of one slice.
+		// Contacts must be added with non-decreasing row
+		// and increasing column within a row. The slice
+		// can be read after EndSlice.
+		//////////////////////////////////////////////
+		void BeginSlice(int time) {
+			SliceData &slice = owned_[time];
+			slice.offsets.assign(1, 0);
+			slice.ids.clear();
+			slice.data.clear();
+			is_owned_[time] = 1;
+		}
+
+		void AddContact(int time, int row, int col, double data) {
+			SliceData &slice = owned_[time];
+			assert(is_owned_[time] && row < phone_count_ && col < ColumnSize());
+			assert(slice.offsets.size() <= row + 1);
+			while (slice.offsets.size() <= row) {
+				slice.offsets.push_back(slice.ids.size());
+			}
+			assert(slice.ids.size() == slice.offsets.back() || slice.ids.back() < col);
+			slice.ids.push_back(col);
+			slice.data.push_back(data);
+		}
+
+		void EndSlice(int time) {
+			SliceData &slice = owned_[time];
+			while (slice.offsets.size() < phone_count_ + 1) {
+				slice.offsets.push_back(slice.ids.size());
+			}
+			Bind(time);
+		}
+
+		//////////////////////////////////////////////
+		// Random access.
+		//////////////////////////////////////////////
+
+		// Position of contact (row, col) in slice, -1 if not found.
+		int Find(int time, int row, int col) const {
+			const ContactSlice &slice = Slice(time);
+			const int *begin = slice.ids.begin() + slice.offsets[row];
+			const int *end = slice.ids.begin() + slice.offsets[row + 1];
+			const int *it = std::lower_bound(begin, end, col);
+			if (it == end || *it != col) {
+				return -1;
+			}
+			return it - slice.ids.begin();
+		}
+
+		bool IsConnected(int time, int row, int col) const {
+			return Find(time, row, col) != -1;
+		}
+
+		double Data(int time, int row, int col) const {
+			int pos = Find(time, row, col);
+			return pos == -1 ? 0.0 : slices_[time].data[pos];
+		}
+
+		// Add or overwrite contact (row, col) in a finished slice.
+		void SetContact(int time, int row, int col, double data) {
+			Own(time);
+			SliceData &slice = owned_[time];
+			std::vector<int>::iterator begin = slice.ids.begin() + slice.offsets[row];
+			std::vector<int>::iterator end = slice.ids.begin() + slice.offsets[row + 1];
+			std::vector<int>::iterator it = std::lower_bound(begin, end, col);
+			int pos = it - slice.ids.begin();
+			if (it != end && *it == col) {
+				slice.data[pos] = data;
+				return;
+			}
+			slice.ids.insert(it, col);
+			slice.data.insert(slice.data.begin() + pos, data);
+			for (int i = row + 1; i < slice.offsets.size(); ++i) {
+				++slice.offsets[i];
+			}
+			Bind(time);
+		}
+
+		// Rows of slice time with at least one contact, in increasing
+		// order. Rows are located from the contacts, so the time taken
+		// grows with the rows found rather than with the phone count.
+		void NonEmptyRows(int time, std::vector<int>& rows) const {
+			rows.clear();
+			const ContactSlice &slice = Slice(time);
+			const int *offsets = slice.offsets.begin();
+			int row = -1;
+			for (int k = 0; k < slice.ids.size(); k = offsets[row + 1]) {
+				// Find the last row beginning at or before k, empty rows
+				// before it begin there as well. Gallop over them first
+				// so runs of non-empty rows take one step each.
+				int lo = row + 1;
+				int step = 1;
+				while (lo + step <= phone_count_ && offsets[lo + step] <= k) {
+					lo += step;
+					step *= 2;
+				}
+				const int kEnd = std::min(lo + step, phone_count_ + 1);
+				row = std::upper_bound(offsets + lo, offsets + kEnd, k) - offsets - 1;
+				rows.push_back(row);
+			}
+		}
+
+		// Number of contacts stored over all slices.
+		long long ContactCount() const {
+			long long count = 0;
+			for (int t = 0; t < slices_.size(); ++t) {
+				count += slices_[t].ids.size();
+			}
+			return count;
+		}
+	private:
+		struct SliceData {
+			std::vector<int> offsets;
+			std::vector<int> ids;
+			std::vector<double> data;
+		};
+
+		// Copy a mapped slice before changing it.
+		void Own(int time) {
+			if (!is_owned_[time]) {
+				CopySlice(*this, time);
+			}
+		}
+
+		void Bind(int time) {
+			const SliceData &from = owned_[time];
+			ContactSlice &slice = slices_[time];
+			slice.offsets = ArrayView<int>(from.offsets.empty() ? NULL : &from.offsets[0], from.offsets.size());
+			slice.ids = ArrayView<int>(from.ids.empty() ? NULL : &from.ids[0], from.ids.size());
+			slice.data = ArrayView<double>(from.data.empty() ? NULL : &from.data[0], from.data.size());
+		}
+
+		int phone_count_;
+		int target_count_;
+		std::vector<SliceData> owned_;
+		std::vector<ContactSlice> slices_; // Views of owned_ or of storage_.
+		std::vector<char> is_owned_;
+		boost::shared_ptr<const void> storage_;
+	};
+}
+
+#endif
@@ -0,0 +1,255 @@
+//
+//  mobility_engine.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/23/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "mobility_engine.h"
+
+namespace mobile_sensing_sim {
+	namespace {
+		// Unit moves indexed by Phone::Directions.
+		const double kDx[4] = {0, 1, 0, -1};
+		const double kDy[4] = {1, 0, -1, 0};
+
+		bool IsVertical(int dir) {
+			return dir == Phone::UP || dir == Phone::DOWN;
+		}
+	}
+
+	MobilityEngine::MobilityEngine(const AreaMap& area_map) : area_map_(area_map) {
+		for (int i = 0; i < area_map.intersect_points_.size(); ++i) {
+			const Point &pt = area_map.intersect_points_[i];
+			AddStop(vertical_streets_, pt.x, pt.y, i);
+			AddStop(horizontal_streets_, pt.y, pt.x, i);
+		}
+	}
+
+	void MobilityEngine::AddStop(std::vector<Street>& streets, double coord, double stop, int id) {
+		std::vector<Street>::iterator it = streets.begin();
+		while (it != streets.end() && it->coord < coord) {
+			++it;
+		}
+		if (it == streets.end() || it->coord != coord) {
+			it = streets.insert(it, Street());
+			it->coord = coord;
+		}
+		const int kPos = std::upper_bound(it->stops.begin(), it->stops.end(), stop) - it->stops.begin();
+		it->stops.insert(it->stops.begin() + kPos, stop);
+		it->ids.insert(it->ids.begin() + kPos, id);
+	}
+
+	int MobilityEngine::FindStreet(const std::vector<Street>& streets, double coord) {
+		int lo = 0;
+		int hi = streets.size();
+		while (lo < hi) {
+			const int kMid = (lo + hi) / 2;
+			if (streets[kMid].coord < coord) {
+				lo = kMid + 1;
+			} else {
+				hi = kMid;
+			}
+		}
+		// Phone::Move compares coordinates exactly as well.
+		return lo < streets.size() && streets[lo].coord == coord ? lo : -1;
+	}
+
+	void MobilityEngine::Load(const std::vector<Phone>& phones) {
+		const int kPhoneCount = phones.size();
+		xs_.resize(kPhoneCount);
+		ys_.resize(kPhoneCount);
+		speeds_.resize(kPhoneCount);
+		unit_xs_.resize(kPhoneCount);
+		unit_ys_.resize(kPhoneCount);
+		vel_xs_.resize(kPhoneCount);
+		vel_ys_.resize(kPhoneCount);
+		next_stops_.resize(kPhoneCount);
+		steps_.resize(kPhoneCount);
+		dirs_.resize(kPhoneCount);
+		active_.resize(kPhoneCount);
+		streets_.resize(kPhoneCount);
+		turn_rngs_.resize(kPhoneCount);
+		turn_dist_ids_.resize(kPhoneCount);
+		turn_dists_.clear();
+		for (int i = 0; i < kPhoneCount; ++i) {
+			const Phone &ph = phones[i];
+			const boost::random::discrete_distribution<> &dist = ph.GetTurnDistribution();
+			int id = 0;
+			while (id < turn_dists_.size() && turn_dists_[id] != dist) {
+				++id;
+			}
+			if (id == turn_dists_.size()) {
+				turn_dists_.push_back(dist);
+			}
+			turn_dist_ids_[i] = id;
+			xs_[i] = ph.GetLocation().x;
+			ys_[i] = ph.GetLocation().y;
+			speeds_[i] = ph.speed_;
+			active_[i] = ph.is_active_;
+			turn_rngs_[i] = ph.GetTurnEngine();
+			SetDirection(i, ph.moving_direction_);
+		}
+	}
+
+	void MobilityEngine::Store(std::vector<Phone>& phones) const {
+		for (int i = 0; i < phones.size(); ++i) {
+			Phone &ph = phones[i];
+			ph.MoveTo(Location(i));
+			ph.moving_direction_ = static_cast<Phone::Directions>(dirs_[i]);
+			ph.is_active_ = active_[i];
+			ph.SetTurnEngine(turn_rngs_[i]);
+		}
+	}
+
+	void MobilityEngine::Activate(int i) {
+		active_[i] = 1;
+		SetVelocity(i);
+		UpdateNextStop(i);
+	}
+
+	void MobilityEngine::SetDirection(int i, Phone::Directions dir) {
+		dirs_[i] = dir;
+		unit_xs_[i] = kDx[dir];
+		unit_ys_[i] = kDy[dir];
+		SetVelocity(i);
+		streets_[i] = IsVertical(dir) ? FindStreet(vertical_streets_, xs_[i]) : FindStreet(horizontal_streets_, ys_[i]);
+		UpdateNextStop(i);
+	}
+
+	void MobilityEngine::SetVelocity(int i) {
+		// +-speed, so adding it equals Phone::MoveForward.
+		vel_xs_[i] = active_[i] ? unit_xs_[i] * speeds_[i] : 0;
+		vel_ys_[i] = active_[i] ? unit_ys_[i] * speeds_[i] : 0;
+	}
+
+	void MobilityEngine::UpdateNextStop(int i) {
+		next_stops_[i] = std::numeric_limits<double>::infinity();
+		if (!active_[i] || streets_[i] == -1) {
+			return;
+		}
+		const bool kIsVertical = IsVertical(dirs_[i]);
+		const std::vector<double> &stops = kIsVertical ? vertical_streets_[streets_[i]].stops : horizontal_streets_[streets_[i]].stops;
+		const double kPos = kIsVertical ? ys_[i] : xs_[i];
+		if (unit_xs_[i] + unit_ys_[i] > 0) {
+			std::vector<double>::const_iterator it = std::upper_bound(stops.begin(), stops.end(), kPos);
+			if (it != stops.end()) {
+				next_stops_[i] = *it;
+			}
+		} else {
+			std::vector<double>::const_iterator it = std::lower_bound(stops.begin(), stops.end(), kPos);
+			if (it != stops.begin()) {
+				next_stops_[i] = -*(it - 1);
+			}
+		}
+	}
+
+	void MobilityEngine::Advance(int i, double distance) {
+		// Adding -distance or 0 gives the same values as Phone::MoveForward.
+		xs_[i] += unit_xs_[i] * distance;
+		ys_[i] += unit_ys_[i] * distance;
+	}
+
+	bool MobilityEngine::FindCrossing(int i, double& stop) const {
+		const bool kIsVertical = IsVertical(dirs_[i]);
+		const Street &street = kIsVertical ? vertical_streets_[streets_[i]] : horizontal_streets_[streets_[i]];
+		const double kFrom = kIsVertical ? ys_[i] : xs_[i];
+		const double kTo = kIsVertical ? ys_[i] + vel_ys_[i] : xs_[i] + vel_xs_[i];
+
+		// Passed intersections are in (from, to] moving forward and in
+		// [to, from) moving backward. Phone::Move takes the one with
+		// the lowest id.
+		std::vector<double>::const_iterator it;
+		std::vector<double>::const_iterator end;
+		if (kFrom < kTo) {
+			it = std::upper_bound(street.stops.begin(), street.stops.end(), kFrom);
+			end = std::upper_bound(it, street.stops.end(), kTo);
+		} else {
+			it = std::lower_bound(street.stops.begin(), street.stops.end(), kTo);
+			end = std::lower_bound(it, street.stops.end(), kFrom);
+		}
+		int best_id = -1;
+		for (; it != end; ++it) {
+			const int kId = street.ids[it - street.stops.begin()];
+			if (best_id == -1 || kId < best_id) {
+				best_id = kId;
+				stop = *it;
+			}
+		}
+		return best_id != -1;
+	}
+
+	void MobilityEngine::IntersectAction(int i, double distance_to_intersection) {
+		int turn_decision = turn_dists_[turn_dist_ids_[i]](turn_rngs_[i]);
+		if (turn_decision == 2) {
+			xs_[i] += vel_xs_[i];
+			ys_[i] += vel_ys_[i];
+		} else {
+			Advance(i, distance_to_intersection);
+			const int kDir = dirs_[i];
+			SetDirection(i, static_cast<Phone::Directions>(turn_decision == 0 ? (kDir + 4 - 1) % 4 : (kDir + 1) % 4));
+			Advance(i, speeds_[i] - distance_to_intersection);
+		}
+		UpdateNextStop(i);
+	}
+
+	void MobilityEngine::Step() {
+		const int kPhoneCount = xs_.size();
+		if (kPhoneCount == 0) {
+			return;
+		}
+		// The arrays never overlap. Each pass reads few enough of them for
+		// the compiler to vectorize it.
+		double * __restrict xs = &xs_[0];
+		double * __restrict ys = &ys_[0];
+		double * __restrict steps = &steps_[0];
+		const double * __restrict vel_xs = &vel_xs_[0];
+		const double * __restrict vel_ys = &vel_ys_[0];
+		const double * __restrict unit_xs = &unit_xs_[0];
+		const double * __restrict unit_ys = &unit_ys_[0];
+		const double * __restrict next_stops = &next_stops_[0];
+
+		// Does the straight destination reach the next intersection?
+		// Inactive phones have no velocity and no stop, so they move by 0.
+		for (int i = 0; i < kPhoneCount; ++i) {
+			const double kAhead = (xs[i] + vel_xs[i]) * unit_xs[i] + (ys[i] + vel_ys[i]) * unit_ys[i];
+			steps[i] = kAhead < next_stops[i] ? 1.0 : 0.0;
+		}
+
+		// The few phones that do may turn there.
+		for (int i = 0; i < kPhoneCount; ++i) {
+			if (steps[i] != 0) {
+				continue;
+			}
+			double stop;
+			if (FindCrossing(i, stop)) {
+				IntersectAction(i, std::abs(stop - (IsVertical(dirs_[i]) ? ys[i] : xs[i])));
+			} else {
+				xs[i] += vel_xs[i];
+				ys[i] += vel_ys[i];
+				UpdateNextStop(i);
+			}
+		}
+
+		// Straight moves, adding 1 * +-speed is exact.
+		for (int i = 0; i < kPhoneCount; ++i) {
+			xs[i] += steps[i] * vel_xs[i];
+			ys[i] += steps[i] * vel_ys[i];
+		}
+
+		// Phones leaving the map stop.
+		const double kLength = area_map_.length_;
+		const double kWidth = area_map_.width_;
+		for (int i = 0; i < kPhoneCount; ++i) {
+			if (active_[i] && ((xs[i] < 0) | (xs[i] > kLength) | (ys[i] < 0) | (ys[i] > kWidth))) {
+				active_[i] = 0;
+				SetVelocity(i);
+				UpdateNextStop(i);
+			}
+		}
+	}
+}
@@ -0,0 +1,96 @@
+//
+//  mobility_engine.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/23/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__mobility_engine__
+#define __PhoneSim__mobility_engine__
+
+#include <vector>
+#include <boost/random/discrete_distribution.hpp>
+#include "phone.h"
+
+namespace mobile_sensing_sim {
+	// Moves all phones of a scenario together. State is kept in one
+	// array per attribute and a step is a few passes over them: a
+	// branch free test of every phone against the next intersection
+	// ahead, turn decisions of the few phones that pass one, straight
+	// moves of all others and the bound check. Trajectories and turn
+	// draws are the ones Phone::Move makes.
+	class MobilityEngine {
+	public:
+		MobilityEngine(const AreaMap& area_map);
+
+		// Take location, direction, speed, state and turns of phones.
+		void Load(const std::vector<Phone>& phones);
+		// Write the state back to phones, e.g. to continue with Move.
+		void Store(std::vector<Phone>& phones) const;
+
+		void Activate(int i);
+
+		// Move every active phone by one second.
+		void Step();
+
+		int PhoneCount() const {
+			return xs_.size();
+		}
+		const double* Xs() const {
+			return xs_.empty() ? NULL : &xs_[0];
+		}
+		const double* Ys() const {
+			return ys_.empty() ? NULL : &ys_[0];
+		}
+		const char* Active() const {
+			return active_.empty() ? NULL : &active_[0];
+		}
+		Point Location(int i) const {
+			return Point(xs_[i], ys_[i]);
+		}
+	private:
+		// Intersections on one street, phones moving along it check them.
+		struct Street {
+			double coord; // x of vertical, y of horizontal streets.
+			std::vector<double> stops; // Sorted positions of intersections along the street.
+			std::vector<int> ids; // Intersection ids, used to pick the same one as Phone::Move.
+		};
+
+		static void AddStop(std::vector<Street>& streets, double coord, double stop, int id);
+		static int FindStreet(const std::vector<Street>& streets, double coord);
+		void SetDirection(int i, Phone::Directions dir);
+		void SetVelocity(int i);
+		void UpdateNextStop(int i);
+		void Advance(int i, double distance);
+		void IntersectAction(int i, double distance_to_intersection);
+		// Intersection phone i passes this step, false if none.
+		bool FindCrossing(int i, double& stop) const;
+
+		const AreaMap &area_map_;
+		// Distinct turn distributions, phones usually share one.
+		std::vector<boost::random::discrete_distribution<> > turn_dists_;
+		std::vector<Street> vertical_streets_; // Sorted by coord.
+		std::vector<Street> horizontal_streets_;
+
+		std::vector<double> xs_;
+		std::vector<double> ys_;
+		std::vector<double> speeds_;
+		std::vector<double> unit_xs_; // Moving direction, +-1 or 0.
+		std::vector<double> unit_ys_;
+		std::vector<double> vel_xs_; // Unit times speed, 0 for inactive phones.
+		std::vector<double> vel_ys_;
+		// Next intersection ahead times the moving direction, so a phone
+		// passes it if its destination times the direction is not less.
+		// Infinity if there is none or the phone is inactive.
+		std::vector<double> next_stops_;
+		std::vector<double> steps_; // 1 to move straight this step, 0 if the phone was turned.
+		std::vector<unsigned char> dirs_;
+		std::vector<char> active_;
+		std::vector<int> streets_; // Street the phone moves along, -1 if it has no intersection.
+		std::vector<PhiloxEngine> turn_rngs_;
+		std::vector<int> turn_dist_ids_;
+	};
+}
+
+#endif /* defined(__PhoneSim__mobility_engine__) */
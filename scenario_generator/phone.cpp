@@ -34,12 +34,12 @@ namespace mobile_sensing_sim {
 			return;
 		}
 		
-		log <<"---------------------------------------\n";
-		log << "Phone " << kID_ << " starts moving.\n";
+		SIMLOG_TRACE(log) <<"---------------------------------------\n";
+		SIMLOG_TRACE(log) << "Phone " << kID_ << " starts moving.\n";
 		
 		double total_distance = speed_;
-		log << "current location: (" << location_.x << "," << location_.y << ")\n";
-		log << "total distance: " << speed_ << "\n";
+		SIMLOG_TRACE(log) << "current location: (" << location_.x << "," << location_.y << ")\n";
+		SIMLOG_TRACE(log) << "total distance: " << speed_ << "\n";
 		
 		// The phone may need to turn.
 		// Check if the phone passes a intersection point.
@@ -56,14 +56,14 @@ namespace mobile_sensing_sim {
 			const Point &pt = monitor_map_ptr_->area_map_.intersect_points_[i];
 			if (location_.x == pt.x) {
 				if ((location_.y < pt.y && dest_location.y >= pt.y) || (location_.y > pt.y && dest_location.y <= pt.y)) {
-					log << "The movement will pass intersection point via Y axis.\n";
+					SIMLOG_TRACE(log) << "The movement will pass intersection point via Y axis.\n";
 					IntersectAction(std::abs(pt.y - location_.y), total_distance);
 					pass_intersection = true;
 					break;
 				}
 			} else if (location_.y == pt.y) {
 				if ((location_.x < pt.x && dest_location.x >= pt.x) || (location_.x > pt.x && dest_location.x <= pt.x)) {
-					log << "The movement will pass intersection point via X axis.\n";
+					SIMLOG_TRACE(log) << "The movement will pass intersection point via X axis.\n";
 					IntersectAction(std::abs(pt.x - location_.x), total_distance);
 					pass_intersection = true;
 					break;
@@ -80,13 +80,13 @@ namespace mobile_sensing_sim {
 		if (monitor_map_ptr_->area_map_.IsOutOfBound(location_)) {
 			is_active_ = false;
 		}
-		log <<"---------------------------------------\n\n";
+		SIMLOG_TRACE(log) <<"---------------------------------------\n\n";
 	}
 	
 	void Phone::MoveForward(double distance) {
 		// Compute destination point following current moving direction.
 		// The destination may be out of region.
-		log << "Move forward (towards " << GetDirectionName(moving_direction_) << ".)" << distance << ".\n";
+		SIMLOG_TRACE(log) << "Move forward (towards " << GetDirectionName(moving_direction_) << ".)" << distance << ".\n";
 		if (moving_direction_ == LEFT) {
 			location_.x -= distance;
 		} else if (moving_direction_ == RIGHT) {
@@ -101,19 +101,19 @@ namespace mobile_sensing_sim {
 	void Phone::IntersectAction(double distance_to_intersection, double total_distance) {
 		
 		// Compute turning direction using given probability.
-		int turn_decision = dist(RandomGenerator::get_gen());
+		int turn_decision = dist(turn_rng_);
 		if (turn_decision == 2) {
 			// Move straight.
-			log << "Turn decision: go straight.\n";
+			SIMLOG_TRACE(log) << "Turn decision: go straight.\n";
 			MoveForward(total_distance);
 		}else {
-			log << "Turn decision: turn left or right. move to intersection first.\n";
+			SIMLOG_TRACE(log) << "Turn decision: turn left or right. move to intersection first.\n";
 			MoveForward(distance_to_intersection);
 			if (turn_decision == 0) {
-				log << "Turn left.\n";
+				SIMLOG_TRACE(log) << "Turn left.\n";
 				TurnLeft();
 			} else {
-				log << "Turn right.\n";
+				SIMLOG_TRACE(log) << "Turn right.\n";
 				TurnRight();
 			}
 			MoveForward(total_distance - distance_to_intersection);
@@ -11,6 +11,7 @@
 
 #include "monitor_map.h"
 #include "../error_handler.h"
+#include "random_generator.h"
 #include <boost/random/mersenne_twister.hpp>
 #include "boost/random/discrete_distribution.hpp"
 
@@ -59,6 +60,20 @@ namespace mobile_sensing_sim {
 		}
 		
 		void SetTurnProbability (const TurnProbability& tp);
+		const boost::random::discrete_distribution<>& GetTurnDistribution() const {
+			return dist;
+		}
+		
+		// Use the turn stream of (seed, kID_), call after kID_ is set.
+		void SeedTurns(int seed) {
+			turn_rng_ = RandomGenerator::Stream(seed, kID_, RandomGenerator::PHONE_TURNS);
+		}
+		const PhiloxEngine& GetTurnEngine() const {
+			return turn_rng_;
+		}
+		void SetTurnEngine(const PhiloxEngine& engine) {
+			turn_rng_ = engine;
+		}
 		
 		Directions moving_direction_;
 		double speed_;
@@ -77,6 +92,7 @@ namespace mobile_sensing_sim {
 		void TurnRight();
 		
 		boost::random::discrete_distribution<> dist;
+		PhiloxEngine turn_rng_; // Copied with the phone, so copies replay the same turns.
 		Point location_;
 	};
 }
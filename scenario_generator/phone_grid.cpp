@@ -0,0 +1,123 @@
+//
+//  phone_grid.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/10/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <algorithm>
+#include "phone_grid.h"
+
+namespace mobile_sensing_sim {
+	PhoneGrid::PhoneGrid(double length, double width, double range) : range_square_(range * range) {
+		// Widen cells by a tiny margin so that rounding in the cell
+		// computation can never put two phones in range two cells apart.
+		cell_size_ = std::max(range, 1.0) * (1.0 + 1.0E-9);
+		cell_xcount_ = static_cast<int>(std::floor(length / cell_size_)) + 1;
+		cell_ycount_ = static_cast<int>(std::floor(width / cell_size_)) + 1;
+	}
+	
+	int PhoneGrid::CellIndex(double pos, int cell_count) const {
+		int index = static_cast<int>(std::floor(pos / cell_size_));
+		if (index < 0) {
+			return 0;
+		}
+		if (index >= cell_count) {
+			return cell_count - 1;
+		}
+		return index;
+	}
+	
+	void PhoneGrid::Build(const std::vector<Phone>& phones) {
+		const int kPhoneCount = phones.size();
+		xs_.resize(kPhoneCount);
+		ys_.resize(kPhoneCount);
+		active_.resize(kPhoneCount);
+		for (int i = 0; i < kPhoneCount; ++i) {
+			xs_[i] = phones[i].GetLocation().x;
+			ys_[i] = phones[i].GetLocation().y;
+			active_[i] = phones[i].is_active_;
+		}
+		Build(xs_.data(), ys_.data(), active_.data(), kPhoneCount);
+	}
+	
+	void PhoneGrid::Build(const double* xs, const double* ys, const char* active, int phone_count) {
+		const int kCellCount = cell_xcount_ * cell_ycount_;
+		const int kPhoneCount = phone_count;
+		
+		neighbors_.resize(kPhoneCount);
+		for (int i = 0; i < kPhoneCount; ++i) {
+			neighbors_[i].clear();
+		}
+		
+		// Counting sort of active phones by cell.
+		cell_start_.assign(kCellCount + 1, 0);
+		phone_cells_.assign(kPhoneCount, -1);
+		int active_count = 0;
+		for (int i = 0; i < kPhoneCount; ++i) {
+			if (!active[i]) {
+				continue;
+			}
+			int cell = CellIndex(ys[i], cell_ycount_) * cell_xcount_ + CellIndex(xs[i], cell_xcount_);
+			phone_cells_[i] = cell;
+			++cell_start_[cell + 1];
+			++active_count;
+		}
+		for (int c = 0; c < kCellCount; ++c) {
+			cell_start_[c + 1] += cell_start_[c];
+		}
+		cell_phones_.resize(active_count);
+		std::vector<int> cursor(cell_start_.begin(), cell_start_.end() - 1);
+		for (int i = 0; i < kPhoneCount; ++i) {
+			if (phone_cells_[i] != -1) {
+				cell_phones_[cursor[phone_cells_[i]]++] = i;
+			}
+		}
+		
+		// Each cell is paired with itself and with the half of its
+		// neighbor cells that come after it, so every pair is seen once.
+		for (int cy = 0; cy < cell_ycount_; ++cy) {
+			for (int cx = 0; cx < cell_xcount_; ++cx) {
+				const int cell = cy * cell_xcount_ + cx;
+				if (cell_start_[cell] == cell_start_[cell + 1]) {
+					continue;
+				}
+				TestCellPair(xs, ys, cell, cell);
+				if (cx + 1 < cell_xcount_) {
+					TestCellPair(xs, ys, cell, cell + 1);
+				}
+				if (cy + 1 < cell_ycount_) {
+					if (cx > 0) {
+						TestCellPair(xs, ys, cell, cell + cell_xcount_ - 1);
+					}
+					TestCellPair(xs, ys, cell, cell + cell_xcount_);
+					if (cx + 1 < cell_xcount_) {
+						TestCellPair(xs, ys, cell, cell + cell_xcount_ + 1);
+					}
+				}
+			}
+		}
+		
+		for (int i = 0; i < kPhoneCount; ++i) {
+			std::sort(neighbors_[i].begin(), neighbors_[i].end());
+		}
+	}
+	
+	void PhoneGrid::TestCellPair(const double* xs, const double* ys, int cell1, int cell2) {
+		for (int a = cell_start_[cell1]; a < cell_start_[cell1 + 1]; ++a) {
+			const int i = cell_phones_[a];
+			const Point loc(xs[i], ys[i]);
+			// Within one cell only test phones after i.
+			const int kStart = cell1 == cell2 ? a + 1 : cell_start_[cell2];
+			for (int b = kStart; b < cell_start_[cell2 + 1]; ++b) {
+				const int j = cell_phones_[b];
+				if (Point::DistanceSquare(loc, Point(xs[j], ys[j])) <= range_square_) {
+					neighbors_[i].push_back(j);
+					neighbors_[j].push_back(i);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,53 @@
+//
+//  phone_grid.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/10/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__phone_grid__
+#define __PhoneSim__phone_grid__
+
+#include <vector>
+#include "phone.h"
+
+namespace mobile_sensing_sim {
+	// Uniform grid (cell list) over the area map used to find phones
+	// in communication range of each other without testing every pair.
+	// Cells are as wide as the range, so phones in range are always in
+	// the same or in adjacent cells.
+	class PhoneGrid {
+	public:
+		PhoneGrid(double length, double width, double range);
+		
+		// Bin active phones and find all active neighbors within range.
+		// Every unordered pair is tested once.
+		void Build(const std::vector<Phone>& phones);
+		// Same for phones given by location arrays and active flags.
+		void Build(const double* xs, const double* ys, const char* active, int phone_count);
+		
+		// Active phones in range of phone i, sorted by id.
+		const std::vector<int>& Neighbors(int i) const {
+			return neighbors_[i];
+		}
+	private:
+		int CellIndex(double pos, int cell_count) const;
+		void TestCellPair(const double* xs, const double* ys, int cell1, int cell2);
+		
+		double cell_size_;
+		double range_square_;
+		int cell_xcount_;
+		int cell_ycount_;
+		std::vector<int> cell_start_; // Size = cell count + 1
+		std::vector<int> cell_phones_; // Active phones ordered by cell.
+		std::vector<int> phone_cells_;
+		std::vector<std::vector<int> > neighbors_;
+		// Phone state gathered by Build(phones).
+		std::vector<double> xs_;
+		std::vector<double> ys_;
+		std::vector<char> active_;
+	};
+}
+
+#endif /* defined(__PhoneSim__phone_grid__) */
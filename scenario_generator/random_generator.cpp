@@ -1,13 +0,0 @@
-//
-//  random_generator.cpp
-//  MobileSensingSim
-//
-//  Created by Yuan on 5/2/14.
-//  Copyright (c) 2014 Yuan. All rights reserved.
-//
-
-#include "random_generator.h"
-
-namespace mobile_sensing_sim {
-	boost::mt19937 RandomGenerator::rng_;
-}
\ No newline at end of file
@@ -9,21 +9,116 @@
 #ifndef __MobileSensingSim__random_generator__
 #define __MobileSensingSim__random_generator__
 
-#include <boost/random/mersenne_twister.hpp>
-#include "boost/random/discrete_distribution.hpp"
+#include <boost/cstdint.hpp>
 
 namespace mobile_sensing_sim {
-	class RandomGenerator {
+	// Counter based Philox4x32-10 generator (Salmon et al., SC'11).
+	// Output block n is a keyed bijection of the counter (n, stream),
+	// so every (key, stream) pair is an independent random sequence
+	// which needs no shared state and costs 24 bytes to keep.
+	class PhiloxEngine {
 	public:
-		static boost::mt19937& get_gen() {
-			return rng_;
+		typedef boost::uint32_t result_type;
+		
+		PhiloxEngine() {
+			seed(0, 0, 0);
+		}
+		PhiloxEngine(result_type key0, result_type key1, result_type stream) {
+			seed(key0, key1, stream);
+		}
+		
+		void seed(result_type key0, result_type key1, result_type stream) {
+			key_[0] = key0;
+			key_[1] = key1;
+			stream_ = stream;
+			block_id_ = 0;
+			index_ = 4;
+		}
+		
+		static result_type min BOOST_PREVENT_MACRO_SUBSTITUTION () {
+			return 0;
+		}
+		static result_type max BOOST_PREVENT_MACRO_SUBSTITUTION () {
+			return 0xFFFFFFFFu;
+		}
+		
+		result_type operator()() {
+			if (index_ == 4) {
+				GenerateBlock();
+				++block_id_;
+				index_ = 0;
+			}
+			return block_[index_++];
+		}
+		
+		void discard(boost::uint64_t n) {
+			boost::uint64_t pos = position() + n;
+			block_id_ = pos / 4;
+			index_ = 4;
+			for (int i = 0; i < pos % 4; ++i) {
+				(*this)();
+			}
 		}
 		
-		static void set_seed(int seed) {
-			rng_.seed(seed);
+		// State of the engine, seed(key(0), key(1), stream()) followed
+		// by discard(position()) restores it.
+		result_type key(int i) const {
+			return key_[i];
+		}
+		result_type stream() const {
+			return stream_;
+		}
+		boost::uint64_t position() const {
+			return block_id_ * 4 - (4 - index_);
 		}
 	private:
-		static boost::mt19937 rng_;
+		static void MulHiLo(result_type a, result_type b, result_type& hi, result_type& lo) {
+			boost::uint64_t product = static_cast<boost::uint64_t>(a) * b;
+			hi = static_cast<result_type>(product >> 32);
+			lo = static_cast<result_type>(product);
+		}
+		
+		void GenerateBlock() {
+			result_type ctr[4] = {static_cast<result_type>(block_id_), static_cast<result_type>(block_id_ >> 32), stream_, 0};
+			result_type key[2] = {key_[0], key_[1]};
+			for (int round = 0; round < 10; ++round) {
+				if (round > 0) {
+					key[0] += 0x9E3779B9u;
+					key[1] += 0xBB67AE85u;
+				}
+				result_type hi0, lo0, hi1, lo1;
+				MulHiLo(0xD2511F53u, ctr[0], hi0, lo0);
+				MulHiLo(0xCD9E8D57u, ctr[2], hi1, lo1);
+				ctr[0] = hi1 ^ ctr[1] ^ key[0];
+				ctr[1] = lo1;
+				ctr[2] = hi0 ^ ctr[3] ^ key[1];
+				ctr[3] = lo0;
+			}
+			for (int i = 0; i < 4; ++i) {
+				block_[i] = ctr[i];
+			}
+		}
+		
+		result_type key_[2];
+		result_type stream_;
+		boost::uint64_t block_id_;
+		result_type block_[4];
+		int index_;
+	};
+	
+	class RandomGenerator {
+	public:
+		// Purposes of the per phone random streams.
+		enum StreamPurpose {
+			PHONE_ATTRIBUTES = 0, // Speed, entry point, costs, start time.
+			PHONE_TURNS // Turn decisions at intersections.
+		};
+		
+		// Random stream of one phone for one purpose. Draws only depend
+		// on (seed, phone id, purpose) and not on other phones.
+		static PhiloxEngine Stream(int seed, int phone_id, StreamPurpose purpose) {
+			return PhiloxEngine(static_cast<PhiloxEngine::result_type>(seed), static_cast<PhiloxEngine::result_type>(phone_id), purpose);
+		}
 	};
 }
 
@@ -0,0 +1,189 @@
+//
+//  scenario_cache.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/22/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <ctime>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include "scenario_cache.h"
+
+namespace fs = boost::filesystem;
+
+namespace mobile_sensing_sim {
+	namespace {
+		const char kExtension[] = ".scen";
+
+		// Raw bytes of all parameters, equal bytes mean equal scenarios.
+		class ParamBytes {
+		public:
+			template <typename T>
+			void Add(const T& value) {
+				bytes_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+			}
+			void Add(const Range& r) {
+				Add(r.min);
+				Add(r.max);
+				Add(r.step);
+			}
+			void Add(const std::vector<Point>& points) {
+				Add(static_cast<boost::uint64_t>(points.size()));
+				for (int i = 0; i < points.size(); ++i) {
+					Add(points[i].x);
+					Add(points[i].y);
+				}
+			}
+			const std::string& Bytes() const {
+				return bytes_;
+			}
+		private:
+			std::string bytes_;
+		};
+
+		std::string Serialize(const ScenarioParameters& sp) {
+			ParamBytes b;
+			// Versions are copied, Add takes references.
+			b.Add(static_cast<int>(ScenarioCache::kGeneratorVersion));
+			b.Add(static_cast<int>(ScenarioFile::kVersion));
+			b.Add(sp.phone_count);
+			b.Add(sp.running_time);
+			b.Add(sp.comm_range);
+			b.Add(sp.sensing_range);
+			b.Add(sp.speed_range);
+			b.Add(sp.start_time_range);
+			b.Add(sp.seed);
+			b.Add(sp.tp.left);
+			b.Add(sp.tp.right);
+			b.Add(sp.tp.straight);
+			b.Add(sp.map.monitor_points_);
+			b.Add(sp.map.area_map_.entry_points_);
+			b.Add(sp.map.area_map_.intersect_points_);
+			b.Add(sp.map.area_map_.length_);
+			b.Add(sp.map.area_map_.width_);
+			b.Add(sp.data_per_second);
+			b.Add(sp.sensing_cost_range);
+			b.Add(sp.transfer_cost_range);
+			b.Add(sp.upload_cost_range);
+			b.Add(sp.upload_limit_range);
+			return b.Bytes();
+		}
+
+		// 64 bit FNV-1a.
+		boost::uint64_t Hash(const std::string& bytes) {
+			boost::uint64_t h = 14695981039346656037ULL;
+			for (int i = 0; i < bytes.size(); ++i) {
+				h ^= static_cast<unsigned char>(bytes[i]);
+				h *= 1099511628211ULL;
+			}
+			return h;
+		}
+
+		struct CacheEntry {
+			std::time_t last_use;
+			boost::uint64_t size;
+			fs::path path;
+			bool operator<(const CacheEntry& other) const {
+				return last_use < other.last_use;
+			}
+		};
+	}
+
+	ScenarioCache::ScenarioCache(const std::string& dir, boost::uint64_t max_bytes) : dir_(dir), max_bytes_(max_bytes) {
+		boost::system::error_code ec;
+		fs::create_directories(dir_, ec);
+		if (ec) {
+			ErrorHandler::RunningWarning("Failed to create scenario cache " + dir_ + ": " + ec.message());
+		}
+	}
+
+	std::string ScenarioCache::Key(const ScenarioParameters& sp) {
+		char key[17];
+		std::sprintf(key, "%016llx", static_cast<unsigned long long>(Hash(Serialize(sp))));
+		return key;
+	}
+
+	std::string ScenarioCache::PathOf(const std::string& key) const {
+		return (fs::path(dir_) / (key + kExtension)).string();
+	}
+
+	ScenarioFilePtr ScenarioCache::Load(const ScenarioParameters& sp) {
+		const std::string kPath = PathOf(Key(sp));
+		boost::system::error_code ec;
+		if (!fs::exists(kPath, ec)) {
+			return ScenarioFilePtr();
+		}
+		ScenarioFilePtr file(new ScenarioFile());
+		if (!file->Open(kPath)) {
+			// Unreadable, generate it again.
+			fs::remove(kPath, ec);
+			return ScenarioFilePtr();
+		}
+		if (Serialize(file->GetScenario().scen_param) != Serialize(sp)) {
+			// Hash collision.
+			return ScenarioFilePtr();
+		}
+		// Mark as recently used.
+		fs::last_write_time(kPath, std::time(NULL), ec);
+		return file;
+	}
+
+	void ScenarioCache::Store(const ScenarioParameters& sp, const Scenario& scen) {
+		// Write to a unique name first, readers never see partial files.
+		boost::system::error_code ec;
+		const std::string kPath = PathOf(Key(sp));
+		const std::string kTempPath = (fs::path(dir_) / fs::unique_path("%%%%-%%%%-%%%%.tmp")).string();
+		if (!ScenarioFile::Write(scen, kTempPath)) {
+			fs::remove(kTempPath, ec);
+			return;
+		}
+		fs::rename(kTempPath, kPath, ec);
+		if (ec) {
+			ErrorHandler::RunningWarning("Failed to add " + kPath + " to the scenario cache: " + ec.message());
+			fs::remove(kTempPath, ec);
+			return;
+		}
+		Evict(kPath);
+	}
+
+	void ScenarioCache::Evict() {
+		Evict(std::string());
+	}
+
+	void ScenarioCache::Evict(const std::string& keep_path) {
+		boost::mutex::scoped_lock lock(mutex_);
+		boost::system::error_code ec;
+		std::vector<CacheEntry> entries;
+		boost::uint64_t total = 0;
+		for (fs::directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+			if (it->path().extension() != kExtension) {
+				continue;
+			}
+			CacheEntry entry;
+			entry.path = it->path();
+			entry.size = fs::file_size(entry.path, ec);
+			if (!ec) {
+				entry.last_use = fs::last_write_time(entry.path, ec);
+			}
+			if (ec) {
+				// Removed by another process meanwhile.
+				ec.clear();
+				continue;
+			}
+			total += entry.size;
+			// Times have a resolution of seconds, never pick the new file.
+			if (entry.path != keep_path) {
+				entries.push_back(entry);
+			}
+		}
+		std::sort(entries.begin(), entries.end());
+		for (int i = 0; i < entries.size() && total > max_bytes_; ++i) {
+			fs::remove(entries[i].path, ec);
+			total -= entries[i].size;
+		}
+	}
+}
@@ -0,0 +1,56 @@
+//
+//  scenario_cache.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/22/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__scenario_cache__
+#define __PhoneSim__scenario_cache__
+
+#include <string>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include "scenario_file.h"
+
+namespace mobile_sensing_sim {
+	class ScenarioCache;
+	typedef boost::shared_ptr<ScenarioCache> ScenarioCachePtr;
+	typedef boost::shared_ptr<ScenarioFile> ScenarioFilePtr;
+
+	// Directory of scenario files named by a hash of all scenario
+	// parameters, so a scenario is generated once per parameter set.
+	// When the files exceed the size limit the least recently used
+	// ones are removed. Safe to use from several threads.
+	class ScenarioCache {
+	public:
+		// Bump when generation changes, so old files are not used.
+		static const int kGeneratorVersion = 1;
+
+		ScenarioCache(const std::string& dir, boost::uint64_t max_bytes);
+
+		// Hex hash of every field of sp and the file / generator versions.
+		static std::string Key(const ScenarioParameters& sp);
+
+		// Mapped scenario of sp, NULL on a miss.
+		ScenarioFilePtr Load(const ScenarioParameters& sp);
+
+		// Add the scenario generated from sp, then evict.
+		void Store(const ScenarioParameters& sp, const Scenario& scen);
+
+		// Remove least recently used files until the limit is met.
+		void Evict();
+	private:
+		// Evict all files but keep_path.
+		void Evict(const std::string& keep_path);
+		std::string PathOf(const std::string& key) const;
+
+		std::string dir_;
+		boost::uint64_t max_bytes_;
+		boost::mutex mutex_; // Guards eviction.
+	};
+}
+
+#endif /* defined(__PhoneSim__scenario_cache__) */
@@ -0,0 +1,467 @@
+//
+//  scenario_file.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/21/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <boost/cstdint.hpp>
+#include <boost/static_assert.hpp>
+#include "scenario_file.h"
+
+namespace mobile_sensing_sim {
+	namespace {
+		const char kMagic[8] = {'P', 'H', 'S', 'C', 'E', 'N', '\0', '\0'};
+		const boost::uint32_t kByteOrder = 0x01020304;
+		const boost::uint64_t kAlignment = 8;
+
+		struct FileHeader {
+			char magic[8];
+			boost::uint32_t version;
+			boost::uint32_t byte_order;
+			boost::int32_t phone_count;
+			boost::int32_t target_count;
+			boost::int32_t running_time;
+			boost::int32_t entry_count;
+			boost::int32_t intersect_count;
+			boost::int32_t start_count; // Phones in the start phone lists.
+			boost::uint64_t contact_count;
+			// Section offsets from the start of the file.
+			boost::uint64_t params;
+			boost::uint64_t entry_points;
+			boost::uint64_t intersect_points;
+			boost::uint64_t monitor_points;
+			boost::uint64_t phones;
+			boost::uint64_t start_offsets; // Size = running time + 1
+			boost::uint64_t start_ids; // Size = start count
+			boost::uint64_t trajectories; // Size = running time * phone count
+			boost::uint64_t slice_begins; // Size = running time + 1
+			boost::uint64_t row_offsets; // Size = running time * (phone count + 1)
+			boost::uint64_t contact_ids; // Size = contact count
+			boost::uint64_t contact_data; // Size = contact count
+			boost::uint64_t file_size;
+		};
+
+		struct RangeRecord {
+			boost::int32_t min;
+			boost::int32_t max;
+			double step;
+		};
+
+		struct ParamsRecord {
+			boost::int32_t phone_count;
+			boost::int32_t running_time;
+			boost::int32_t comm_range;
+			boost::int32_t sensing_range;
+			boost::int32_t seed;
+			boost::int32_t reserved;
+			RangeRecord speed_range;
+			RangeRecord start_time_range;
+			RangeRecord sensing_cost_range;
+			RangeRecord transfer_cost_range;
+			RangeRecord upload_cost_range;
+			RangeRecord upload_limit_range;
+			double turn_left;
+			double turn_right;
+			double turn_straight;
+			double data_per_second;
+			double map_length;
+			double map_width;
+		};
+
+		// Phone at its start, with the state of its turn stream.
+		struct PhoneRecord {
+			double x;
+			double y;
+			double speed;
+			double sensing_cost;
+			double transfer_cost;
+			double upload_cost;
+			double upload_limit;
+			boost::int32_t id;
+			boost::int32_t direction;
+			boost::int32_t is_active;
+			boost::uint32_t turn_key0;
+			boost::uint32_t turn_key1;
+			boost::uint32_t turn_stream;
+			boost::uint64_t turn_position;
+		};
+
+		// Points are mapped in place.
+		BOOST_STATIC_ASSERT(sizeof(Point) == 2 * sizeof(double));
+		BOOST_STATIC_ASSERT(sizeof(PhoneRecord) == 88);
+
+		RangeRecord ToRecord(const Range& r) {
+			RangeRecord rec;
+			rec.min = r.min;
+			rec.max = r.max;
+			rec.step = r.step;
+			return rec;
+		}
+
+		Range FromRecord(const RangeRecord& rec) {
+			Range r;
+			r.min = rec.min;
+			r.max = rec.max;
+			r.step = rec.step;
+			return r;
+		}
+
+		// Offset of a new section of bytes at pos, pos moves past it.
+		boost::uint64_t AddSection(boost::uint64_t& pos, boost::uint64_t bytes) {
+			pos = (pos + kAlignment - 1) / kAlignment * kAlignment;
+			boost::uint64_t offset = pos;
+			pos += bytes;
+			return offset;
+		}
+
+		bool HasSection(const FileHeader& h, boost::uint64_t offset, boost::uint64_t bytes) {
+			return offset % kAlignment == 0 && offset <= h.file_size && bytes <= h.file_size - offset;
+		}
+
+		// Sequential writer, pads with zeros up to section offsets.
+		class SectionWriter {
+		public:
+			SectionWriter(std::ofstream& of) : of_(of), pos_(0) {}
+
+			void Seek(boost::uint64_t offset) {
+				static const char kZeros[kAlignment] = {0};
+				while (pos_ < offset) {
+					const boost::uint64_t kBytes = std::min(offset - pos_, kAlignment);
+					of_.write(kZeros, kBytes);
+					pos_ += kBytes;
+				}
+			}
+
+			template <typename T>
+			void Write(const T* values, boost::uint64_t count) {
+				of_.write(reinterpret_cast<const char*>(values), sizeof(T) * count);
+				pos_ += sizeof(T) * count;
+			}
+
+			template <typename T>
+			void Write(const T& value) {
+				Write(&value, 1);
+			}
+		private:
+			std::ofstream& of_;
+			boost::uint64_t pos_;
+		};
+
+		class Unmapper {
+		public:
+			Unmapper(std::size_t size) : size_(size) {}
+			void operator()(const void* addr) const {
+				munmap(const_cast<void*>(addr), size_);
+			}
+		private:
+			std::size_t size_;
+		};
+
+		template <typename T>
+		const T* At(const char* base, boost::uint64_t offset) {
+			return reinterpret_cast<const T*>(base + offset);
+		}
+	}
+
+	bool ScenarioFile::Write(const Scenario& scen, const std::string& path) {
+		if (scen.contacts.Empty()) {
+			ErrorHandler::CodingError("Please generate scenario before writing to file!");
+			return false;
+		}
+		const ScenarioParameters &sp = scen.scen_param;
+		const AreaMap &am = sp.map.area_map_;
+		const ContactList &contacts = scen.contacts;
+		const boost::uint64_t kTime = scen.running_time;
+		const boost::uint64_t kPhones = scen.phone_count;
+
+		FileHeader h;
+		std::memset(&h, 0, sizeof(h));
+		std::memcpy(h.magic, kMagic, sizeof(kMagic));
+		h.version = kVersion;
+		h.byte_order = kByteOrder;
+		h.phone_count = scen.phone_count;
+		h.target_count = scen.target_count;
+		h.running_time = scen.running_time;
+		h.entry_count = am.entry_points_.size();
+		h.intersect_count = am.intersect_points_.size();
+		h.contact_count = contacts.ContactCount();
+		// Phones may not all have started, e.g. in the scenarios the
+		// heuristics predict from.
+		for (int t = 0; t < scen.running_time; ++t) {
+			h.start_count += scen.start_phones[t].size();
+		}
+
+		boost::uint64_t pos = sizeof(FileHeader);
+		h.params = AddSection(pos, sizeof(ParamsRecord));
+		h.entry_points = AddSection(pos, sizeof(Point) * h.entry_count);
+		h.intersect_points = AddSection(pos, sizeof(Point) * h.intersect_count);
+		h.monitor_points = AddSection(pos, sizeof(Point) * h.target_count);
+		h.phones = AddSection(pos, sizeof(PhoneRecord) * kPhones);
+		h.start_offsets = AddSection(pos, sizeof(boost::int32_t) * (kTime + 1));
+		h.start_ids = AddSection(pos, sizeof(boost::int32_t) * h.start_count);
+		h.trajectories = AddSection(pos, sizeof(Point) * kTime * kPhones);
+		h.slice_begins = AddSection(pos, sizeof(boost::int64_t) * (kTime + 1));
+		h.row_offsets = AddSection(pos, sizeof(boost::int32_t) * kTime * (kPhones + 1));
+		h.contact_ids = AddSection(pos, sizeof(boost::int32_t) * h.contact_count);
+		h.contact_data = AddSection(pos, sizeof(double) * h.contact_count);
+		h.file_size = pos;
+
+		std::ofstream of(path.c_str(), std::ios::binary | std::ios::trunc);
+		if (!of) {
+			ErrorHandler::RunningWarning("Failed to create scenario file " + path);
+			return false;
+		}
+		SectionWriter w(of);
+		w.Write(h);
+
+		ParamsRecord p;
+		std::memset(&p, 0, sizeof(p));
+		p.phone_count = sp.phone_count;
+		p.running_time = sp.running_time;
+		p.comm_range = sp.comm_range;
+		p.sensing_range = sp.sensing_range;
+		p.seed = sp.seed;
+		p.speed_range = ToRecord(sp.speed_range);
+		p.start_time_range = ToRecord(sp.start_time_range);
+		p.sensing_cost_range = ToRecord(sp.sensing_cost_range);
+		p.transfer_cost_range = ToRecord(sp.transfer_cost_range);
+		p.upload_cost_range = ToRecord(sp.upload_cost_range);
+		p.upload_limit_range = ToRecord(sp.upload_limit_range);
+		p.turn_left = sp.tp.left;
+		p.turn_right = sp.tp.right;
+		p.turn_straight = sp.tp.straight;
+		p.data_per_second = sp.data_per_second;
+		p.map_length = am.length_;
+		p.map_width = am.width_;
+		w.Seek(h.params);
+		w.Write(p);
+
+		w.Seek(h.entry_points);
+		w.Write(am.entry_points_.data(), h.entry_count);
+		w.Seek(h.intersect_points);
+		w.Write(am.intersect_points_.data(), h.intersect_count);
+		w.Seek(h.monitor_points);
+		w.Write(sp.map.monitor_points_.data(), h.target_count);
+
+		w.Seek(h.phones);
+		for (int i = 0; i < scen.phones.size(); ++i) {
+			const Phone &ph = scen.phones[i];
+			const PhiloxEngine &rng = ph.GetTurnEngine();
+			PhoneRecord rec;
+			std::memset(&rec, 0, sizeof(rec));
+			rec.x = ph.GetLocation().x;
+			rec.y = ph.GetLocation().y;
+			rec.speed = ph.speed_;
+			rec.sensing_cost = ph.costs_.sensing_cost;
+			rec.transfer_cost = ph.costs_.transfer_cost;
+			rec.upload_cost = ph.costs_.upload_cost;
+			rec.upload_limit = ph.upload_limit_;
+			rec.id = ph.kID_;
+			rec.direction = ph.moving_direction_;
+			rec.is_active = ph.is_active_;
+			rec.turn_key0 = rng.key(0);
+			rec.turn_key1 = rng.key(1);
+			rec.turn_stream = rng.stream();
+			rec.turn_position = rng.position();
+			w.Write(rec);
+		}
+
+		w.Seek(h.start_offsets);
+		boost::int32_t start_offset = 0;
+		for (int t = 0; t < scen.running_time; ++t) {
+			w.Write(start_offset);
+			start_offset += scen.start_phones[t].size();
+		}
+		w.Write(start_offset);
+		w.Seek(h.start_ids);
+		for (int t = 0; t < scen.running_time; ++t) {
+			w.Write(scen.start_phones[t].data(), scen.start_phones[t].size());
+		}
+
+		w.Seek(h.trajectories);
+		w.Write(scen.phone_locations.Data(), kTime * kPhones);
+
+		w.Seek(h.slice_begins);
+		boost::int64_t slice_begin = 0;
+		for (int t = 0; t < contacts.TimeSize(); ++t) {
+			w.Write(slice_begin);
+			slice_begin += contacts.Slice(t).ids.size();
+		}
+		w.Write(slice_begin);
+		w.Seek(h.row_offsets);
+		for (int t = 0; t < contacts.TimeSize(); ++t) {
+			w.Write(contacts.Slice(t).offsets.data(), kPhones + 1);
+		}
+		w.Seek(h.contact_ids);
+		for (int t = 0; t < contacts.TimeSize(); ++t) {
+			w.Write(contacts.Slice(t).ids.data(), contacts.Slice(t).ids.size());
+		}
+		w.Seek(h.contact_data);
+		for (int t = 0; t < contacts.TimeSize(); ++t) {
+			w.Write(contacts.Slice(t).data.data(), contacts.Slice(t).data.size());
+		}
+
+		of.close();
+		if (!of) {
+			ErrorHandler::RunningWarning("Failed to write scenario file " + path);
+			return false;
+		}
+		return true;
+	}
+
+	bool ScenarioFile::Open(const std::string& path) {
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd == -1) {
+			ErrorHandler::RunningWarning("Failed to open scenario file " + path);
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) == -1 || st.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+			close(fd);
+			ErrorHandler::RunningWarning("Scenario file " + path + " is too short.");
+			return false;
+		}
+		const std::size_t kSize = st.st_size;
+		void *addr = mmap(NULL, kSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (addr == MAP_FAILED) {
+			ErrorHandler::RunningWarning("Failed to map scenario file " + path);
+			return false;
+		}
+		boost::shared_ptr<const void> storage(addr, Unmapper(kSize));
+		const char *base = static_cast<const char*>(addr);
+
+		// Check the header and that every section lies in the file.
+		const FileHeader &h = *At<FileHeader>(base, 0);
+		if (std::memcmp(h.magic, kMagic, sizeof(kMagic)) != 0) {
+			ErrorHandler::RunningWarning(path + " is not a scenario file.");
+			return false;
+		}
+		if (h.byte_order != kByteOrder || h.version != kVersion) {
+			ErrorHandler::RunningWarning("Scenario file " + path + " has another version or byte order.");
+			return false;
+		}
+		const boost::uint64_t kTime = h.running_time;
+		const boost::uint64_t kPhones = h.phone_count;
+		if (h.file_size != kSize || h.phone_count <= 0 || h.running_time <= 0 || h.target_count < 0 || h.start_count < 0 || h.start_count > h.phone_count || h.entry_count <= 0 || h.intersect_count < 0
+			|| !HasSection(h, h.params, sizeof(ParamsRecord))
+			|| !HasSection(h, h.entry_points, sizeof(Point) * h.entry_count)
+			|| !HasSection(h, h.intersect_points, sizeof(Point) * h.intersect_count)
+			|| !HasSection(h, h.monitor_points, sizeof(Point) * h.target_count)
+			|| !HasSection(h, h.phones, sizeof(PhoneRecord) * kPhones)
+			|| !HasSection(h, h.start_offsets, sizeof(boost::int32_t) * (kTime + 1))
+			|| !HasSection(h, h.start_ids, sizeof(boost::int32_t) * h.start_count)
+			|| !HasSection(h, h.trajectories, sizeof(Point) * kTime * kPhones)
+			|| !HasSection(h, h.slice_begins, sizeof(boost::int64_t) * (kTime + 1))
+			|| !HasSection(h, h.row_offsets, sizeof(boost::int32_t) * kTime * (kPhones + 1))
+			|| h.contact_count > h.file_size
+			|| !HasSection(h, h.contact_ids, sizeof(boost::int32_t) * h.contact_count)
+			|| !HasSection(h, h.contact_data, sizeof(double) * h.contact_count)) {
+			ErrorHandler::RunningWarning("Scenario file " + path + " is truncated or corrupted.");
+			return false;
+		}
+
+		// Check the indices the scenario is built from. Contact data
+		// is used as it is.
+		const boost::int32_t *start_offsets = At<boost::int32_t>(base, h.start_offsets);
+		const boost::int32_t *start_ids = At<boost::int32_t>(base, h.start_ids);
+		const boost::int64_t *slice_begins = At<boost::int64_t>(base, h.slice_begins);
+		const boost::int32_t *row_offsets = At<boost::int32_t>(base, h.row_offsets);
+		bool is_valid = start_offsets[0] == 0 && start_offsets[kTime] == h.start_count && slice_begins[0] == 0 && slice_begins[kTime] == static_cast<boost::int64_t>(h.contact_count);
+		for (boost::uint64_t t = 0; is_valid && t < kTime; ++t) {
+			is_valid = start_offsets[t] <= start_offsets[t + 1] && slice_begins[t] <= slice_begins[t + 1];
+			const boost::int32_t *rows = row_offsets + t * (kPhones + 1);
+			is_valid = is_valid && rows[0] == 0 && rows[kPhones] == slice_begins[t + 1] - slice_begins[t];
+			for (boost::uint64_t i = 0; is_valid && i < kPhones; ++i) {
+				is_valid = rows[i] <= rows[i + 1];
+			}
+		}
+		for (boost::int32_t i = 0; is_valid && i < h.start_count; ++i) {
+			is_valid = start_ids[i] >= 0 && start_ids[i] < h.phone_count;
+		}
+		if (!is_valid) {
+			ErrorHandler::RunningWarning("Scenario file " + path + " has invalid offsets.");
+			return false;
+		}
+		// Phones are followed by targets in the ids of a row.
+		const boost::int32_t *contact_ids = At<boost::int32_t>(base, h.contact_ids);
+		const boost::int64_t kIdEnd = static_cast<boost::int64_t>(h.phone_count) + h.target_count;
+		for (boost::uint64_t k = 0; is_valid && k < h.contact_count; ++k) {
+			is_valid = contact_ids[k] >= 0 && contact_ids[k] < kIdEnd;
+		}
+		if (!is_valid) {
+			ErrorHandler::RunningWarning("Scenario file " + path + " has contact ids out of range.");
+			return false;
+		}
+
+		scen_ = Scenario();
+		ScenarioParameters &sp = scen_.scen_param;
+		const ParamsRecord &p = *At<ParamsRecord>(base, h.params);
+		sp.phone_count = p.phone_count;
+		sp.running_time = p.running_time;
+		sp.comm_range = p.comm_range;
+		sp.sensing_range = p.sensing_range;
+		sp.seed = p.seed;
+		sp.speed_range = FromRecord(p.speed_range);
+		sp.start_time_range = FromRecord(p.start_time_range);
+		sp.sensing_cost_range = FromRecord(p.sensing_cost_range);
+		sp.transfer_cost_range = FromRecord(p.transfer_cost_range);
+		sp.upload_cost_range = FromRecord(p.upload_cost_range);
+		sp.upload_limit_range = FromRecord(p.upload_limit_range);
+		sp.tp.left = p.turn_left;
+		sp.tp.right = p.turn_right;
+		sp.tp.straight = p.turn_straight;
+		sp.data_per_second = p.data_per_second;
+		const Point *entry_points = At<Point>(base, h.entry_points);
+		const Point *intersect_points = At<Point>(base, h.intersect_points);
+		const Point *monitor_points = At<Point>(base, h.monitor_points);
+		AreaMap am(std::vector<Point>(entry_points, entry_points + h.entry_count), std::vector<Point>(intersect_points, intersect_points + h.intersect_count), p.map_length, p.map_width);
+		sp.map = MonitorMap(std::vector<Point>(monitor_points, monitor_points + h.target_count), am);
+
+		scen_.phone_count = h.phone_count;
+		scen_.target_count = h.target_count;
+		scen_.running_time = h.running_time;
+
+		// Phones point to the map of scen_.
+		const PhoneRecord *records = At<PhoneRecord>(base, h.phones);
+		scen_.phones.reserve(kPhones);
+		for (int i = 0; i < h.phone_count; ++i) {
+			const PhoneRecord &rec = records[i];
+			const Point kLocation(rec.x, rec.y);
+			if (rec.id != i || rec.direction < Phone::UP || rec.direction > Phone::LEFT || sp.map.area_map_.IsOutOfBound(kLocation)) {
+				scen_ = Scenario();
+				ErrorHandler::RunningWarning("Scenario file " + path + " has an invalid phone.");
+				return false;
+			}
+			Phone ph(kLocation, static_cast<Phone::Directions>(rec.direction), rec.speed, sp.map, sp.tp);
+			ph.costs_.sensing_cost = rec.sensing_cost;
+			ph.costs_.transfer_cost = rec.transfer_cost;
+			ph.costs_.upload_cost = rec.upload_cost;
+			ph.upload_limit_ = rec.upload_limit;
+			ph.kID_ = rec.id;
+			ph.is_active_ = rec.is_active != 0;
+			PhiloxEngine rng(rec.turn_key0, rec.turn_key1, rec.turn_stream);
+			rng.discard(rec.turn_position);
+			ph.SetTurnEngine(rng);
+			scen_.phones.push_back(ph);
+		}
+
+		scen_.start_phones.resize(kTime);
+		for (boost::uint64_t t = 0; t < kTime; ++t) {
+			scen_.start_phones[t].assign(start_ids + start_offsets[t], start_ids + start_offsets[t + 1]);
+		}
+
+		scen_.phone_locations.Map(At<Point>(base, h.trajectories), h.running_time, h.phone_count, storage);
+		scen_.contacts.Map(h.running_time, h.phone_count, h.target_count, slice_begins, row_offsets, At<boost::int32_t>(base, h.contact_ids), At<double>(base, h.contact_data), storage);
+		return true;
+	}
+}
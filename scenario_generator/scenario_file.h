@@ -0,0 +1,49 @@
+//
+//  scenario_file.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/21/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__scenario_file__
+#define __PhoneSim__scenario_file__
+
+#include <string>
+#include <boost/noncopyable.hpp>
+#include "scenario_generator.h"
+
+namespace mobile_sensing_sim {
+	// Binary scenario file. A fixed header with counts and section
+	// offsets is followed by 8 byte aligned sections:
+	//   parameters, entry / intersection / monitor points, phones,
+	//   start phones (offsets and ids), trajectories (time major
+	//   points), contacts (slice begins, row offsets, ids, data).
+	// Numbers are stored in host byte order, Open rejects files of
+	// another byte order or version.
+	//
+	// Trajectories and contacts are used in place from the memory
+	// mapped file, only parameters, phones and start phones are
+	// copied. The loaded scenario views the mapping and its phones
+	// point to the map of the scenario, so keep the ScenarioFile
+	// alive while the scenario or a copy of it is used.
+	class ScenarioFile : boost::noncopyable {
+	public:
+		static const unsigned int kVersion = 2;
+
+		// Write scen to path, false with a warning on I/O errors.
+		static bool Write(const Scenario& scen, const std::string& path);
+
+		// Map the scenario written to path, false with a warning if
+		// the file cannot be read or is not a valid scenario file.
+		bool Open(const std::string& path);
+
+		const Scenario& GetScenario() const {
+			return scen_;
+		}
+	private:
+		Scenario scen_;
+	};
+}
+
+#endif /* defined(__PhoneSim__scenario_file__) */
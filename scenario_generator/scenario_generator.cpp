@@ -5,6 +5,8 @@
 //  Created by Yuan on 5/1/14.
 //  Copyright (c) 2014 Yuan. All rights reserved.
 //
+#include <algorithm>
+#include <boost/bind/bind.hpp>
 #include <boost/random/uniform_int.hpp>
 #include "phone.h"
 #include "random_generator.h"
@@ -13,6 +15,12 @@
 #include "../simlog.h"
 
 namespace mobile_sensing_sim{
+	namespace {
+		// Windows of seconds per thread when finding contacts, so threads
+		// finishing early take more.
+		const int kWindowsPerThread = 4;
+	}
+	
 	const Scenario ScenarioGenerator::GenerateDefaultScenario() {
 		std::vector<Phone> phones;
 		std::vector<std::vector<int> > start_phones;
@@ -26,7 +34,6 @@ namespace mobile_sensing_sim{
 		start_phones.clear();
 		
 		// Check scenario parameters
-		RandomGenerator::set_seed(sp_.seed);
 		if (sp_.speed_range.min < 0) {
 			ErrorHandler::CodingError("Speed cannot be less than zero!");
 		}
@@ -59,12 +66,15 @@ namespace mobile_sensing_sim{
 		log << "Generating " << sp_.phone_count << " phones.\n" ;
 		for (int i = 0; i < sp_.phone_count; ++i) {
 			log << "***Phone " << i << ":***\n" ;
+			// Attributes of phone i only depend on (seed, i).
+			PhiloxEngine rng = RandomGenerator::Stream(sp_.seed, i, RandomGenerator::PHONE_ATTRIBUTES);
+			
 			// Randomly choose speed.
-			double speed = speedDist(RandomGenerator::get_gen()) * sp_.speed_range.step;
+			double speed = speedDist(rng) * sp_.speed_range.step;
 			log << "speed: " << speed << "\n" ;
 			
 			// Randomly choose entry point.
-			int entry_point_id = entrypointDist(RandomGenerator::get_gen());
+			int entry_point_id = entrypointDist(rng);
 			Point entry_point = sp_.map.area_map_.entry_points_[entry_point_id];
 			log << "entry point: (" << entry_point.x <<","<< entry_point.y << ")\n" ;
 			
@@ -74,15 +84,16 @@ namespace mobile_sensing_sim{
 			// Create phone and add to phone list.
 			// All phone use same turn probability.
 			Phone ph(entry_point, initial_dir, speed, sp_.map, sp_.tp);
-			ph.costs_.sensing_cost = sensing_cost_dist(RandomGenerator::get_gen()) * sp_.sensing_cost_range.step;
-			ph.costs_.transfer_cost = transfer_cost_dist(RandomGenerator::get_gen()) * sp_.transfer_cost_range.step;
-			ph.costs_.upload_cost = upload_cost_dist(RandomGenerator::get_gen()) * sp_.upload_cost_range.step;
-			ph.upload_limit_ = upload_limit_dist(RandomGenerator::get_gen()) * sp_.upload_limit_range.step;
+			ph.costs_.sensing_cost = sensing_cost_dist(rng) * sp_.sensing_cost_range.step;
+			ph.costs_.transfer_cost = transfer_cost_dist(rng) * sp_.transfer_cost_range.step;
+			ph.costs_.upload_cost = upload_cost_dist(rng) * sp_.upload_cost_range.step;
+			ph.upload_limit_ = upload_limit_dist(rng) * sp_.upload_limit_range.step;
 			ph.kID_ = i;
+			ph.SeedTurns(sp_.seed);
 			phones.push_back(ph);
 			
 			// Randomly choose start time.
-			int start_time = startTimeDist(RandomGenerator::get_gen());
+			int start_time = startTimeDist(rng);
 			log << "start time: " << start_time << "\n" ;
 			
 			// Save phone id to corresponding start time vector.
@@ -105,8 +116,9 @@ namespace mobile_sensing_sim{
 		scen.start_phones = start_phones;
 		scen.scen_param = sp_;
 		
-		// Make copy of phones for generating adj matrices.
-		std::vector<Phone> phones(original_phones);
+		// All phones move together in the engine.
+		MobilityEngine engine(sp_.map.area_map_);
+		engine.Load(original_phones);
 		
 		// Start create and write scenario.
 		log << "\n\n";
@@ -115,95 +127,116 @@ namespace mobile_sensing_sim{
 		log << "*********************************************\n";
 		
 		// Save number of phones and targets.
-		scen.phone_count  = phones.size();
+		scen.phone_count  = original_phones.size();
 		scen.target_count = sp_.map.monitor_points_.size();
 		scen.running_time = sp_.running_time;
 		
-		scen.adj_mats.Resize(sp_.running_time, sp_.phone_count, sp_.phone_count + sp_.map.monitor_points_.size());
-		scen.adj_mats.Fill(0);
-		scen.data_mats.Resize(sp_.running_time, sp_.phone_count, sp_.phone_count + sp_.map.monitor_points_.size());
-		scen.data_mats.Fill(0.0);
+		scen.contacts.Resize(sp_.running_time, sp_.phone_count, sp_.map.monitor_points_.size());
 		
 		// Initialize scen.phone_locations
-		for (int t = 0; t < sp_.running_time; ++t) {
-			std::vector<Point> loc_at_t;
-			for (int i = 0; i < sp_.phone_count; ++i) {
-				loc_at_t.push_back(Point());
-			}
-			scen.phone_locations.push_back(loc_at_t);
-		}
+		scen.phone_locations.Resize(sp_.running_time, sp_.phone_count);
+		
+		// Seconds [begins[i], ends[i]) phone i is active in.
+		std::vector<int> begins(sp_.phone_count, sp_.running_time);
+		std::vector<int> ends(sp_.phone_count, sp_.running_time);
 		
 		for (int t = start_time; t < sp_.running_time; ++t) {
-			log << "*** Time " << t << "***\n";
+			SIMLOG_TRACE(log) << "*** Time " << t << "***\n";
 			
 			// Enable phones if they start at this time.
 			for (int i = 0; i < start_phones[t].size(); ++i) {
 				int ph_id = start_phones[t][i];
-				log << "phone " << ph_id << " is enabled.\n";
-				phones[ph_id].is_active_ = true;
+				SIMLOG_TRACE(log) << "phone " << ph_id << " is enabled.\n";
+				engine.Activate(ph_id);
 			}
 			
 			// Record phone locations.
-			for (int i = 0; i < phones.size(); ++i) {
-				scen.phone_locations[t][i] = phones[i].GetLocation();
+			Point *locations = scen.phone_locations.MutableRow(t);
+			const char *active = engine.Active();
+			for (int i = 0; i < engine.PhoneCount(); ++i) {
+				locations[i] = engine.Location(i);
+				if (active[i] && begins[i] == sp_.running_time) {
+					begins[i] = t;
+				} else if (!active[i] && begins[i] < t && ends[i] == sp_.running_time) {
+					ends[i] = t;
+				}
 			}
 			
-			// Record meetups.
-			GenerateAdjacencyMatrix(phones, scen.adj_mats, scen.data_mats, t);
-			
 			// Move phones if they are active.
-			for (int i = 0; i < phones.size(); ++i) {
-				if (phones[i].is_active_) {
-					log << "phone "<< i << " is ready to move.\n";
-					phones[i].Move();
-				}
+			engine.Step();
+		}
+		
+		// Record meetups, found from the whole trajectories. Windows of
+		// seconds are independent and fill their own slices.
+		if (thread_count_ == 1) {
+			FindContacts(&scen.phone_locations, &begins, &ends, start_time, sp_.running_time, &scen.contacts);
+		} else {
+			if (!pool_) {
+				pool_.reset(new ThreadPool(thread_count_));
+			}
+			const int kWindowCount = std::min(pool_->ThreadCount() * kWindowsPerThread, sp_.running_time - start_time);
+			for (int w = 0; w < kWindowCount; ++w) {
+				const int kFirst = start_time + static_cast<long long>(sp_.running_time - start_time) * w / kWindowCount;
+				const int kEnd = start_time + static_cast<long long>(sp_.running_time - start_time) * (w + 1) / kWindowCount;
+				pool_->Submit(boost::bind(&ScenarioGenerator::FindContacts, this, &scen.phone_locations, &begins, &ends, kFirst, kEnd, &scen.contacts));
 			}
+			pool_->Wait();
 		}
 		
 		return scen;
 	}
 	
-	void ScenarioGenerator::GenerateAdjacencyMatrix(const std::vector<Phone>& phones, ThreeDimVector<int>& adj_mats, ThreeDimVector<double>& data_mats, const int time) const{
-		int row_size = phones.size() + sp_.map.monitor_points_.size();
-		
-		for (int i = 0; i < phones.size(); ++i) {
-			if (!phones[i].is_active_) {
-				// Phone i is not acive yet. All 0s for adj mat.
-				for (int j = 0; j < row_size; ++j) {
-					adj_mats(time, i, j) = 0;
-				}
+	void ScenarioGenerator::FindContacts(const TrajectoryTable* locations, const std::vector<int>* begins, const std::vector<int>* ends, int first_time, int end_time, ContactList* contacts) const {
+		ContactEngine engine(sp_.map.area_map_, sp_.map.monitor_points_, sp_.comm_range, sp_.sensing_range);
+		engine.Build(*locations, *begins, *ends, first_time, end_time);
+		engine.Fill(*contacts, sp_.data_per_second, 1);
+	}
+	
+	void ScenarioGenerator::GenerateAdjacencyMatrix(const std::vector<Phone>& phones, PhoneGrid& grid, ContactList& contacts, const int time) const{
+		const int kPhoneCount = phones.size();
+		std::vector<double> xs(kPhoneCount);
+		std::vector<double> ys(kPhoneCount);
+		std::vector<char> active(kPhoneCount);
+		for (int i = 0; i < kPhoneCount; ++i) {
+			xs[i] = phones[i].GetLocation().x;
+			ys[i] = phones[i].GetLocation().y;
+			active[i] = phones[i].is_active_;
+		}
+		GenerateAdjacencyMatrix(xs.data(), ys.data(), active.data(), kPhoneCount, grid, contacts, time);
+	}
+	
+	void ScenarioGenerator::GenerateAdjacencyMatrix(const MobilityEngine& engine, PhoneGrid& grid, ContactList& contacts, const int time) const{
+		GenerateAdjacencyMatrix(engine.Xs(), engine.Ys(), engine.Active(), engine.PhoneCount(), grid, contacts, time);
+	}
+	
+	void ScenarioGenerator::GenerateAdjacencyMatrix(const double* xs, const double* ys, const char* active, const int phone_count, PhoneGrid& grid, ContactList& contacts, const int time) const{
+		contacts.BeginSlice(time);
+		
+		// Find phone-phone meetups of all active phones.
+		grid.Build(xs, ys, active, phone_count);
+		
+		for (int i = 0; i < phone_count; ++i) {
+			if (!active[i]) {
+				// Phone i is not acive yet. No contacts.
 				continue;
 			}
 			
-			// Check phon-phone meetup.
-			long long comm_range_square = sp_.comm_range * sp_.comm_range;
-			for (int j = 0; j < phones.size(); ++j) {
-				if (phones[j].is_active_ && i != j && Point::DistanceSquare(phones[i].GetLocation(), phones[j].GetLocation()) <= comm_range_square) {
-					adj_mats(time, i, j) = 1;
-					data_mats(time, i, j) = sp_.data_per_second;
-				} else {
-					adj_mats(time, i, j) = 0;
-					data_mats(time, i, j) = 0.0;
-				}
+			// Record phon-phone meetup.
+			const std::vector<int> &neighbors = grid.Neighbors(i);
+			for (int k = 0; k < neighbors.size(); ++k) {
+				contacts.AddContact(time, i, neighbors[k], sp_.data_per_second);
 			}
 			
 			// Check phone-target meetup.
-			long long sensing_range_square = sp_.sensing_range * sp_.sensing_range;
-			const int kPhoneSize = phones.size();
-			for (int j = 0; j < sp_.map.monitor_points_.size(); ++j) {
-				if (Point::DistanceSquare(phones[i].GetLocation(), sp_.map.monitor_points_[j]) <= sensing_range_square) {
-					adj_mats(time, i, kPhoneSize + j) = 1;
-					data_mats(time, i, kPhoneSize + j) = 1; // Assume whenever phone pass target, it gets all the data.
-				} else {
-					adj_mats(time, i, kPhoneSize + j) = 0;
-					data_mats(time, i, kPhoneSize + j) = 0;
-				}
-			}
+			// Assume whenever phone pass target, it gets all the data.
+			sensing_.AddContacts(xs[i], ys[i], contacts, time, i, phone_count, 1);
 		}
+		
+		contacts.EndSlice(time);
 	}
 	
 	void ScenarioGenerator::WriteScenarioFile(const Scenario& scen, const std::string& outfile) const {
-		if (scen.adj_mats.Empty()) {
+		if (scen.contacts.Empty()) {
 			ErrorHandler::CodingError("Please generate scenario before writing to file!");
 			return;
 		}
@@ -211,12 +244,20 @@ namespace mobile_sensing_sim{
 		std::ofstream of(outfile.c_str());
 		of << scen.phone_count << endl;
 		of << scen.target_count << endl;
-		const ThreeDimVector<int> &ams = scen.adj_mats;
-		for (int t = 0; t < ams.DimOneSize(); ++t) {
+		const ContactList &contacts = scen.contacts;
+		for (int t = 0; t < contacts.TimeSize(); ++t) {
 			of << t << endl;
-			for (int i = 0; i < ams.DimTwoSize(); ++i) {
-				for (int j = 0; j < ams.DimThreeSize(); ++j) {
-					of << ams(t, i, j) << ' ';
+			const ContactSlice &slice = contacts.Slice(t);
+			for (int i = 0; i < contacts.PhoneCount(); ++i) {
+				// Expand the sparse row to a dense 0 / 1 row.
+				int k = slice.offsets[i];
+				for (int j = 0; j < contacts.ColumnSize(); ++j) {
+					if (k < slice.offsets[i + 1] && slice.ids[k] == j) {
+						of << 1 << ' ';
+						++k;
+					} else {
+						of << 0 << ' ';
+					}
 				}
 				of << endl;
 			}
@@ -10,10 +10,18 @@
 #define __MobileSensingSim__scenario_generator__
 
 #include <fstream>
+#include <boost/scoped_ptr.hpp>
 #include "phone.h"
 #include "monitor_map.h"
 #include "../error_handler.h"
 #include "multidim_vector.h"
+#include "contact_list.h"
+#include "trajectory_table.h"
+#include "phone_grid.h"
+#include "mobility_engine.h"
+#include "../thread_pool.h"
+#include "sensing_kernel.h"
+#include "contact_engine.h"
 
 namespace mobile_sensing_sim {
 	struct Range {
@@ -55,30 +63,48 @@ namespace mobile_sensing_sim {
 		int running_time;
 		std::vector<Phone> phones;
 		std::vector<std::vector<int> > start_phones;
-		std::vector<std::vector<Point> > phone_locations;
-		ThreeDimVector<int> adj_mats;
-		// AdjacencyMatrix over t:
+		TrajectoryTable phone_locations;
+		ContactList contacts;
+		// Contacts over t:
 		//   Rows: phone count, Cols: phone count + target count
-		//   Data on (i, j)  i and j are in comm / sensing range.
+		//   Contact (i, j) exists if i and j are in comm / sensing range.
 		//   (target if j >= phone count)
-		ThreeDimVector<double> data_mats;
-		// DataCapacityMatrix over t:
-		//   Rows: phone count, Cols: phone count
-		//   Data on (i, j) Percentage of data unit can be transferred
-		//   between i and j. (target if j >= phone count)
+		//   Its data is the percentage of data unit can be transferred
+		//   between i and j.
 	};
 	
 	class ScenarioGenerator {
 	public:
-		ScenarioGenerator (const ScenarioParameters& sp) : sp_(sp) {}
+		ScenarioGenerator (const ScenarioParameters& sp)
+		: sp_(sp), sensing_(sp.map.monitor_points_, static_cast<double>(sp.sensing_range) * sp.sensing_range), thread_count_(1) {}
+		// Threads finding contacts of a scenario once trajectories are
+		// known, each takes windows of seconds. 1 (the default) finds
+		// them on the calling thread, <= 0 uses all hardware threads.
+		// Contacts do not depend on it. Threads start with the first
+		// scenario and are kept for later ones.
+		void SetThreadCount(int thread_count) {
+			if (thread_count != thread_count_) {
+				pool_.reset();
+			}
+			thread_count_ = thread_count;
+		}
 		void WriteScenarioFile(const Scenario& scen, const std::string& outfile) const;
 		const Scenario GenerateScenario(const std::vector<Phone> &phones, const std::vector<std::vector<int> >& start_phones, int start_time = 0);
 		void GeneratePhones(std::vector<Phone>& original_phones, std::vector<std::vector<int> >& start_phones);
 		const Scenario GenerateDefaultScenario();
+		// Contacts of phones at their current locations into slice time.
+		void GenerateAdjacencyMatrix(const std::vector<Phone>& phones, PhoneGrid& grid, ContactList& contacts, int time) const;
+		void GenerateAdjacencyMatrix(const MobilityEngine& engine, PhoneGrid& grid, ContactList& contacts, int time) const;
 	private:
+		void GenerateAdjacencyMatrix(const double* xs, const double* ys, const char* active, int phone_count, PhoneGrid& grid, ContactList& contacts, int time) const;
+		// Fill slices [first_time, end_time) of contacts from the phone
+		// locations, phone i is active in [begins[i], ends[i]).
+		void FindContacts(const TrajectoryTable* locations, const std::vector<int>* begins, const std::vector<int>* ends, int first_time, int end_time, ContactList* contacts) const;
 		Phone::Directions GetDirection(const Point& entry_point) const;
-		void GenerateAdjacencyMatrix(const std::vector<Phone>& phones, ThreeDimVector<int>& adj_mats, ThreeDimVector<double>& data_mats, int time) const;
 		ScenarioParameters sp_;
+		SensingKernel sensing_; // Monitor points of sp_.
+		int thread_count_;
+		boost::scoped_ptr<ThreadPool> pool_; // NULL with one thread.
 	};
 }
 
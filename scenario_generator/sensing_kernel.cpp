@@ -0,0 +1,74 @@
+//
+//  sensing_kernel.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/24/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <limits>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "sensing_kernel.h"
+
+namespace mobile_sensing_sim {
+	namespace {
+#if defined(__AVX512F__)
+		const int kLanes = 8;
+#elif defined(__AVX2__)
+		const int kLanes = 4;
+#else
+		const int kLanes = 8; // Block size of the scalar loop.
+#endif
+
+		// Bit k is set if target first + k is in range.
+		unsigned int InRangeMask(const double* xs, const double* ys, double x, double y, double range_square) {
+#if defined(__AVX512F__)
+			const __m512d kDx = _mm512_sub_pd(_mm512_set1_pd(x), _mm512_loadu_pd(xs));
+			const __m512d kDy = _mm512_sub_pd(_mm512_set1_pd(y), _mm512_loadu_pd(ys));
+			const __m512d kDist = _mm512_add_pd(_mm512_mul_pd(kDx, kDx), _mm512_mul_pd(kDy, kDy));
+			return _mm512_cmp_pd_mask(kDist, _mm512_set1_pd(range_square), _CMP_LE_OQ);
+#elif defined(__AVX2__)
+			const __m256d kDx = _mm256_sub_pd(_mm256_set1_pd(x), _mm256_loadu_pd(xs));
+			const __m256d kDy = _mm256_sub_pd(_mm256_set1_pd(y), _mm256_loadu_pd(ys));
+			const __m256d kDist = _mm256_add_pd(_mm256_mul_pd(kDx, kDx), _mm256_mul_pd(kDy, kDy));
+			return _mm256_movemask_pd(_mm256_cmp_pd(kDist, _mm256_set1_pd(range_square), _CMP_LE_OQ));
+#else
+			unsigned int mask = 0;
+			for (int k = 0; k < kLanes; ++k) {
+				const double kDx = x - xs[k];
+				const double kDy = y - ys[k];
+				mask |= static_cast<unsigned int>(kDx * kDx + kDy * kDy <= range_square) << k;
+			}
+			return mask;
+#endif
+		}
+	}
+
+	SensingKernel::SensingKernel(const std::vector<Point>& targets, double range_square) : target_count_(targets.size()), range_square_(range_square) {
+		// Padding is never in range.
+		const int kPadded = (target_count_ + kLanes - 1) / kLanes * kLanes;
+		xs_.assign(kPadded, std::numeric_limits<double>::infinity());
+		ys_.assign(kPadded, std::numeric_limits<double>::infinity());
+		for (int j = 0; j < target_count_; ++j) {
+			xs_[j] = targets[j].x;
+			ys_[j] = targets[j].y;
+		}
+	}
+
+	void SensingKernel::AddContacts(double x, double y, ContactList& contacts, int time, int row, int first_column, double data) const {
+		for (int j = 0; j < xs_.size(); j += kLanes) {
+			const unsigned int kMask = InRangeMask(&xs_[j], &ys_[j], x, y, range_square_);
+			// Usually no target is in range.
+			if (kMask == 0) {
+				continue;
+			}
+			for (int k = 0; k < kLanes; ++k) {
+				if (kMask >> k & 1) {
+					contacts.AddContact(time, row, first_column + j + k, data);
+				}
+			}
+		}
+	}
+}
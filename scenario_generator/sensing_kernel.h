@@ -0,0 +1,41 @@
+//
+//  sensing_kernel.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/24/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__sensing_kernel__
+#define __PhoneSim__sensing_kernel__
+
+#include <vector>
+#include "area_map.h"
+#include "contact_list.h"
+
+namespace mobile_sensing_sim {
+	// Tests a phone against all monitor points at once. Targets are
+	// kept as x and y arrays padded to whole vectors, the test uses
+	// AVX-512 or AVX2 when the build targets them (e.g. -march=native)
+	// and a scalar loop otherwise. Distances are computed as in
+	// Point::DistanceSquare, so all variants find the same targets.
+	class SensingKernel {
+	public:
+		SensingKernel(const std::vector<Point>& targets, double range_square);
+
+		// Add a contact (row, first_column + j) with data to slice time
+		// for every target j within range of (x, y), in order of j.
+		void AddContacts(double x, double y, ContactList& contacts, int time, int row, int first_column, double data) const;
+
+		int TargetCount() const {
+			return target_count_;
+		}
+	private:
+		int target_count_;
+		double range_square_;
+		std::vector<double> xs_; // Padded with infinity.
+		std::vector<double> ys_;
+	};
+}
+
+#endif /* defined(__PhoneSim__sensing_kernel__) */
@@ -0,0 +1,98 @@
+//
+//  trajectory_table.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/21/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef PhoneSim_trajectory_table_h
+#define PhoneSim_trajectory_table_h
+
+#include <vector>
+#include <cassert>
+#include <boost/shared_ptr.hpp>
+#include "area_map.h"
+
+namespace mobile_sensing_sim {
+	// Phone locations over time in one time major array,
+	// table[t][i] is the location of phone i at second t.
+	// Like ContactList it either owns the array or views the
+	// read-only array of a mapped scenario file, which is
+	// copied on the first change.
+	class TrajectoryTable {
+	public:
+		TrajectoryTable() : time_size_(0), phone_count_(0), points_(NULL) {}
+		TrajectoryTable(const TrajectoryTable& other) {
+			*this = other;
+		}
+
+		TrajectoryTable& operator=(const TrajectoryTable& other) {
+			time_size_ = other.time_size_;
+			phone_count_ = other.phone_count_;
+			owned_ = other.owned_;
+			storage_ = other.storage_;
+			points_ = storage_ ? other.points_ : Owned();
+			return *this;
+		}
+
+		// Resize, all locations are reset to Point().
+		void Resize(int running_time, int phone_count) {
+			time_size_ = running_time;
+			phone_count_ = phone_count;
+			owned_.assign(static_cast<std::size_t>(running_time) * phone_count, Point());
+			storage_.reset();
+			points_ = Owned();
+		}
+
+		// View points, kept alive by storage.
+		void Map(const Point* points, int running_time, int phone_count, const boost::shared_ptr<const void>& storage) {
+			time_size_ = running_time;
+			phone_count_ = phone_count;
+			owned_.clear();
+			storage_ = storage;
+			points_ = points;
+		}
+
+		int TimeSize() const {
+			return time_size_;
+		}
+
+		int PhoneCount() const {
+			return phone_count_;
+		}
+
+		// Locations of all phones at second time.
+		const Point* operator[](int time) const {
+			assert(time < time_size_);
+			return points_ + static_cast<std::size_t>(time) * phone_count_;
+		}
+
+		Point* MutableRow(int time) {
+			assert(time < time_size_);
+			if (storage_) {
+				owned_.assign(points_, points_ + static_cast<std::size_t>(time_size_) * phone_count_);
+				storage_.reset();
+				points_ = Owned();
+			}
+			return &owned_[0] + static_cast<std::size_t>(time) * phone_count_;
+		}
+
+		// Whole table, time major.
+		const Point* Data() const {
+			return points_;
+		}
+	private:
+		const Point* Owned() const {
+			return owned_.empty() ? NULL : &owned_[0];
+		}
+
+		int time_size_;
+		int phone_count_;
+		std::vector<Point> owned_;
+		boost::shared_ptr<const void> storage_;
+		const Point* points_; // owned_ or an array of storage_.
+	};
+}
+
+#endif
@@ -6,11 +6,232 @@
 //  Copyright (c) 2014 Yuan. All rights reserved.
 //
 
+#include <deque>
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
 #include "simlog.h"
 
 namespace mobile_sensing_sim {
+  namespace {
+    typedef boost::shared_ptr<std::ofstream> StreamPtr;
+    
+    // Background thread doing all file operations of the logs in
+    // the order they were requested.
+    class LogWriter {
+    public:
+      static LogWriter& Instance() {
+        static LogWriter writer;
+        return writer;
+      }
+      
+      void Write(const StreamPtr& of, const std::string& text) {
+        Push(Request(Request::WRITE, of, text));
+      }
+      
+      void Truncate(const StreamPtr& of, const std::string& file_name) {
+        Push(Request(Request::TRUNCATE, of, file_name));
+      }
+      
+      void Close(const StreamPtr& of) {
+        Push(Request(Request::CLOSE, of, ""));
+      }
+      
+      // Block until every request so far is done.
+      void Sync() {
+        boost::mutex::scoped_lock lock(mutex_);
+        while (!requests_.empty() || busy_) {
+          idle_cond_.wait(lock);
+        }
+      }
+      
+      ~LogWriter() {
+        {
+          boost::mutex::scoped_lock lock(mutex_);
+          stop_ = true;
+        }
+        request_cond_.notify_one();
+        thread_.join();
+      }
+    private:
+      struct Request {
+        enum Type {
+          WRITE,
+          TRUNCATE,
+          CLOSE
+        };
+        Request(Type t, const StreamPtr& o, const std::string& s) : type(t), of(o), text(s) {}
+        Type type;
+        StreamPtr of;
+        std::string text; // Text to write or file name to reopen.
+      };
+      
+      LogWriter() : busy_(false), stop_(false) {
+        thread_ = boost::thread(boost::bind(&LogWriter::Run, this));
+      }
+      
+      void Push(const Request& r) {
+        {
+          boost::mutex::scoped_lock lock(mutex_);
+          requests_.push_back(r);
+        }
+        request_cond_.notify_one();
+      }
+      
+      void Run() {
+        std::vector<StreamPtr> touched;
+        boost::mutex::scoped_lock lock(mutex_);
+        for (;;) {
+          while (requests_.empty() && !stop_) {
+            // Queue drained, make the files current before sleeping.
+            if (!touched.empty()) {
+              lock.unlock();
+              for (int i = 0; i < touched.size(); ++i) {
+                touched[i]->flush();
+              }
+              touched.clear();
+              lock.lock();
+              continue;
+            }
+            busy_ = false;
+            idle_cond_.notify_all();
+            request_cond_.wait(lock);
+          }
+          if (requests_.empty()) {
+            break;
+          }
+          busy_ = true;
+          Request r = requests_.front();
+          requests_.pop_front();
+          lock.unlock();
+          
+          std::ofstream &of = *r.of;
+          if (r.type == Request::WRITE) {
+            of.write(r.text.data(), r.text.size());
+            touched.push_back(r.of);
+          } else if (r.type == Request::TRUNCATE) {
+            of.close();
+            of.open(r.text.c_str(), std::fstream::out | std::fstream::trunc);
+          } else {
+            of.close();
+          }
+          
+          lock.lock();
+        }
+        for (int i = 0; i < touched.size(); ++i) {
+          touched[i]->flush();
+        }
+        busy_ = false;
+        idle_cond_.notify_all();
+      }
+      
+      std::deque<Request> requests_;
+      boost::mutex mutex_;
+      boost::condition_variable request_cond_;
+      boost::condition_variable idle_cond_;
+      bool busy_;
+      bool stop_;
+      boost::thread thread_;
+    };
+  }
+  
   bool SimLog::IsLog = true;
   
+  SimLog::SimLog(const std::string& filename) : level_(LEVEL_TRACE) {
+    // Construct the writer first so it outlives every global log.
+    LogWriter::Instance();
+    Registry().push_back(this);
+    sink_.file_name = filename;
+  }
+  
+  SimLog::~SimLog() {
+    if (sink_.of) {
+      Flush(sink_);
+      LogWriter::Instance().Close(sink_.of);
+    }
+  }
+  
+  void SimLog::Close() {
+    Sink &sink = CurrentSink();
+    if (sink.of) {
+      Flush(sink);
+      LogWriter::Instance().Close(sink.of);
+    }
+  }
+  
+  void SimLog::Reset() {
+    Sink &sink = CurrentSink();
+    if (sink.of) {
+      sink.buffer.str("");
+      LogWriter::Instance().Truncate(sink.of, sink.file_name);
+    } else if (IsLog) {
+      Open(sink, sink.file_name);
+    }
+  }
+  
+  void SimLog::Flush() {
+    Flush(CurrentSink());
+    LogWriter::Instance().Sync();
+  }
+  
+  std::vector<SimLog*>& SimLog::Registry() {
+    static std::vector<SimLog*> logs;
+    return logs;
+  }
+  
+  void SimLog::Open(Sink& sink, const std::string& filename) {
+    sink.file_name = filename;
+    sink.of.reset(new std::ofstream(filename.c_str(), std::fstream::out | std::fstream::trunc));
+    sink.buffer.setf(std::ios::fixed, std::ios::floatfield);
+    sink.buffer.precision(1);
+  }
+  
+  void SimLog::Flush(Sink& sink) {
+    if (!sink.of || sink.buffer.tellp() <= 0) {
+      return;
+    }
+    LogWriter::Instance().Write(sink.of, sink.buffer.str());
+    sink.buffer.str("");
+  }
+  
+  void SimLog::SetLevels(Level level) {
+    std::vector<SimLog*> &logs = Registry();
+    for (int i = 0; i < logs.size(); ++i) {
+      logs[i]->SetLevel(level);
+    }
+  }
+  
+  void SimLog::BindThread(const std::string& tag) {
+    if (!IsLog) {
+      return;
+    }
+    std::vector<SimLog*> &logs = Registry();
+    for (int i = 0; i < logs.size(); ++i) {
+      const std::string &name = logs[i]->sink_.file_name;
+      std::string::size_type dot = name.rfind('.');
+      std::string::size_type slash = name.rfind('/');
+      // Opened by the first write or Reset, like the global sinks.
+      Sink *sink = new Sink();
+      if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        sink->file_name = name + "." + tag;
+      } else {
+        sink->file_name = name.substr(0, dot) + "." + tag + name.substr(dot);
+      }
+      logs[i]->thread_sink_.reset(sink);
+    }
+  }
+  
+  void SimLog::UnbindThread() {
+    std::vector<SimLog*> &logs = Registry();
+    for (int i = 0; i < logs.size(); ++i) {
+      Sink *sink = logs[i]->thread_sink_.get();
+      if (sink != NULL && sink->of) {
+        Flush(*sink);
+        LogWriter::Instance().Close(sink->of);
+      }
+      logs[i]->thread_sink_.reset();
+    }
+  }
+  
   SimLog log("./sim_log.txt");
   SimLog hlog("./heur_log.txt");
   SimLog hdlog("./heur_dyn_log.txt");
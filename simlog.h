@@ -10,49 +10,122 @@
 #define __MobileSensingSim__simlog__
 
 #include <string>
+#include <vector>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/tss.hpp>
 
 namespace mobile_sensing_sim {
+  // Buffered log channel. Text is formatted into a memory buffer and
+  // handed to a background writer thread once the buffer is full, so
+  // logging never waits for the disk. The file is created by the first
+  // write or Reset, so clearing IsLog at the start of main keeps every
+  // channel from touching its file.
   class SimLog {
   public:
-    template <typename T>
-    SimLog& operator << (const T& data) {
-      if (!IsLog) {
+    enum Level {
+      LEVEL_ERROR = 0,
+      LEVEL_WARNING,
+      LEVEL_INFO, // Level of plain << writes.
+      LEVEL_DEBUG,
+      LEVEL_TRACE // Per phone / per edge details in hot paths.
+    };
+    
+    // Writes of one statement at its level, see SIMLOG.
+    class LevelStream {
+    public:
+      LevelStream(SimLog& log, Level level) : log_(log), level_(level) {}
+      template <typename T>
+      LevelStream& operator << (const T& data) {
+        log_.Write(level_, data);
         return *this;
       }
-      of_ << data;
-      of_.flush();
-      return *this;
-    }
+    private:
+      SimLog& log_;
+      Level level_;
+    };
     
-    ~SimLog(){
-      of_.close();
+    template <typename T>
+    SimLog& operator << (const T& data) {
+      Write(LEVEL_INFO, data);
+      return *this;
     }
     
-    void Close() {
-      of_.close();
+    LevelStream At(Level level) {
+      return LevelStream(*this, level);
     }
     
-    SimLog(const std::string& filename) {
-      if(!IsLog) {
+    template <typename T>
+    void Write(Level level, const T& data) {
+      if (!Enabled(level)) {
         return;
       }
-      file_name_ = filename;
-      of_.open(filename.c_str(), std::fstream::out | std::fstream::trunc);
-      of_.setf(std::ios::fixed, std::ios::floatfield);
-      of_.precision(1);
+      Sink &sink = CurrentSink();
+      if (!sink.of) {
+        Open(sink, sink.file_name);
+      }
+      sink.buffer << data;
+      if (sink.buffer.tellp() >= kBufferSize) {
+        Flush(sink);
+      }
     }
     
-    void Reset() {
-      of_.close();
-      of_.open(file_name_.c_str(), std::fstream::trunc);
+    ~SimLog();
+    
+    // Write out buffered text and close the file.
+    void Close();
+    
+    SimLog(const std::string& filename);
+    
+    // Drop everything written so far and start an empty file.
+    void Reset();
+    
+    // Hand buffered text to the writer and wait until it is on disk.
+    void Flush();
+    
+    void SetLevel(Level level) {
+      level_ = level;
+    }
+    // Level of every channel, call before logging starts.
+    static void SetLevels(Level level);
+    Level GetLevel() const {
+      return level_;
     }
+    bool Enabled(Level level) const {
+      return IsLog && level <= level_;
+    }
+    
+    // Redirect all logs written by the calling thread to files
+    // named after the original ones plus tag, e.g.
+    // "./sim_log.txt" -> "./sim_log.n50_s0.txt". A job only creates
+    // the files of the channels it writes to.
+    static void BindThread(const std::string& tag);
+    static void UnbindThread();
     
     static bool IsLog;
   private:
-    std::ofstream of_;
-    std::string file_name_;
+    static const int kBufferSize = 1 << 16;
+    
+    struct Sink {
+      boost::shared_ptr<std::ofstream> of;
+      std::string file_name;
+      std::ostringstream buffer;
+    };
+    
+    static std::vector<SimLog*>& Registry();
+    static void Open(Sink& sink, const std::string& filename);
+    static void Flush(Sink& sink);
+    
+    Sink& CurrentSink() {
+      Sink *sink = thread_sink_.get();
+      return sink == NULL ? sink_ : *sink;
+    }
+    
+    Level level_;
+    Sink sink_;
+    boost::thread_specific_ptr<Sink> thread_sink_;
   };
   
   // Create global log
@@ -65,4 +138,19 @@ namespace mobile_sensing_sim {
   extern SimLog oblog; // optimal balance algorithm log.
 }
 
+// Log statement of the given level, arguments are not evaluated
+// when the level is filtered out:
+//   SIMLOG(hlog, LEVEL_DEBUG) << "value: " << v << "\n";
+#define SIMLOG(channel, level) \
+  if (!(channel).Enabled(mobile_sensing_sim::SimLog::level)) ; else (channel).At(mobile_sensing_sim::SimLog::level)
+
+// Trace statements of hot paths (Phone::Move, scenario generation,
+// per edge solution dumps). They are compiled out completely unless
+// PHONESIM_TRACE_LOG is defined.
+#ifdef PHONESIM_TRACE_LOG
+#define SIMLOG_TRACE(channel) SIMLOG(channel, LEVEL_TRACE)
+#else
+#define SIMLOG_TRACE(channel) if (true) ; else (channel).At(mobile_sensing_sim::SimLog::LEVEL_TRACE)
+#endif
+
 #endif /* defined(__MobileSensingSim__simlog__) */
@@ -11,6 +11,7 @@
 
 #include "scenario_generator/scenario_generator.h"
 #include "milp_base.h"
+#include "optimal_solver/flow_adapter_factory.h"
 
 namespace mobile_sensing_sim {
   struct Cost {
@@ -20,8 +21,10 @@ namespace mobile_sensing_sim {
       UPLOAD
     };
     
-    Cost() : costs_(3) {
-      std::fill(costs_.begin(), costs_.end(), 0.0);
+    static const int kTypeCount = 3;
+    
+    Cost() {
+      std::fill(costs_, costs_ + kTypeCount, 0.0);
     }
     double& operator[](CostType ctype) {
       return costs_[static_cast<int>(ctype)];
@@ -30,17 +33,18 @@ namespace mobile_sensing_sim {
       return costs_[static_cast<int>(ctype)];
     }
   private:
-    std::vector<double> costs_;
+    double costs_[kTypeCount]; // Inline, so phone costs need no allocations.
   };
   
   struct Result {
-    Result(const int phone_count) : phone_cost(phone_count), is_valid(false), all_cost(0.0), solution_status(-1), is_optimal(false){}
+    Result(const int phone_count) : phone_cost(phone_count), is_valid(false), all_cost(0.0), solution_status(-1), is_optimal(false), solve_seconds(0.0){}
     std::vector<Cost> phone_cost;
     Cost total_cost;
     double all_cost;
     bool is_valid;
     int solution_status;
     bool is_optimal;
+    double solve_seconds; // Wall time of Solve, set by SweepRunner.
     void AddCost(const int phoneid, const double cost, Cost::CostType ctype) {
       total_cost[ctype] += cost;
       assert(phoneid < phone_cost.size());
@@ -67,7 +71,41 @@ namespace mobile_sensing_sim {
   
   class SolverBase : public MilpBase {
   public:
+    SolverBase() : flow_engine_(FlowAdapterFactory::DefaultEngine()), flow_thread_count_(0), graph_thread_count_(1) {}
+    virtual ~SolverBase() {}
     virtual Result Solve(const Scenario& scen) = 0;
+    
+    // Engine used for min cost flow problems. Solvers which do not
+    // build flow graphs ignore it.
+    void SetFlowEngine(FlowEngine engine) {
+      flow_engine_ = engine;
+    }
+    FlowEngine GetFlowEngine() const {
+      return flow_engine_;
+    }
+    
+    // Threads of flow engines solving in parallel, <= 0 (the
+    // default) uses all hardware threads.
+    void SetFlowThreadCount(int thread_count) {
+      flow_thread_count_ = thread_count;
+    }
+    int GetFlowThreadCount() const {
+      return flow_thread_count_;
+    }
+    
+    // Threads converting scenarios to flow graphs, see
+    // GraphConverter::SetThreadCount. 1 (the default) converts on the
+    // calling thread.
+    void SetGraphThreadCount(int thread_count) {
+      graph_thread_count_ = thread_count;
+    }
+    int GetGraphThreadCount() const {
+      return graph_thread_count_;
+    }
+  private:
+    FlowEngine flow_engine_;
+    int flow_thread_count_;
+    int graph_thread_count_;
   };
 }
 
@@ -0,0 +1,210 @@
+//
+//  stat.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/25/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <algorithm>
+#include <boost/math/constants/constants.hpp>
+#include <boost/math/distributions/students_t.hpp>
+#include "error_handler.h"
+#include "stat.h"
+
+namespace mobile_sensing_sim {
+  namespace {
+    // Buffered values per unit of compression before they are merged.
+    const int kBufferFactor = 5;
+
+    // Scale function k1 of the t-digest, centroids may span one unit
+    // of it. It is flat near the middle and steep at the tails, so
+    // centroids near the extreme quantiles stay small.
+    double ToScale(double q, int compression) {
+      return compression / (2 * boost::math::constants::pi<double>()) * std::asin(2 * q - 1);
+    }
+
+    double FromScale(double k, int compression) {
+      return (std::sin(k * 2 * boost::math::constants::pi<double>() / compression) + 1) / 2;
+    }
+  }
+
+  Statistics::Statistics(int compression) : compression_(compression) {
+    if (compression_ <= 0) {
+      ErrorHandler::CodingError("Statistics compression must be positive.");
+    }
+    Clear();
+  }
+
+  void Statistics::AddValue(double val) {
+    ++count_;
+    const double kDelta = val - mean_;
+    mean_ += kDelta / count_;
+    m2_ += kDelta * (val - mean_);
+    min_ = std::min(min_, val);
+    max_ = std::max(max_, val);
+
+    Centroid c = {val, 1};
+    buffer_.push_back(c);
+    if (buffer_.size() >= kBufferFactor * compression_) {
+      Compress();
+    }
+  }
+
+  void Statistics::Merge(const Statistics& other) {
+    if (other.count_ == 0) {
+      return;
+    }
+    if (&other == this) {
+      // Values are inserted into the buffer being read otherwise.
+      const Statistics kCopy(other);
+      Merge(kCopy);
+      return;
+    }
+    if (count_ == 0) {
+      min_ = other.min_;
+      max_ = other.max_;
+    } else {
+      min_ = std::min(min_, other.min_);
+      max_ = std::max(max_, other.max_);
+    }
+
+    // Chan et al., combine the two sets' means and squared distances.
+    const double kCount = static_cast<double>(count_) + other.count_;
+    const double kDelta = other.mean_ - mean_;
+    mean_ += kDelta * other.count_ / kCount;
+    m2_ += other.m2_ + kDelta * kDelta * count_ * (other.count_ / kCount);
+    count_ += other.count_;
+
+    buffer_.insert(buffer_.end(), other.centroids_.begin(), other.centroids_.end());
+    buffer_.insert(buffer_.end(), other.buffer_.begin(), other.buffer_.end());
+    Compress();
+  }
+
+  void Statistics::Clear() {
+    count_ = 0;
+    mean_ = 0;
+    m2_ = 0;
+    min_ = HUGE_VAL;
+    max_ = -HUGE_VAL;
+    centroids_.clear();
+    buffer_.clear();
+  }
+
+  double Statistics::StandardDeviation() const {
+    return std::sqrt(Variance());
+  }
+
+  void Statistics::Compress() const {
+    if (buffer_.empty()) {
+      return;
+    }
+    buffer_.insert(buffer_.end(), centroids_.begin(), centroids_.end());
+    std::sort(buffer_.begin(), buffer_.end());
+    double total = 0;
+    for (int i = 0; i < buffer_.size(); ++i) {
+      total += buffer_[i].weight;
+    }
+
+    // Walk in order of mean and grow a centroid while its weight stays
+    // within one unit of the scale.
+    centroids_.clear();
+    Centroid cur = buffer_[0];
+    double weight_before = 0;
+    double limit = total * FromScale(ToScale(0, compression_) + 1, compression_);
+    for (int i = 1; i < buffer_.size(); ++i) {
+      const Centroid &c = buffer_[i];
+      if (weight_before + cur.weight + c.weight <= limit) {
+        cur.weight += c.weight;
+        cur.mean += (c.mean - cur.mean) * c.weight / cur.weight;
+      } else {
+        weight_before += cur.weight;
+        centroids_.push_back(cur);
+        limit = total * FromScale(ToScale(weight_before / total, compression_) + 1, compression_);
+        cur = c;
+      }
+    }
+    centroids_.push_back(cur);
+    buffer_.clear();
+  }
+
+  double Statistics::Quantile(double q) const {
+    if (count_ == 0) {
+      return 0.0;
+    }
+    Compress();
+    q = std::min(std::max(q, 0.0), 1.0);
+
+    // Each centroid's weight is spread around its mean, interpolate
+    // between the centers and towards min / max at the ends.
+    double total = 0;
+    for (int i = 0; i < centroids_.size(); ++i) {
+      total += centroids_[i].weight;
+    }
+    const double kIndex = q * total;
+    const Centroid &first = centroids_.front();
+    const Centroid &last = centroids_.back();
+    if (kIndex < first.weight / 2) {
+      return min_ + (first.mean - min_) * kIndex / (first.weight / 2);
+    }
+    if (kIndex > total - last.weight / 2) {
+      return last.mean + (max_ - last.mean) * (kIndex - (total - last.weight / 2)) / (last.weight / 2);
+    }
+
+    double center = first.weight / 2;
+    for (int i = 0; i + 1 < centroids_.size(); ++i) {
+      const double kNextCenter = center + (centroids_[i].weight + centroids_[i + 1].weight) / 2;
+      if (kIndex <= kNextCenter) {
+        return centroids_[i].mean + (centroids_[i + 1].mean - centroids_[i].mean) * (kIndex - center) / (kNextCenter - center);
+      }
+      center = kNextCenter;
+    }
+    return last.mean;
+  }
+
+  double Statistics::ConfidenceInterval(double level) const {
+    if (count_ < 2) {
+      return 0.0;
+    }
+    const boost::math::students_t dist(static_cast<double>(count_ - 1));
+    const double kT = boost::math::quantile(boost::math::complement(dist, (1 - level) / 2));
+    return kT * std::sqrt(SampleVariance() / count_);
+  }
+
+  void Statistics::Save(std::ostream& os) const {
+    Compress();
+    const std::streamsize kPrecision = os.precision(17);
+    os << compression_ << " " << count_ << " " << mean_ << " " << m2_ << " " << Min() << " " << Max() << " " << centroids_.size();
+    for (int i = 0; i < centroids_.size(); ++i) {
+      os << " " << centroids_[i].mean << " " << centroids_[i].weight;
+    }
+    os << std::endl;
+    os.precision(kPrecision);
+  }
+
+  bool Statistics::Load(std::istream& is) {
+    Statistics st;
+    int centroid_count = 0;
+    is >> st.compression_ >> st.count_ >> st.mean_ >> st.m2_ >> st.min_ >> st.max_ >> centroid_count;
+    if (!is || st.compression_ <= 0 || st.count_ < 0 || centroid_count < 0) {
+      ErrorHandler::RunningWarning("Statistics::Load: bad header.");
+      return false;
+    }
+    if (st.count_ == 0) {
+      st.min_ = HUGE_VAL;
+      st.max_ = -HUGE_VAL;
+    }
+    st.centroids_.resize(centroid_count);
+    for (int i = 0; i < centroid_count; ++i) {
+      is >> st.centroids_[i].mean >> st.centroids_[i].weight;
+    }
+    if (!is) {
+      ErrorHandler::RunningWarning("Statistics::Load: truncated centroids.");
+      return false;
+    }
+
+    *this = st;
+    return true;
+  }
+}
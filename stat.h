@@ -10,46 +10,68 @@
 #define MobileSensingSim_stat_h
 
 #include <vector>
-#include <numeric>
+#include <iostream>
 
 namespace mobile_sensing_sim {
+  // Summary of a stream of values in constant memory. Mean and variance
+  // are updated with Welford's method, quantiles are estimated with a
+  // merging t-digest. Accumulators filled by different threads, or saved
+  // by different processes, can be merged into one.
+  //
+  // Quantile compacts the digest, so even const calls must not run
+  // concurrently on one object.
   class Statistics {
   public:
-    void AddValue(double val) { v_.push_back(val); }
-    void Clear() { v_.clear(); }
-    double Mean() const {
-      if (v_.empty()) {
-        return 0.0;
-      }
-      double sum = std::accumulate(v_.begin(), v_.end(), 0.0);
-      return sum / v_.size();
-    }
-    
-    double Max() const {
-      std::vector<double>::const_iterator cit = std::max_element(v_.begin(), v_.end());
-      if (cit != v_.end()) {
-        return *cit;
-      }
-      
-      return 0.0;
-    }
-    
-    double Min() const {
-      std::vector<double>::const_iterator cit = std::min_element(v_.begin(), v_.end());
-      if (cit != v_.end()) {
-        return *cit;
-      }
-      
-      return 0.0;
-    }
-    
-    double Variance() const {
-      double sq_sum = std::inner_product(v_.begin(), v_.end(), v_.begin(), 0.0);
-      double mean = Mean();
-      return sq_sum / v_.size() - mean * mean;
-    }
+    // Higher compression keeps more centroids and gives finer quantiles.
+    static const int kDefaultCompression = 100;
+
+    explicit Statistics(int compression = kDefaultCompression);
+
+    void AddValue(double val);
+    // Add all values of other, as if they were added to this one.
+    void Merge(const Statistics& other);
+    void Clear();
+
+    long long Size() const { return count_; }
+    // The following return 0 when there are no values.
+    double Mean() const { return mean_; }
+    double Max() const { return count_ > 0 ? max_ : 0.0; }
+    double Min() const { return count_ > 0 ? min_ : 0.0; }
+    // Population variance.
+    double Variance() const { return count_ > 0 ? m2_ / count_ : 0.0; }
+    // Unbiased estimate, divided by n - 1.
+    double SampleVariance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0.0; }
+    double StandardDeviation() const;
+
+    // Estimated value below which a fraction q of the values lie.
+    double Quantile(double q) const;
+    double Median() const { return Quantile(0.5); }
+
+    // Half width of the Student's t confidence interval of the mean at
+    // level, e.g. 0.95. 0 with less than two values.
+    double ConfidenceInterval(double level = 0.95) const;
+
+    // Text form for merging results of separate runs.
+    void Save(std::ostream& os) const;
+    bool Load(std::istream& is);
   private:
-    std::vector<double> v_;
+    struct Centroid {
+      double mean;
+      double weight;
+      bool operator<(const Centroid& rhs) const { return mean < rhs.mean; }
+    };
+
+    // Merge buffered values into the centroids.
+    void Compress() const;
+
+    int compression_;
+    long long count_;
+    double mean_;
+    double m2_; // Sum of squared distances to the mean.
+    double min_;
+    double max_;
+    mutable std::vector<Centroid> centroids_; // Sorted by mean.
+    mutable std::vector<Centroid> buffer_; // Not merged yet.
   };
 }
 
@@ -0,0 +1,94 @@
+//
+//  sweep_runner.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/16/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <boost/bind/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include "sweep_runner.h"
+#include "simlog.h"
+
+namespace mobile_sensing_sim {
+  namespace {
+    std::string JobTag(int phone_count, int seed) {
+      return "n" + boost::lexical_cast<std::string>(phone_count) + "_s" + boost::lexical_cast<std::string>(seed);
+    }
+  }
+  
+  void SweepRunner::Run(const std::vector<int>& phone_counts, int scenario_number, SweepResults& results) {
+    const int kPhoneCountsSize = phone_counts.size();
+    
+    std::vector<std::string> solver_names;
+    factory_(-1, solver_names);
+    const int kSolverCount = solver_names.size();
+    
+    // Generate all scenarios. Phones keep pointing to the map of their
+    // generator or cache file, so both live as long as the scenarios.
+    std::vector<std::vector<Scenario> > scens(kPhoneCountsSize, std::vector<Scenario>(scenario_number));
+    std::vector<std::vector<GeneratorPtr> > generators(kPhoneCountsSize, std::vector<GeneratorPtr>(scenario_number));
+    std::vector<std::vector<ScenarioFilePtr> > files(kPhoneCountsSize, std::vector<ScenarioFilePtr>(scenario_number));
+    for (int i = 0; i < kPhoneCountsSize; ++i) {
+      for (int sid = 0; sid < scenario_number; ++sid) {
+        pool_.Submit(boost::bind(&SweepRunner::GenerateJob, this, phone_counts[i], sid, &generators[i][sid], &files[i][sid], &scens[i][sid]));
+      }
+    }
+    pool_.Wait();
+    
+    // Solve them. Slots are preallocated so jobs never touch shared containers.
+    results.assign(kPhoneCountsSize, std::vector<std::vector<Result> >());
+    for (int i = 0; i < kPhoneCountsSize; ++i) {
+      results[i].assign(scenario_number, std::vector<Result>(kSolverCount, Result(phone_counts[i])));
+      for (int sid = 0; sid < scenario_number; ++sid) {
+        for (int j = 0; j < kSolverCount; ++j) {
+          pool_.Submit(boost::bind(&SweepRunner::SolveJob, this, &scens[i][sid], j, &results[i][sid][j]));
+        }
+      }
+    }
+    pool_.Wait();
+  }
+  
+  void SweepRunner::GenerateJob(int phone_count, int seed, GeneratorPtr *sg, ScenarioFilePtr *file, Scenario *scen) {
+    SimLog::BindThread(JobTag(phone_count, seed));
+    
+    ScenarioParameters sp = sp_;
+    sp.phone_count = phone_count;
+    sp.seed = seed;
+    if (cache_) {
+      *file = cache_->Load(sp);
+    }
+    if (*file) {
+      // Copies views of the mapped file.
+      *scen = (*file)->GetScenario();
+    } else {
+      sg->reset(new ScenarioGenerator(sp));
+      (*sg)->SetThreadCount(scenario_thread_count_);
+      *scen = (*sg)->GenerateDefaultScenario();
+      if (cache_) {
+        cache_->Store(sp, *scen);
+      }
+    }
+    
+    SimLog::UnbindThread();
+  }
+  
+  void SweepRunner::SolveJob(const Scenario *scen, int solver_id, Result *res) {
+    std::vector<std::string> solver_names;
+    SolverPtr solver = factory_(solver_id, solver_names);
+    
+    SimLog::BindThread(JobTag(scen->phone_count, scen->scen_param.seed) + "_a" + boost::lexical_cast<std::string>(solver_id));
+    
+    solver->SetMILP(use_milp_);
+    solver->SetFlowEngine(flow_engine_);
+    solver->SetFlowThreadCount(flow_thread_count_);
+    solver->SetGraphThreadCount(graph_thread_count_);
+    const boost::posix_time::ptime kStart = boost::posix_time::microsec_clock::universal_time();
+    *res = solver->Solve(*scen);
+    res->solve_seconds = (boost::posix_time::microsec_clock::universal_time() - kStart).total_microseconds() / 1e6;
+    
+    SimLog::UnbindThread();
+  }
+}
@@ -0,0 +1,97 @@
+//
+//  sweep_runner.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/16/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__sweep_runner__
+#define __PhoneSim__sweep_runner__
+
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include "solver_base.h"
+#include "thread_pool.h"
+#include "scenario_generator/scenario_cache.h"
+
+namespace mobile_sensing_sim {
+  typedef boost::shared_ptr<SolverBase> SolverPtr;
+  
+  // Appends the names of all solvers and creates solver solver_id
+  // only, none for an id out of range. Every job gets its own solver
+  // instance so no state is shared.
+  typedef boost::function<SolverPtr (int solver_id, std::vector<std::string>& solver_names)> SolverFactory;
+  
+  // Results of a sweep indexed by [phone count][seed][solver].
+  typedef std::vector<std::vector<std::vector<Result> > > SweepResults;
+  
+  // Runs (phone count, seed, solver) jobs on a thread pool.
+  // Scenarios are generated (or loaded from the cache) first, one job
+  // per (phone count, seed), then every solver runs as its own job on
+  // the shared scenario.
+  // Random streams are derived from the scenario seed and each job
+  // writes logs to its own files, so results do not depend on the
+  // thread count or on the order jobs happen to run in.
+  class SweepRunner {
+  public:
+    SweepRunner(const ScenarioParameters& sp, const SolverFactory& factory, int thread_count = 0)
+    : sp_(sp), factory_(factory), pool_(thread_count), use_milp_(false), flow_engine_(FlowAdapterFactory::DefaultEngine()), flow_thread_count_(1), graph_thread_count_(1), scenario_thread_count_(1) {}
+    
+    void SetMILP(bool use_milp) {
+      use_milp_ = use_milp;
+    }
+    
+    void SetFlowEngine(FlowEngine engine) {
+      flow_engine_ = engine;
+    }
+    
+    // Threads of flow engines solving in parallel, per job. Jobs
+    // already run side by side, so the default is 1.
+    void SetFlowThreadCount(int thread_count) {
+      flow_thread_count_ = thread_count;
+    }
+    
+    // Threads converting scenarios to flow graphs, per job. The
+    // default is 1 as well.
+    void SetGraphThreadCount(int thread_count) {
+      graph_thread_count_ = thread_count;
+    }
+    
+    // Threads finding the contacts of a generated scenario, per job.
+    // The default is 1 as well.
+    void SetScenarioThreadCount(int thread_count) {
+      scenario_thread_count_ = thread_count;
+    }
+    
+    // Reuse scenarios of earlier runs, NULL (the default) always generates.
+    void SetScenarioCache(const ScenarioCachePtr& cache) {
+      cache_ = cache;
+    }
+    
+    int ThreadCount() const {
+      return pool_.ThreadCount();
+    }
+    
+    void Run(const std::vector<int>& phone_counts, int scenario_number, SweepResults& results);
+  private:
+    typedef boost::shared_ptr<ScenarioGenerator> GeneratorPtr;
+    
+    void GenerateJob(int phone_count, int seed, GeneratorPtr *sg, ScenarioFilePtr *file, Scenario *scen);
+    void SolveJob(const Scenario *scen, int solver_id, Result *res);
+    
+    ScenarioParameters sp_;
+    SolverFactory factory_;
+    ThreadPool pool_;
+    bool use_milp_;
+    FlowEngine flow_engine_;
+    int flow_thread_count_;
+    int graph_thread_count_;
+    int scenario_thread_count_;
+    ScenarioCachePtr cache_;
+  };
+}
+
+#endif /* defined(__PhoneSim__sweep_runner__) */
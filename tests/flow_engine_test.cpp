@@ -0,0 +1,151 @@
+//
+//  flow_engine_test.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 1/3/15.
+//  Copyright (c) 2015 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "../scenario_generator/scenario_generator.h"
+#include "../optimal_solver/graph_converter.h"
+#include "../optimal_solver/flow_adapter_factory.h"
+#include "../simlog.h"
+
+// Solves the graphs of generated scenarios with every flow engine and
+// checks that each one ends with the status and optimal objective of
+// network simplex, infeasible problems included. Cost scaling with
+// several threads must also give the flow of one thread.
+//
+// Run ./flow_engine_test, it returns non-zero on a mismatch.
+
+namespace mss = mobile_sensing_sim;
+
+namespace {
+  const double kObjTolerance = 1.0E-6;
+
+  // Street grid of the phonesim map, targets on the streets. With
+  // unreachable_target, one more target lies in a block corner out of
+  // sensing range of every street.
+  mss::MonitorMap CreateMap(bool unreachable_target) {
+    std::vector<mss::Point> entry_points;
+    std::vector<mss::Point> intersect_points;
+    for (int k = 1; k <= 3; ++k) {
+      entry_points.push_back(mss::Point(156 * k, 0));
+      entry_points.push_back(mss::Point(156 * k, 316));
+      entry_points.push_back(mss::Point(0, 79 * k));
+      entry_points.push_back(mss::Point(624, 79 * k));
+      for (int l = 1; l <= 3; ++l) {
+        intersect_points.push_back(mss::Point(156 * k, 79 * l));
+      }
+    }
+    mss::AreaMap am(entry_points, intersect_points, 624, 316);
+
+    std::vector<mss::Point> monitor_points;
+    monitor_points.push_back(mss::Point(156, 79));
+    monitor_points.push_back(mss::Point(468, 79));
+    monitor_points.push_back(mss::Point(312, 158));
+    monitor_points.push_back(mss::Point(156, 237));
+    monitor_points.push_back(mss::Point(468, 237));
+    if (unreachable_target) {
+      monitor_points.push_back(mss::Point(5, 5));
+    }
+    return mss::MonitorMap(monitor_points, am);
+  }
+
+  mss::ScenarioParameters CreateParameters(int phone_count, int running_time, int seed, bool unreachable_target) {
+    mss::ScenarioParameters sp;
+    sp.phone_count = phone_count;
+    sp.running_time = running_time;
+    sp.sensing_range = 40;
+    sp.comm_range = 40;
+    sp.speed_range = mss::Range(5, 15, 0.1);
+    sp.start_time_range = mss::Range(0, std::min(200, running_time / 4));
+    sp.seed = seed;
+    sp.map = CreateMap(unreachable_target);
+    sp.data_per_second = 0.5;
+    sp.sensing_cost_range = mss::Range(2, 6, 0.5);
+    sp.transfer_cost_range = mss::Range(2, 6, 0.5);
+    sp.upload_cost_range = mss::Range(2, 6, 0.5);
+    sp.upload_limit_range = mss::Range(1, 3, 0.1);
+    return sp;
+  }
+
+  struct Engine {
+    Engine(const char* name, mss::FlowEngine engine, int thread_count, int same_flow_as = -1)
+    : name(name), engine(engine), thread_count(thread_count), same_flow_as(same_flow_as) {}
+    const char* name;
+    mss::FlowEngine engine;
+    int thread_count;
+    int same_flow_as; // Engine giving the same edge values, -1 if none.
+  };
+
+  struct Counts {
+    Counts() : graphs(0), infeasible(0), mismatches(0) {}
+    int graphs;
+    int infeasible;
+    int mismatches;
+  };
+
+  // Solve g with network simplex and every engine, count a mismatch if
+  // an engine ends with another status, another objective when
+  // optimal, or other edge values than the engine it should match.
+  void Check(const char* name, const mss::Graph& g, const std::vector<Engine>& engines, Counts& counts) {
+    mss::Solution expected;
+    mss::FlowAdapterFactory::Create(mss::NETWORK_SIMPLEX_ENGINE)->Solve(g, expected);
+    ++counts.graphs;
+    if (expected.solution_status != mss::Solution::OPTIMAL) {
+      ++counts.infeasible;
+    }
+    std::vector<mss::Solution> solutions(engines.size());
+    for (int k = 0; k < engines.size(); ++k) {
+      mss::Solution &s = solutions[k];
+      mss::FlowAdapterFactory::Create(engines[k].engine, engines[k].thread_count)->Solve(g, s);
+      if (s.solution_status != expected.solution_status || (s.solution_status == mss::Solution::OPTIMAL && std::abs(s.obj - expected.obj) > kObjTolerance)) {
+        ++counts.mismatches;
+        std::printf("%s, %s: status %d obj %.6f, network simplex status %d obj %.6f\n", name, engines[k].name, s.solution_status, s.obj, expected.solution_status, expected.obj);
+      }
+      const int kOther = engines[k].same_flow_as;
+      if (kOther != -1 && s.edge_values != solutions[kOther].edge_values) {
+        ++counts.mismatches;
+        std::printf("%s, %s: edge values differ from %s\n", name, engines[k].name, engines[kOther].name);
+      }
+    }
+  }
+}
+
+int main() {
+  mss::SimLog::IsLog = false;
+  std::vector<Engine> engines;
+  engines.push_back(Engine("successive paths", mss::SUCCESSIVE_PATH_ENGINE, 1));
+  engines.push_back(Engine("cost scaling", mss::COST_SCALING_ENGINE, 1));
+  engines.push_back(Engine("cost scaling, 4 threads", mss::COST_SCALING_ENGINE, 4, 1));
+
+  // Phone count, running time, seed, unreachable target. The first
+  // run is too short to upload every target and the last one has a
+  // target no phone passes, both are infeasible.
+  const int kScenarios[][4] = {
+    {20, 300, 0, 0},
+    {40, 600, 1, 0},
+    {60, 400, 2, 0},
+    {40, 400, 3, 1}
+  };
+  Counts counts;
+  for (int k = 0; k < sizeof(kScenarios) / sizeof(kScenarios[0]); ++k) {
+    const int *p = kScenarios[k];
+    mss::ScenarioGenerator sg(CreateParameters(p[0], p[1], p[2], p[3] != 0));
+    const mss::Scenario scen = sg.GenerateDefaultScenario();
+    char name[64];
+    mss::GraphConverter gc;
+    gc.ConvertToGraph(scen);
+    std::sprintf(name, "scenario %d, full graph", k);
+    Check(name, gc.GetGraph(), engines, counts);
+    gc.ConvertToEventGraph(scen);
+    std::sprintf(name, "scenario %d, event graph", k);
+    Check(name, gc.GetGraph(), engines, counts);
+  }
+  std::printf("%d graphs, %d infeasible, %d mismatches\n", counts.graphs, counts.infeasible, counts.mismatches);
+  return counts.mismatches == 0 && counts.infeasible > 0 ? 0 : 1;
+}
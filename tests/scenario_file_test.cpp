@@ -0,0 +1,143 @@
+//
+//  scenario_file_test.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 1/3/15.
+//  Copyright (c) 2015 Yuan. All rights reserved.
+//
+
+#include <cstdio>
+#include <vector>
+#include "../scenario_generator/scenario_generator.h"
+#include "../scenario_generator/scenario_file.h"
+#include "../simlog.h"
+
+// Writes scenarios to a scenario file and checks that Open gives back
+// the same start phones, trajectories and contacts, for scenarios with
+// all phones started and with only some of them started.
+//
+// Run ./scenario_file_test, it returns non-zero on a mismatch.
+
+namespace mss = mobile_sensing_sim;
+
+namespace {
+  const char kPath[] = "./scenario_file_test.bin";
+
+  // Street grid of the phonesim map, targets on the streets.
+  mss::MonitorMap CreateMap() {
+    std::vector<mss::Point> entry_points;
+    std::vector<mss::Point> intersect_points;
+    for (int k = 1; k <= 3; ++k) {
+      entry_points.push_back(mss::Point(156 * k, 0));
+      entry_points.push_back(mss::Point(156 * k, 316));
+      entry_points.push_back(mss::Point(0, 79 * k));
+      entry_points.push_back(mss::Point(624, 79 * k));
+      for (int l = 1; l <= 3; ++l) {
+        intersect_points.push_back(mss::Point(156 * k, 79 * l));
+      }
+    }
+    mss::AreaMap am(entry_points, intersect_points, 624, 316);
+
+    std::vector<mss::Point> monitor_points;
+    monitor_points.push_back(mss::Point(156, 79));
+    monitor_points.push_back(mss::Point(468, 79));
+    monitor_points.push_back(mss::Point(312, 158));
+    monitor_points.push_back(mss::Point(156, 237));
+    monitor_points.push_back(mss::Point(468, 237));
+    return mss::MonitorMap(monitor_points, am);
+  }
+
+  mss::ScenarioParameters CreateParameters() {
+    mss::ScenarioParameters sp;
+    sp.phone_count = 50;
+    sp.running_time = 300;
+    sp.sensing_range = 40;
+    sp.comm_range = 40;
+    sp.speed_range = mss::Range(5, 15, 0.1);
+    sp.start_time_range = mss::Range(0, 100);
+    sp.seed = 0;
+    sp.map = CreateMap();
+    sp.data_per_second = 0.5;
+    sp.sensing_cost_range = mss::Range(2, 6, 0.5);
+    sp.transfer_cost_range = mss::Range(2, 6, 0.5);
+    sp.upload_cost_range = mss::Range(2, 6, 0.5);
+    sp.upload_limit_range = mss::Range(1, 3, 0.1);
+    return sp;
+  }
+
+  // Number of differences between the written and the loaded scenario.
+  int Compare(const mss::Scenario& written, const mss::Scenario& loaded) {
+    if (loaded.phone_count != written.phone_count || loaded.target_count != written.target_count || loaded.running_time != written.running_time) {
+      return 1;
+    }
+    int mismatches = 0;
+    for (int i = 0; i < written.phone_count; ++i) {
+      const mss::Phone &w = written.phones[i];
+      const mss::Phone &l = loaded.phones[i];
+      if (l.kID_ != w.kID_ || l.is_active_ != w.is_active_ || l.upload_limit_ != w.upload_limit_ || l.GetLocation().x != w.GetLocation().x || l.GetLocation().y != w.GetLocation().y) {
+        ++mismatches;
+      }
+    }
+    for (int t = 0; t < written.running_time; ++t) {
+      if (loaded.start_phones[t] != written.start_phones[t]) {
+        ++mismatches;
+      }
+      for (int i = 0; i < written.phone_count; ++i) {
+        const mss::Point &w = written.phone_locations[t][i];
+        const mss::Point &l = loaded.phone_locations[t][i];
+        if (l.x != w.x || l.y != w.y) {
+          ++mismatches;
+        }
+      }
+      const mss::ContactSlice &w = written.contacts.Slice(t);
+      const mss::ContactSlice &l = loaded.contacts.Slice(t);
+      if (l.offsets.size() != w.offsets.size() || l.ids.size() != w.ids.size()) {
+        ++mismatches;
+        continue;
+      }
+      for (int k = 0; k < w.offsets.size(); ++k) {
+        mismatches += l.offsets[k] != w.offsets[k];
+      }
+      for (int k = 0; k < w.ids.size(); ++k) {
+        mismatches += l.ids[k] != w.ids[k] || l.data[k] != w.data[k];
+      }
+    }
+    return mismatches;
+  }
+
+  // Write scen, open it again and compare, false on any difference.
+  bool RoundTrip(const char* name, const mss::Scenario& scen) {
+    int start_count = 0;
+    for (int t = 0; t < scen.running_time; ++t) {
+      start_count += scen.start_phones[t].size();
+    }
+    mss::ScenarioFile file;
+    if (!mss::ScenarioFile::Write(scen, kPath) || !file.Open(kPath)) {
+      std::printf("%s: %d of %d phones started, write or open failed\n", name, start_count, scen.phone_count);
+      std::remove(kPath);
+      return false;
+    }
+    const int kMismatches = Compare(scen, file.GetScenario());
+    std::printf("%s: %d of %d phones started, %d mismatches\n", name, start_count, scen.phone_count, kMismatches);
+    std::remove(kPath);
+    return kMismatches == 0;
+  }
+}
+
+int main() {
+  mss::SimLog::IsLog = false;
+  const mss::ScenarioParameters sp = CreateParameters();
+  mss::ScenarioGenerator sg(sp);
+  bool is_ok = RoundTrip("all started", sg.GenerateDefaultScenario());
+
+  // Phones of every other start second never start, as in the
+  // scenarios the heuristics predict from.
+  std::vector<mss::Phone> phones;
+  std::vector<std::vector<int> > start_phones;
+  sg.GeneratePhones(phones, start_phones);
+  for (int t = 1; t < start_phones.size(); t += 2) {
+    start_phones[t].clear();
+  }
+  is_ok = RoundTrip("partly started", sg.GenerateScenario(phones, start_phones)) && is_ok;
+  return is_ok ? 0 : 1;
+}
@@ -0,0 +1,222 @@
+//
+//  warm_start_test.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 1/2/15.
+//  Copyright (c) 2015 Yuan. All rights reserved.
+//
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "../scenario_generator/scenario_generator.h"
+#include "../optimal_solver/rolling_graph_converter.h"
+#include "../optimal_solver/flow_adapter_factory.h"
+#include "../simlog.h"
+
+// Replays the report periods of HeuristicSolver and HeuristicDynSolver
+// and checks that every warm started Resolve ends like a cold Solve of
+// the same graph, infeasible periods included.
+//
+// Run ./warm_start_test [phone count running time seed], it returns
+// non-zero on a mismatch.
+
+namespace mss = mobile_sensing_sim;
+
+namespace {
+  const int kReportPeriod = 60;
+  const double kObjTolerance = 1.0E-6;
+
+  // Street grid of the phonesim map, targets on the streets.
+  mss::MonitorMap CreateMap() {
+    std::vector<mss::Point> entry_points;
+    std::vector<mss::Point> intersect_points;
+    for (int k = 1; k <= 3; ++k) {
+      entry_points.push_back(mss::Point(156 * k, 0));
+      entry_points.push_back(mss::Point(156 * k, 316));
+      entry_points.push_back(mss::Point(0, 79 * k));
+      entry_points.push_back(mss::Point(624, 79 * k));
+      for (int l = 1; l <= 3; ++l) {
+        intersect_points.push_back(mss::Point(156 * k, 79 * l));
+      }
+    }
+    mss::AreaMap am(entry_points, intersect_points, 624, 316);
+
+    std::vector<mss::Point> monitor_points;
+    monitor_points.push_back(mss::Point(156, 79));
+    monitor_points.push_back(mss::Point(468, 79));
+    monitor_points.push_back(mss::Point(312, 158));
+    monitor_points.push_back(mss::Point(156, 237));
+    monitor_points.push_back(mss::Point(468, 237));
+    return mss::MonitorMap(monitor_points, am);
+  }
+
+  mss::ScenarioParameters CreateParameters(int phone_count, int running_time, int seed) {
+    mss::ScenarioParameters sp;
+    sp.phone_count = phone_count;
+    sp.running_time = running_time;
+    sp.sensing_range = 40;
+    sp.comm_range = 40;
+    sp.speed_range = mss::Range(5, 15, 0.1);
+    sp.start_time_range = mss::Range(0, std::min(200, running_time / 4));
+    sp.seed = seed;
+    sp.map = CreateMap();
+    sp.data_per_second = 0.5;
+    sp.sensing_cost_range = mss::Range(2, 6, 0.5);
+    sp.transfer_cost_range = mss::Range(2, 6, 0.5);
+    sp.upload_cost_range = mss::Range(2, 6, 0.5);
+    sp.upload_limit_range = mss::Range(1, 3, 0.1);
+    return sp;
+  }
+
+  struct Counts {
+    Counts() : periods(0), infeasible(0), mismatches(0) {}
+    int periods;
+    int infeasible;
+    int mismatches;
+  };
+
+  // Solve g warm with warm and cold with a new adapter, count a
+  // mismatch if status or objective differ.
+  void Check(const char* name, int t, const mss::Graph& g, const mss::GraphDelta& delta, mss::FlowAdapterBase& warm, mss::Solution& s, Counts& counts) {
+    mss::Solution cold_s;
+    mss::FlowAdapterPtr cold = mss::FlowAdapterFactory::Create(mss::NETWORK_SIMPLEX_ENGINE);
+    warm.Resolve(g, delta, s);
+    cold->Solve(g, cold_s);
+    ++counts.periods;
+    if (cold_s.solution_status != mss::Solution::OPTIMAL) {
+      ++counts.infeasible;
+    }
+    if (s.solution_status != cold_s.solution_status || std::abs(s.obj - cold_s.obj) > kObjTolerance) {
+      ++counts.mismatches;
+      std::printf("%s t=%d: warm status %d obj %.6f, cold status %d obj %.6f\n", name, t, s.solution_status, s.obj, cold_s.solution_status, cold_s.obj);
+    }
+  }
+
+  // Phones only predict straight walks, like in the heuristics.
+  std::vector<mss::Phone> PredictingPhones(const mss::Scenario& scen) {
+    std::vector<mss::Phone> phones = scen.phones;
+    for (int i = 0; i < phones.size(); ++i) {
+      mss::TurnProbability tp;
+      tp.straight = 1.0;
+      tp.left = 0.0;
+      tp.right = 0.0;
+      phones[i].SetTurnProbability(tp);
+    }
+    return phones;
+  }
+
+  void StartPhones(const mss::Scenario& scen, int t, std::vector<mss::Phone>& phones) {
+    for (int i = t; i >= 0 && i > t - kReportPeriod; --i) {
+      for (int j = 0; j < scen.start_phones[i].size(); ++j) {
+        phones[scen.start_phones[i][j]].is_active_ = true;
+      }
+    }
+  }
+
+  void MovePhones(const mss::Scenario& scen, int t, std::vector<mss::Phone>& phones) {
+    if (t + kReportPeriod < scen.running_time) {
+      for (int i = 0; i < phones.size(); ++i) {
+        if (phones[i].is_active_) {
+          phones[i].MoveTo(scen.phone_locations[t + kReportPeriod][i]);
+        }
+      }
+    }
+  }
+
+  // Sensing and transfer actions of s in [t, t + report period) that
+  // the real contacts allow, as HeuristicSolver executes them.
+  void ExecuteActions(const mss::Scenario& scen, const mss::Graph& g, const mss::Solution& s, int t, mss::ContactList& executed) {
+    for (int i = 0; i < g.edge_count; ++i) {
+      const mss::Edge e = g.GetEdge(i);
+      if (s.edge_values[i] == 0 || e.time < t || e.time >= t + kReportPeriod) {
+        continue;
+      }
+      if (e.type == mss::Edge::TARGET_TO_PHONE && scen.contacts.IsConnected(e.time, e.phone1_id, e.target_id)) {
+        executed.SetContact(e.time, e.phone1_id, e.target_id, 1.0);
+      } else if (e.type == mss::Edge::PHONE_TO_PHONE && scen.contacts.IsConnected(e.time, e.phone1_id, e.phone2_id)) {
+        executed.SetContact(e.time, e.phone1_id, e.phone2_id, s.edge_values[i]);
+      }
+    }
+  }
+
+  // Periods of HeuristicSolver: rolling graph, executed actions frozen.
+  void CheckRolling(const mss::Scenario& scen, Counts& counts) {
+    std::vector<mss::Phone> phones = PredictingPhones(scen);
+    const std::vector<std::vector<int> > start_phones(scen.running_time, std::vector<int>());
+    mss::RollingGraphConverter gc;
+    gc.Init(scen);
+    mss::FlowAdapterPtr warm = mss::FlowAdapterFactory::Create(mss::NETWORK_SIMPLEX_ENGINE);
+    for (int t = 0; t < scen.running_time; t += kReportPeriod) {
+      StartPhones(scen, t, phones);
+      mss::ScenarioGenerator sg(scen.scen_param);
+      const mss::Scenario cur_scen = sg.GenerateScenario(phones, start_phones, t);
+      gc.SetPrediction(cur_scen.contacts, t);
+
+      mss::Solution s;
+      Check("rolling", t, gc.GetGraph(), gc.GetDelta(), *warm, s, counts);
+      mss::ContactList executed(scen.running_time, scen.phone_count, scen.target_count);
+      ExecuteActions(scen, gc.GetGraph(), s, t, executed);
+      for (int time = t; time < t + kReportPeriod && time < scen.running_time; ++time) {
+        const mss::ContactSlice& slice = executed.Slice(time);
+        for (int i = 0; i < scen.phone_count; ++i) {
+          for (int k = slice.offsets[i]; k < slice.offsets[i + 1]; ++k) {
+            gc.SetExecuted(time, i, slice.ids[k], slice.data[k]);
+          }
+        }
+      }
+      MovePhones(scen, t, phones);
+    }
+  }
+
+  // Periods of HeuristicDynSolver: full conversion, executed actions
+  // set as contacts.
+  void CheckConverted(const mss::Scenario& scen, Counts& counts) {
+    std::vector<mss::Phone> phones = PredictingPhones(scen);
+    const std::vector<std::vector<int> > start_phones(scen.running_time, std::vector<int>());
+    mss::GraphConverter gc;
+    mss::GraphDelta delta;
+    mss::ContactList executed(scen.running_time, scen.phone_count, scen.target_count);
+    mss::FlowAdapterPtr warm = mss::FlowAdapterFactory::Create(mss::NETWORK_SIMPLEX_ENGINE);
+    for (int t = 0; t < scen.running_time; t += kReportPeriod) {
+      StartPhones(scen, t, phones);
+      mss::ScenarioGenerator sg(scen.scen_param);
+      mss::Scenario cur_scen = sg.GenerateScenario(phones, start_phones, t);
+      for (int time = 0; time < t; ++time) {
+        const mss::ContactSlice& slice = executed.Slice(time);
+        for (int i = 0; i < scen.phone_count; ++i) {
+          for (int k = slice.offsets[i]; k < slice.offsets[i + 1]; ++k) {
+            cur_scen.contacts.SetContact(time, i, slice.ids[k], slice.data[k]);
+          }
+        }
+      }
+      gc.ConvertToGraph(cur_scen, delta);
+
+      mss::Solution s;
+      Check("converted", t, gc.GetGraph(), delta, *warm, s, counts);
+      ExecuteActions(scen, gc.GetGraph(), s, t, executed);
+      MovePhones(scen, t, phones);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  mss::SimLog::IsLog = false;
+  int phone_count = 40;
+  int running_time = 600;
+  int seed = 0;
+  if (argc == 4) {
+    phone_count = std::atoi(argv[1]);
+    running_time = std::atoi(argv[2]);
+    seed = std::atoi(argv[3]);
+  }
+
+  mss::ScenarioGenerator sg(CreateParameters(phone_count, running_time, seed));
+  const mss::Scenario scen = sg.GenerateDefaultScenario();
+  Counts counts;
+  CheckRolling(scen, counts);
+  CheckConverted(scen, counts);
+  std::printf("%d periods, %d infeasible, %d mismatches\n", counts.periods, counts.infeasible, counts.mismatches);
+  return counts.mismatches == 0 ? 0 : 1;
+}
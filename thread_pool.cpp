@@ -0,0 +1,118 @@
+//
+//  thread_pool.cpp
+//  PhoneSim
+//
+//  Created by Yuan on 12/16/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#include <boost/bind/bind.hpp>
+#include "thread_pool.h"
+
+namespace mobile_sensing_sim {
+  ThreadPool::ThreadPool(int thread_count) : queued_count_(0), pending_count_(0), next_worker_(0), stop_(false) {
+    if (thread_count <= 0) {
+      thread_count = boost::thread::hardware_concurrency();
+    }
+    if (thread_count <= 0) {
+      thread_count = 1;
+    }
+    
+    for (int i = 0; i < thread_count; ++i) {
+      workers_.push_back(boost::shared_ptr<Worker>(new Worker()));
+    }
+    for (int i = 0; i < thread_count; ++i) {
+      threads_.create_thread(boost::bind(&ThreadPool::WorkerLoop, this, i));
+    }
+  }
+  
+  ThreadPool::~ThreadPool() {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      stop_ = true;
+    }
+    task_cond_.notify_all();
+    threads_.join_all();
+  }
+  
+  void ThreadPool::Submit(const Task& task) {
+    // Spread tasks over the worker queues round robin. The task is
+    // counted together with the push, so a worker can never pop a
+    // task before it is counted and take queued_count_ below zero.
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      const int kWorkerId = next_worker_;
+      next_worker_ = (next_worker_ + 1) % workers_.size();
+      {
+        boost::mutex::scoped_lock worker_lock(workers_[kWorkerId]->mutex);
+        workers_[kWorkerId]->tasks.push_back(task);
+      }
+      ++pending_count_;
+      ++queued_count_;
+    }
+    task_cond_.notify_one();
+  }
+  
+  void ThreadPool::Wait() {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (pending_count_ > 0) {
+      done_cond_.wait(lock);
+    }
+  }
+  
+  bool ThreadPool::PopTask(int worker_id, Task& task) {
+    const int kWorkerCount = workers_.size();
+    for (int k = 0; k < kWorkerCount; ++k) {
+      const int id = (worker_id + k) % kWorkerCount;
+      Worker &w = *workers_[id];
+      boost::mutex::scoped_lock lock(w.mutex);
+      if (w.tasks.empty()) {
+        continue;
+      }
+      if (id == worker_id) {
+        task = w.tasks.back();
+        w.tasks.pop_back();
+      } else {
+        task = w.tasks.front();
+        w.tasks.pop_front();
+      }
+      return true;
+    }
+    return false;
+  }
+  
+  void ThreadPool::WorkerLoop(int worker_id) {
+    while (true) {
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        while (queued_count_ == 0 && !stop_) {
+          task_cond_.wait(lock);
+        }
+        if (queued_count_ == 0 && stop_) {
+          return;
+        }
+      }
+      
+      Task task;
+      if (!PopTask(worker_id, task)) {
+        // Another worker took it first.
+        continue;
+      }
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        --queued_count_;
+      }
+      
+      task();
+      
+      bool all_done = false;
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        all_done = --pending_count_ == 0;
+      }
+      if (all_done) {
+        done_cond_.notify_all();
+      }
+    }
+  }
+}
@@ -0,0 +1,60 @@
+//
+//  thread_pool.h
+//  PhoneSim
+//
+//  Created by Yuan on 12/16/14.
+//  Copyright (c) 2014 Yuan. All rights reserved.
+//
+
+#ifndef __PhoneSim__thread_pool__
+#define __PhoneSim__thread_pool__
+
+#include <deque>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+namespace mobile_sensing_sim {
+  // Fixed size pool of worker threads. Every worker owns a task
+  // queue, it takes work from the back of its own queue and steals
+  // from the front of the other queues when it runs dry.
+  class ThreadPool {
+  public:
+    typedef boost::function<void ()> Task;
+    
+    // thread_count <= 0 uses all hardware threads.
+    explicit ThreadPool(int thread_count = 0);
+    ~ThreadPool();
+    
+    void Submit(const Task& task);
+    
+    // Block until every submitted task has finished.
+    void Wait();
+    
+    int ThreadCount() const {
+      return workers_.size();
+    }
+  private:
+    struct Worker {
+      boost::mutex mutex;
+      std::deque<Task> tasks;
+    };
+    
+    void WorkerLoop(int worker_id);
+    bool PopTask(int worker_id, Task& task);
+    
+    std::vector<boost::shared_ptr<Worker> > workers_;
+    boost::thread_group threads_;
+    
+    boost::mutex mutex_;
+    boost::condition_variable task_cond_;
+    boost::condition_variable done_cond_;
+    int queued_count_; // Tasks waiting in queues.
+    int pending_count_; // Tasks not finished yet.
+    int next_worker_;
+    bool stop_;
+  };
+}
+
+#endif /* defined(__PhoneSim__thread_pool__) */